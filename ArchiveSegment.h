@@ -0,0 +1,39 @@
+#ifndef ARCHIVESEGMENT_H
+#define ARCHIVESEGMENT_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// A run of settled prescriptions or transactions moved out of the hot
+// table into its own read-only snapshot file under archive/. Segments hold
+// rows of a single month and are never rewritten once listed in the
+// manifest (archive/manifest.txt).
+struct ArchiveSegment {
+    std::string file;       // name within archive/
+    size_t firstPos = 0;    // table position of the first row
+    size_t rows = 0;
+    int minDay = 0;         // range of the rows' day numbers
+    int maxDay = 0;
+    int maxId = 0;
+};
+
+// Segments in table order. Together they cover positions 0 up to the base
+// of each table; the hot snapshot and the in-memory table hold the rest.
+struct ArchiveManifest {
+    std::vector<ArchiveSegment> prescriptions;
+    std::vector<ArchiveSegment> transactions;
+
+    static size_t baseOf(const std::vector<ArchiveSegment>& segments) {
+        return segments.empty() ? 0 : segments.back().firstPos + segments.back().rows;
+    }
+    static int maxIdOf(const std::vector<ArchiveSegment>& segments) {
+        int id = 0;
+        for (const auto& s : segments) id = std::max(id, s.maxId);
+        return id;
+    }
+    size_t prescriptionBase() const { return baseOf(prescriptions); }
+    size_t transactionBase() const { return baseOf(transactions); }
+};
+
+#endif
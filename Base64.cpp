@@ -0,0 +1,322 @@
+#include "Base64.h"
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// The vector paths are compiled for their instruction set whatever the
+// build flags say, and only called once the CPU is known to support it
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BASE64_HAVE_X86 1
+#define BASE64_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define BASE64_HAVE_X86 1
+#define BASE64_TARGET(isa)
+#endif
+
+using namespace std;
+
+// Plain arrays built at compile time, so they are usable while other
+// globals (the controller in main.cpp) are constructed
+static constexpr char encodeTable[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+static constexpr unsigned char invalid = 0xFF;
+
+static constexpr array<unsigned char, 256> makeDecodeTable() {
+    array<unsigned char, 256> table{};
+    for (auto& entry : table) entry = invalid;
+    for (unsigned char i = 0; i < 64; ++i) {
+        table[static_cast<unsigned char>(encodeTable[i])] = i;
+    }
+    return table;
+}
+
+static constexpr array<unsigned char, 256> decodeTable = makeDecodeTable();
+
+// --- Scalar ---
+static void encodeScalar(const unsigned char* in, size_t length, char* out) {
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+        *out++ = encodeTable[v >> 18];
+        *out++ = encodeTable[(v >> 12) & 0x3F];
+        *out++ = encodeTable[(v >> 6) & 0x3F];
+        *out++ = encodeTable[v & 0x3F];
+    }
+    if (i < length) {
+        uint32_t v = uint32_t(in[i]) << 16;
+        if (i + 1 < length) v |= uint32_t(in[i + 1]) << 8;
+        *out++ = encodeTable[v >> 18];
+        *out++ = encodeTable[(v >> 12) & 0x3F];
+        *out++ = i + 1 < length ? encodeTable[(v >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+}
+
+// Decodes length characters (no padding); false on a character outside
+// the alphabet
+static bool decodeScalar(const char* in, size_t length, unsigned char* out) {
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t a = decodeTable[(unsigned char)in[i]], b = decodeTable[(unsigned char)in[i + 1]];
+        uint32_t c = decodeTable[(unsigned char)in[i + 2]], d = decodeTable[(unsigned char)in[i + 3]];
+        if ((a | b | c | d) == invalid) return false;   // valid values fit in 6 bits
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = (unsigned char)(v >> 16);
+        *out++ = (unsigned char)(v >> 8);
+        *out++ = (unsigned char)v;
+    }
+    size_t rest = length - i;
+    if (rest == 0) return true;
+    if (rest == 1) return false;
+    uint32_t a = decodeTable[(unsigned char)in[i]], b = decodeTable[(unsigned char)in[i + 1]];
+    uint32_t c = rest == 3 ? decodeTable[(unsigned char)in[i + 2]] : 0;
+    if (a == invalid || b == invalid || c == invalid) return false;
+    uint32_t v = (a << 18) | (b << 12) | (c << 6);
+    *out++ = (unsigned char)(v >> 16);
+    if (rest == 3) *out++ = (unsigned char)(v >> 8);
+    return true;
+}
+
+#ifdef BASE64_HAVE_X86
+// --- SSSE3 / AVX2 ---
+// After W. Mula and D. Lemire, "Faster Base64 Encoding and Decoding Using
+// AVX2 Instructions" (2018). Encoding spreads each 3 input bytes over four
+// 6-bit lanes with a shuffle and two multiplies, then maps values to
+// characters with one 16-entry shuffle lookup. Decoding classifies each
+// character by its two nibbles to validate and translate it, then packs
+// four 6-bit values back into 3 bytes with multiply-adds.
+
+BASE64_TARGET("ssse3")
+static inline __m128i encodeLanes128(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(high, low);
+
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+// 12 bytes per step; each load reads 16, so stop 4 bytes early
+BASE64_TARGET("ssse3")
+static size_t encodeSsse3(const unsigned char* in, size_t length, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 12, out += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encodeLanes128(chunk));
+    }
+    return i;
+}
+
+// Returns false if any of the 16 characters is outside the alphabet
+BASE64_TARGET("ssse3")
+static inline bool decodeLanes128(__m128i& chars) {
+    const __m128i lowClasses = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                             0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i highClasses = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i shifts = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i slash = _mm_set1_epi8(0x2F);
+
+    __m128i highNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), slash);
+    __m128i lowNibbles = _mm_and_si128(chars, slash);
+    __m128i classes = _mm_and_si128(_mm_shuffle_epi8(lowClasses, lowNibbles),
+                                    _mm_shuffle_epi8(highClasses, highNibbles));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(classes, _mm_setzero_si128()))) return false;
+
+    __m128i isSlash = _mm_cmpeq_epi8(chars, slash);
+    __m128i values = _mm_add_epi8(chars, _mm_shuffle_epi8(shifts, _mm_add_epi8(isSlash, highNibbles)));
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    chars = _mm_shuffle_epi8(words, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    return true;
+}
+
+// 16 characters per step; each store writes 16 bytes of which 12 are
+// output, so the caller leaves 4 bytes of slack. Stops at the first block
+// with a bad character and leaves it to the scalar code.
+BASE64_TARGET("ssse3")
+static size_t decodeSsse3(const char* in, size_t length, unsigned char* out) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16, out += 12) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        if (!decodeLanes128(chunk)) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chunk);
+    }
+    return i;
+}
+
+// The same steps on two 128-bit lanes, each holding 12 input bytes
+BASE64_TARGET("avx2")
+static size_t encodeAvx2(const unsigned char* in, size_t length, char* out) {
+    const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                             '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                             '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    for (; i + 28 <= length; i += 24, out += 32) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+        __m256i chunk = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        chunk = _mm256_shuffle_epi8(chunk, spread);
+        __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(chunk, _mm256_set1_epi32(0x0FC0FC00)),
+                                          _mm256_set1_epi32(0x04000040));
+        __m256i low = _mm256_mullo_epi16(_mm256_and_si256(chunk, _mm256_set1_epi32(0x003F03F0)),
+                                         _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(high, low);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        __m256i chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+    }
+    return i;
+}
+
+// 32 characters per step into 24 bytes; stores write 32, so the caller
+// leaves 8 bytes of slack
+BASE64_TARGET("avx2")
+static size_t decodeAvx2(const char* in, size_t length, unsigned char* out) {
+    const __m256i lowClasses = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i highClasses = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                                 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i shifts = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i slash = _mm256_set1_epi8(0x2F);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32, out += 24) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), slash);
+        __m256i lowNibbles = _mm256_and_si256(chars, slash);
+        __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(lowClasses, lowNibbles),
+                                           _mm256_shuffle_epi8(highClasses, highNibbles));
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(classes, _mm256_setzero_si256()))) break;
+
+        __m256i isSlash = _mm256_cmpeq_epi8(chars, slash);
+        __m256i values = _mm256_add_epi8(chars, _mm256_shuffle_epi8(shifts, _mm256_add_epi8(isSlash, highNibbles)));
+        __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        __m256i packed = _mm256_shuffle_epi8(words, pack);
+        // Close the 4-byte gap at the end of each lane
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+    }
+    return i;
+}
+
+enum class Isa { Scalar, Ssse3, Avx2 };
+
+static Isa detectIsa() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    // BASE64_PATH=ssse3 or scalar holds the choice below what the CPU
+    // offers, so every path can be tested and timed on one machine
+    const char* limit = getenv("BASE64_PATH");
+    if (limit && strcmp(limit, "scalar") == 0) return Isa::Scalar;
+    if (limit && strcmp(limit, "ssse3") == 0) avx2 = false;
+    if (avx2) return Isa::Avx2;
+    if (ssse3) return Isa::Ssse3;
+    return Isa::Scalar;
+}
+
+static Isa cpuIsa() {
+    static const Isa isa = detectIsa();
+    return isa;
+}
+#endif
+
+// --- Public interface ---
+const char* base64Path() {
+#ifdef BASE64_HAVE_X86
+    switch (cpuIsa()) {
+        case Isa::Avx2: return "avx2";
+        case Isa::Ssse3: return "ssse3";
+        case Isa::Scalar: break;
+    }
+#endif
+    return "scalar";
+}
+
+string base64Encode(const unsigned char* data, size_t length) {
+    string out(((length + 2) / 3) * 4, '\0');
+    char* dst = &out[0];
+    size_t done = 0;
+#ifdef BASE64_HAVE_X86
+    switch (cpuIsa()) {
+        case Isa::Avx2: done = encodeAvx2(data, length, dst); break;
+        case Isa::Ssse3: done = encodeSsse3(data, length, dst); break;
+        case Isa::Scalar: break;
+    }
+#endif
+    encodeScalar(data + done, length - done, dst + done / 3 * 4);
+    return out;
+}
+
+bool base64Decode(string_view encoded, vector<unsigned char>& out) {
+    out.clear();
+    size_t length = encoded.size();
+    if (length % 4 == 0 && length > 0 && encoded[length - 1] == '=') {
+        --length;
+        if (encoded[length - 1] == '=') --length;
+    }
+    if (length % 4 == 1) return false;
+
+    size_t decodedSize = length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0);
+    // Slack for the vector stores, trimmed off again below
+    out.resize(decodedSize + 8);
+    const char* src = encoded.data();
+    size_t done = 0;
+#ifdef BASE64_HAVE_X86
+    switch (cpuIsa()) {
+        case Isa::Avx2: done = decodeAvx2(src, length, out.data()); break;
+        case Isa::Ssse3: done = decodeSsse3(src, length, out.data()); break;
+        case Isa::Scalar: break;
+    }
+#endif
+    if (!decodeScalar(src + done, length - done, out.data() + done / 4 * 3)) {
+        out.clear();
+        return false;
+    }
+    out.resize(decodedSize);
+    return true;
+}
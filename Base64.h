@@ -0,0 +1,23 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Standard base64 (RFC 4648 alphabet, '=' padding). Both directions size
+// their output once up front and convert 12 or 24 input bytes per step with
+// SSSE3 or AVX2 when the CPU has them (picked at run time), falling back to
+// table lookups for the tail and on other CPUs.
+std::string base64Encode(const unsigned char* data, size_t length);
+
+// Accepts padded or unpadded input. Returns false, leaving out empty, on
+// characters outside the alphabet or misplaced padding.
+bool base64Decode(std::string_view encoded, std::vector<unsigned char>& out);
+
+// The path in use: "avx2", "ssse3" or "scalar". Setting BASE64_PATH to
+// "ssse3" or "scalar" before the first call rules out the faster ones.
+const char* base64Path();
+
+#endif
@@ -0,0 +1,48 @@
+#include "Compression.h"
+#include <algorithm>
+#include <zlib.h>
+
+using namespace std;
+
+// Output is added in steps of at least this much, and input is fed in
+// slices no larger than zlib's 32-bit counters allow
+static const size_t outputStep = 64 * 1024;
+static const size_t inputSlice = 1u << 30;
+
+bool compressBody(string_view data, ContentCoding coding, int level, string& out) {
+    z_stream zs = {};
+    // 16 + MAX_WBITS asks for gzip framing instead of zlib's
+    int windowBits = coding == ContentCoding::Gzip ? 16 + MAX_WBITS : MAX_WBITS;
+    if (deflateInit2(&zs, min(max(level, 1), 9), Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    size_t start = out.size();
+    size_t written = start;
+    size_t fed = 0;
+    int status = Z_OK;
+    while (status == Z_OK) {
+        if (zs.avail_in == 0 && fed < data.size()) {
+            size_t slice = min(inputSlice, data.size() - fed);
+            zs.next_in = (Bytef*)data.data() + fed;
+            zs.avail_in = (uInt)slice;
+            fed += slice;
+        }
+        // Grows with the string's own doubling, so large bodies are not
+        // copied a step at a time
+        if (out.size() - written < outputStep) out.resize(max(written + outputStep, out.capacity()));
+        size_t room = min(out.size() - written, inputSlice);
+        zs.next_out = (Bytef*)&out[written];
+        zs.avail_out = (uInt)room;
+        status = deflate(&zs, fed == data.size() ? Z_FINISH : Z_NO_FLUSH);
+        written += room - zs.avail_out;
+        if (status == Z_BUF_ERROR) status = Z_OK;   // no progress possible this round; go again
+    }
+    deflateEnd(&zs);
+    if (status != Z_STREAM_END) {
+        out.resize(start);
+        return false;
+    }
+    out.resize(written);
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <string_view>
+
+// HTTP content codings zlib can produce. "deflate" in HTTP is the zlib
+// format (RFC 1950), not a raw deflate stream.
+enum class ContentCoding { Gzip, Deflate };
+
+// Appends data, compressed at level (1-9), to out. zlib writes straight
+// into out as it grows, a slice at a time, so the compressed copy is the
+// only one made. Returns false (out unchanged) if zlib fails.
+bool compressBody(std::string_view data, ContentCoding coding, int level, std::string& out);
+
+#endif
@@ -0,0 +1,133 @@
+#include "CryptoApiSignatureBackend.h"
+
+#ifdef _WIN32
+
+#include <iostream>
+
+using namespace std;
+
+CryptoApiSignatureBackend::CryptoApiSignatureBackend() : hProv(0), hKey(0) {}
+
+CryptoApiSignatureBackend::~CryptoApiSignatureBackend() {
+    if (hKey) CryptDestroyKey(hKey);
+    if (hProv) CryptReleaseContext(hProv, 0);
+}
+
+bool CryptoApiSignatureBackend::init() {
+    const char* containerName = "HospitalSystemKeyContainer";
+
+    // Try to acquire context for existing container
+    if (!CryptAcquireContext(&hProv, containerName, NULL, PROV_RSA_AES, 0)) {
+        // If doesn't exist, create it
+        if (GetLastError() == NTE_BAD_KEYSET) {
+            if (!CryptAcquireContext(&hProv, containerName, NULL, PROV_RSA_AES, CRYPT_NEWKEYSET)) {
+                cerr << "Error creating key container: " << GetLastError() << "\n";
+                return false;
+            }
+        } else {
+            cerr << "Error acquiring context: " << GetLastError() << "\n";
+            return false;
+        }
+    }
+
+    // Try to get the signature key
+    if (!CryptGetUserKey(hProv, AT_SIGNATURE, &hKey)) {
+        if (GetLastError() == NTE_NO_KEY) {
+            // Generate if not found
+            if (!CryptGenKey(hProv, AT_SIGNATURE, CRYPT_EXPORTABLE, &hKey)) {
+                cerr << "Error generating key: " << GetLastError() << "\n";
+                return false;
+            }
+        } else {
+            cerr << "Error getting user key: " << GetLastError() << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Caller holds lock; returns 0 on failure
+HCRYPTHASH CryptoApiSignatureBackend::hashOf(const string& data) {
+    HCRYPTHASH hHash = 0;
+    if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash)) {
+        cerr << "Error during CryptCreateHash." << endl;
+        return 0;
+    }
+    if (!CryptHashData(hHash, (BYTE*)data.c_str(), (DWORD)data.length(), 0)) {
+        cerr << "Error during CryptHashData." << endl;
+        CryptDestroyHash(hHash);
+        return 0;
+    }
+    return hHash;
+}
+
+vector<unsigned char> CryptoApiSignatureBackend::sign(const string& data) {
+    lock_guard<mutex> guard(lock);
+    HCRYPTHASH hHash = hashOf(data);
+    if (!hHash) return {};
+
+    DWORD dwSigLen = 0;
+    if (!CryptSignHash(hHash, AT_SIGNATURE, NULL, 0, NULL, &dwSigLen)) {
+        cerr << "Error during CryptSignHash (length)." << endl;
+        CryptDestroyHash(hHash);
+        return {};
+    }
+
+    vector<unsigned char> pbSignature(dwSigLen);
+    if (!CryptSignHash(hHash, AT_SIGNATURE, NULL, 0, pbSignature.data(), &dwSigLen)) {
+        cerr << "Error during CryptSignHash (data)." << endl;
+        CryptDestroyHash(hHash);
+        return {};
+    }
+
+    CryptDestroyHash(hHash);
+    return pbSignature;
+}
+
+// The controller holds the key pair for the "Hospital System Authority", so
+// verification uses the public half of the same key. A distributed setup
+// would export the public key and import it on the verifying side.
+bool CryptoApiSignatureBackend::verify(const string& data, const vector<unsigned char>& signature) {
+    lock_guard<mutex> guard(lock);
+    HCRYPTHASH hHash = hashOf(data);
+    if (!hHash) return false;
+
+    bool ok = CryptVerifySignature(hHash, signature.data(), (DWORD)signature.size(), hKey, NULL, 0) != FALSE;
+    CryptDestroyHash(hHash);
+    return ok;
+}
+
+vector<unsigned char> CryptoApiSignatureBackend::digest(const string& data) {
+    lock_guard<mutex> guard(lock);
+    HCRYPTHASH hHash = hashOf(data);
+    if (!hHash) return {};
+
+    vector<unsigned char> value(32);
+    DWORD length = (DWORD)value.size();
+    if (!CryptGetHashParam(hHash, HP_HASHVAL, value.data(), &length, 0)) value.clear();
+    CryptDestroyHash(hHash);
+    return value;
+}
+
+bool CryptoApiSignatureBackend::randomBytes(unsigned char* out, size_t length) {
+    lock_guard<mutex> guard(lock);
+    return hProv && CryptGenRandom(hProv, (DWORD)length, out) != FALSE;
+}
+
+// CryptoAPI has no PBKDF2, so this goes through CNG. It needs neither the
+// provider nor the lock, so derivations run in parallel.
+bool CryptoApiSignatureBackend::deriveKey(const string& password, const vector<unsigned char>& salt,
+                                          unsigned iterations, unsigned char* out, size_t length) {
+    BCRYPT_ALG_HANDLE hmac;
+    if (BCryptOpenAlgorithmProvider(&hmac, BCRYPT_SHA256_ALGORITHM, NULL, BCRYPT_ALG_HANDLE_HMAC_FLAG) != 0) {
+        return false;
+    }
+    NTSTATUS status = BCryptDeriveKeyPBKDF2(hmac, (PUCHAR)password.data(), (ULONG)password.size(),
+                                            (PUCHAR)salt.data(), (ULONG)salt.size(), iterations,
+                                            out, (ULONG)length, 0);
+    BCryptCloseAlgorithmProvider(hmac, 0);
+    return status == 0;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CRYPTOAPISIGNATUREBACKEND_H
+#define CRYPTOAPISIGNATUREBACKEND_H
+
+#ifdef _WIN32
+
+#include "SignatureBackend.h"
+#include <mutex>
+#include <windows.h>
+#include <wincrypt.h>
+#include <bcrypt.h>
+
+#pragma comment(lib, "crypt32.lib")
+#pragma comment(lib, "bcrypt.lib")
+
+// RSA signatures over SHA-256 with the key pair kept in a CryptoAPI key
+// container. Hash objects cannot be shared, so each call makes its own;
+// the provider handle itself is used under a lock.
+class CryptoApiSignatureBackend : public SignatureBackend {
+private:
+    HCRYPTPROV hProv;
+    HCRYPTKEY hKey;
+    std::mutex lock;
+
+    HCRYPTHASH hashOf(const std::string& data);
+
+public:
+    CryptoApiSignatureBackend();
+    ~CryptoApiSignatureBackend() override;
+
+    bool init() override;
+    std::vector<unsigned char> sign(const std::string& data) override;
+    bool verify(const std::string& data, const std::vector<unsigned char>& signature) override;
+    std::vector<unsigned char> digest(const std::string& data) override;
+    bool randomBytes(unsigned char* out, size_t length) override;
+    bool deriveKey(const std::string& password, const std::vector<unsigned char>& salt,
+                   unsigned iterations, unsigned char* out, size_t length) override;
+    const char* name() const override { return "CryptoAPI RSA/SHA-256"; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+#include "CsvTokenizer.h"
+#include <charconv>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CSV_HAVE_SSE2 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+#ifdef CSV_HAVE_SSE2
+static inline unsigned lowestSetBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Finds the end of an unquoted field: the next delimiter or '\n'. Compares
+// 16 bytes per step where SSE2 is available (every x86-64 CPU).
+static const char* findFieldEnd(const char* p, const char* end, char delimiter) {
+#ifdef CSV_HAVE_SSE2
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, delim), _mm_cmpeq_epi8(chunk, newline));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask) return p + lowestSetBit(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != delimiter && *p != '\n') ++p;
+    return p;
+}
+
+CsvTokenizer::CsvTokenizer(string_view in, char delim)
+    : input(in), position(0), delimiter(delim) {}
+
+// p points just past the opening quote. Records the field's span and
+// returns the position after the closing quote (or end if unterminated).
+const char* CsvTokenizer::quotedField(const char* p, const char* end) {
+    const char* begin = input.data();
+    const char* start = p;
+    size_t scratchStart = scratch.size();
+    bool escaped = false;
+
+    while (true) {
+        const char* quote = static_cast<const char*>(memchr(p, '"', end - p));
+        if (!quote) quote = end;
+        if (quote + 1 < end && quote[1] == '"') {
+            // Doubled quote: from here on the field has to be copied
+            if (!escaped) {
+                escaped = true;
+                p = start;
+            }
+            scratch.append(p, quote + 1 - p);
+            p = quote + 2;
+            continue;
+        }
+        if (escaped) {
+            scratch.append(p, quote - p);
+            spans.push_back({ true, scratchStart, scratch.size() - scratchStart });
+        } else {
+            spans.push_back({ false, (size_t)(start - begin), (size_t)(quote - start) });
+        }
+        return quote < end ? quote + 1 : end;
+    }
+}
+
+bool CsvTokenizer::nextRow(vector<string_view>& fields) {
+    fields.clear();
+    spans.clear();
+    scratch.clear();
+
+    const char* begin = input.data();
+    const char* end = begin + input.size();
+    const char* p = begin + position;
+
+    // Blank lines carry no row
+    while (p < end && (*p == '\n' || (*p == '\r' && p + 1 < end && p[1] == '\n'))) {
+        p += (*p == '\r') ? 2 : 1;
+    }
+    if (p >= end) {
+        position = input.size();
+        return false;
+    }
+
+    while (true) {
+        if (p < end && *p == '"') {
+            p = quotedField(p + 1, end);
+            // Anything between the closing quote and the delimiter is dropped
+            p = findFieldEnd(p, end, delimiter);
+        } else {
+            const char* fieldEnd = findFieldEnd(p, end, delimiter);
+            const char* valueEnd = fieldEnd;
+            if (valueEnd > p && valueEnd[-1] == '\r' && (fieldEnd == end || *fieldEnd == '\n')) --valueEnd;
+            spans.push_back({ false, (size_t)(p - begin), (size_t)(valueEnd - p) });
+            p = fieldEnd;
+        }
+
+        if (p < end && *p == delimiter) {
+            ++p;
+            continue;
+        }
+        if (p < end) ++p;   // the '\n' ending the row
+        break;
+    }
+    position = p - begin;
+
+    // scratch may have grown during the row, so views are taken only now
+    for (const auto& span : spans) {
+        fields.push_back(span.unescaped ? string_view(scratch).substr(span.offset, span.length)
+                                        : input.substr(span.offset, span.length));
+    }
+    return true;
+}
+
+void appendCsvField(string& out, string_view value, char delimiter) {
+    bool needsQuotes = false;
+    for (char c : value) {
+        if (c == delimiter || c == '"' || c == '\n' || c == '\r') {
+            needsQuotes = true;
+            break;
+        }
+    }
+    if (!needsQuotes) {
+        out.append(value.data(), value.size());
+        return;
+    }
+    out += '"';
+    for (char c : value) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// Shortest text that parses back to the same float, so values survive a
+// save/load round trip exactly
+void appendCsvFloat(string& out, float value) {
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+template <typename T>
+static bool parseWhole(string_view field, T& out) {
+    const char* first = field.data();
+    const char* last = first + field.size();
+    auto result = from_chars(first, last, out);
+    return result.ec == errc() && result.ptr == last;
+}
+
+bool parseCsvInt(string_view field, int& out) {
+    return parseWhole(field, out);
+}
+
+bool parseCsvSize(string_view field, size_t& out) {
+    return parseWhole(field, out);
+}
+
+bool parseCsvFloat(string_view field, float& out) {
+    return parseWhole(field, out);
+}
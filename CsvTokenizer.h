@@ -0,0 +1,47 @@
+#ifndef CSVTOKENIZER_H
+#define CSVTOKENIZER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Splits comma-separated text into rows of string_view fields without
+// allocating per line. A field wrapped in double quotes may contain commas,
+// line breaks and doubled ("") quotes, so names with commas survive a round
+// trip. Views point into the input, or into a scratch buffer for quoted
+// fields that needed unescaping, and stay valid until the next nextRow().
+class CsvTokenizer {
+private:
+    struct Span {
+        bool unescaped;     // true: lives in scratch, false: lives in input
+        size_t offset;
+        size_t length;
+    };
+
+    std::string_view input;
+    size_t position;
+    char delimiter;
+    std::string scratch;
+    std::vector<Span> spans;
+
+    const char* quotedField(const char* p, const char* end);
+
+public:
+    explicit CsvTokenizer(std::string_view input, char delimiter = ',');
+
+    // Fills fields with the next row, skipping blank lines; false at the end
+    bool nextRow(std::vector<std::string_view>& fields);
+    size_t offset() const { return position; }
+};
+
+// Appends value as one field, quoting it only when it has to be
+void appendCsvField(std::string& out, std::string_view value, char delimiter = ',');
+void appendCsvFloat(std::string& out, float value);
+
+// Whole-field numeric parsing; false on empty input or trailing garbage
+bool parseCsvInt(std::string_view field, int& out);
+bool parseCsvSize(std::string_view field, size_t& out);
+bool parseCsvFloat(std::string_view field, float& out);
+
+#endif
@@ -0,0 +1,116 @@
+#include "DashboardStats.h"
+#include "Date.h"
+#include <algorithm>
+
+using namespace std;
+
+static bool isPaid(const Transaction& t) {
+    return t.paymentMethod != "Pending";
+}
+
+DashboardStats::DashboardStats()
+    : recentNext(0), recentCount(0), lowStock(0), pending(0), todayKey(Date::invalid), nextRollover(0) {}
+
+// Converting to local time is far dearer than reading the clock, so the
+// day is only recomputed once the clock passes the next local midnight
+int DashboardStats::today() const {
+    time_t now = time(nullptr);
+    if (now >= nextRollover) {
+        tm local;
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        todayKey = Date::fromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+        local.tm_mday += 1;
+        local.tm_hour = local.tm_min = local.tm_sec = 0;
+        local.tm_isdst = -1;   // let mktime work out DST for tomorrow
+        nextRollover = mktime(&local);
+    }
+    return todayKey;
+}
+
+void DashboardStats::addRevenue(const Transaction& t, double sign) {
+    if (isPaid(t)) revenueByDay[t.day] += sign * t.amount;
+}
+
+void DashboardStats::reset(const vector<Transaction>& transactions, int lowStockDrugs, int pendingPrescriptions) {
+    lock_guard<mutex> guard(statsMutex);
+    revenueByDay = archivedRevenueByDay;
+    for (const auto& t : transactions) addRevenue(t, 1);
+
+    recentNext = recentCount = 0;
+    size_t first = transactions.size() - min(transactions.size(), recentCapacity);
+    for (size_t i = first; i < transactions.size(); ++i) {
+        recent[recentNext] = transactions[i];
+        recent[recentNext].signature.clear();
+        recentNext = (recentNext + 1) % recentCapacity;
+        ++recentCount;
+    }
+    lowStock = lowStockDrugs;
+    pending = pendingPrescriptions;
+}
+
+void DashboardStats::addArchived(const vector<Transaction>& transactions, size_t begin, size_t end) {
+    lock_guard<mutex> guard(statsMutex);
+    for (size_t i = begin; i < end; ++i) {
+        if (isPaid(transactions[i])) archivedRevenueByDay[transactions[i].day] += transactions[i].amount;
+    }
+}
+
+void DashboardStats::transactionAdded(const Transaction& t) {
+    lock_guard<mutex> guard(statsMutex);
+    addRevenue(t, 1);
+    recent[recentNext] = t;
+    recent[recentNext].signature.clear();
+    recentNext = (recentNext + 1) % recentCapacity;
+    recentCount = min(recentCount + 1, recentCapacity);
+}
+
+void DashboardStats::transactionUpdated(const Transaction& before, const Transaction& after) {
+    lock_guard<mutex> guard(statsMutex);
+    addRevenue(before, -1);
+    addRevenue(after, 1);
+    for (size_t i = 0; i < recentCount; ++i) {
+        Transaction& r = recent[(recentNext + recentCapacity - 1 - i) % recentCapacity];
+        if (r.id == after.id) {
+            r = after;
+            r.signature.clear();
+            break;
+        }
+    }
+}
+
+float DashboardStats::revenueOn(int day) const {
+    lock_guard<mutex> guard(statsMutex);
+    auto it = revenueByDay.find(day);
+    return it == revenueByDay.end() ? 0 : static_cast<float>(it->second);
+}
+
+float DashboardStats::revenueToday() const {
+    lock_guard<mutex> guard(statsMutex);
+    auto it = revenueByDay.find(today());
+    return it == revenueByDay.end() ? 0 : static_cast<float>(it->second);
+}
+
+vector<Transaction> DashboardStats::recentLocked(size_t count) const {
+    count = min(count, recentCount);
+    vector<Transaction> newest;
+    newest.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        newest.push_back(recent[(recentNext + recentCapacity - 1 - i) % recentCapacity]);
+    }
+    return newest;
+}
+
+DashboardStats::Snapshot DashboardStats::snapshot(size_t recentTransactions) const {
+    Snapshot s;
+    s.lowStock = lowStock.load(memory_order_relaxed);
+    s.pendingPrescriptions = pending.load(memory_order_relaxed);
+    lock_guard<mutex> guard(statsMutex);
+    auto it = revenueByDay.find(today());
+    s.revenueToday = it == revenueByDay.end() ? 0 : static_cast<float>(it->second);
+    s.recent = recentLocked(recentTransactions);
+    return s;
+}
@@ -0,0 +1,73 @@
+#ifndef DASHBOARDSTATS_H
+#define DASHBOARDSTATS_H
+
+#include <array>
+#include <atomic>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Transaction.h"
+
+// Dashboard figures kept current by the controller as records change, so a
+// dashboard poll costs one short lock instead of scanning the tables:
+// revenue per day (paid transactions, keyed by day number), the
+// number of low-stock drugs and pending prescriptions, and a ring of the
+// most recent transactions. Today's day number is cached until local
+// midnight, when the lookup moves on to the new day.
+//
+// The internal lock is a leaf: callers may hold table locks, and nothing
+// else is locked while it is held.
+class DashboardStats {
+public:
+    static constexpr size_t recentCapacity = 16;
+
+    struct Snapshot {
+        float revenueToday = 0;
+        int lowStock = 0;
+        int pendingPrescriptions = 0;
+        std::vector<Transaction> recent;   // newest first, without signatures
+    };
+
+private:
+    mutable std::mutex statsMutex;
+    std::unordered_map<int, double> revenueByDay;
+    // The part of it from archived transactions, which never change
+    std::unordered_map<int, double> archivedRevenueByDay;
+    std::array<Transaction, recentCapacity> recent;
+    size_t recentNext;     // slot the next transaction goes into
+    size_t recentCount;
+    std::atomic<int> lowStock;
+    std::atomic<int> pending;
+    mutable int todayKey;
+    mutable time_t nextRollover;
+
+    // Callers hold statsMutex
+    int today() const;
+    void addRevenue(const Transaction& t, double sign);
+    std::vector<Transaction> recentLocked(size_t count) const;
+
+public:
+    DashboardStats();
+
+    // Recomputes everything from the hot tables (at startup and after
+    // archiving), on top of the revenue of archived transactions
+    void reset(const std::vector<Transaction>& transactions, int lowStockDrugs, int pendingPrescriptions);
+    // Counts rows [begin, end) as archived, so every later reset keeps
+    // their revenue: once per segment at startup, and for the rows each
+    // compaction moves out of the hot table
+    void addArchived(const std::vector<Transaction>& transactions, size_t begin, size_t end);
+
+    void transactionAdded(const Transaction& t);
+    // The same transaction before and after e.g. a payment
+    void transactionUpdated(const Transaction& before, const Transaction& after);
+    void adjustLowStock(int delta) { lowStock.fetch_add(delta, std::memory_order_relaxed); }
+    void adjustPending(int delta) { pending.fetch_add(delta, std::memory_order_relaxed); }
+
+    float revenueOn(int day) const;
+    float revenueToday() const;
+    Snapshot snapshot(size_t recentTransactions) const;
+};
+
+#endif
@@ -1,41 +1,391 @@
 #include "DataManager.h"
-#include <fstream>
-#include <sstream>
+#include "WriteAheadLog.h"
+#include "SnapshotFile.h"
+#include "CsvTokenizer.h"
+#include "Date.h"
 #include <iostream>
+#include <filesystem>
+#include <cstdio>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-//================================================================================
-// Helper to split string by delimiter
-//DONE
-vector<string> split(const string& s, char delimiter) {
-    vector<string> tokens;
-    string token;
-    istringstream tokenStream(s);
-    while (getline(tokenStream, token, delimiter)) {
-        tokens.push_back(token);
+// Compact once the log holds this many bytes of records
+static const size_t logCompactionThreshold = 4 * 1024 * 1024;
+
+// --- Row formats shared by the text files and the log ---
+// Rows are comma-separated; text fields are quoted when they contain a
+// comma, quote or line break (see CsvTokenizer.h).
+using Fields = vector<string_view>;
+
+static string formatUser(const User& u) {
+    string row;
+    appendCsvField(row, u.username);
+    row += ',';
+    appendCsvField(row, u.password);
+    row += ',';
+    row += to_string(static_cast<int>(u.role));
+    return row;
+}
+
+static bool parseUser(const Fields& parts, size_t first, User& u) {
+    int role;
+    if (parts.size() < first + 3 || !parseCsvInt(parts[first + 2], role)) return false;
+    u.username = string(parts[first]);
+    u.password = string(parts[first + 1]);
+    u.role = static_cast<UserRole>(role);
+    return true;
+}
+
+static string formatDrug(const Drug& d) {
+    string row;
+    appendCsvField(row, d.name);
+    row += ',';
+    appendCsvFloat(row, d.price);
+    row += ',' + to_string(d.quantity) + ',';
+    appendCsvField(row, d.expiryDate);
+    row += ',' + to_string(d.minThreshold);
+    return row;
+}
+
+static bool parseDrug(const Fields& parts, size_t first, Drug& d) {
+    if (parts.size() < first + 5
+        || !parseCsvFloat(parts[first + 1], d.price)
+        || !parseCsvInt(parts[first + 2], d.quantity)
+        || !parseCsvInt(parts[first + 4], d.minThreshold)) return false;
+    d.name = string(parts[first]);
+    d.expiryDate = string(parts[first + 3]);
+    return true;
+}
+
+static string formatPrescription(const Prescription& p) {
+    string row = to_string(p.id) + ',';
+    appendCsvField(row, p.doctorName);
+    row += ',';
+    appendCsvField(row, p.patientName);
+    row += ',';
+    appendCsvField(row, p.drugName);
+    row += ',' + to_string(p.quantity) + ',';
+    appendCsvField(row, p.date);
+    row += ',';
+    appendCsvField(row, p.status);
+    row += ',';
+    appendCsvField(row, p.diagnosis);
+    row += ',';
+    appendCsvField(row, p.signature);
+    return row;
+}
+
+static bool parsePrescription(const Fields& parts, size_t first, Prescription& p) {
+    if (parts.size() < first + 9
+        || !parseCsvInt(parts[first], p.id)
+        || !parseCsvInt(parts[first + 4], p.quantity)) return false;
+    p.doctorName = string(parts[first + 1]);
+    p.patientName = string(parts[first + 2]);
+    p.drugName = string(parts[first + 3]);
+    p.date = string(parts[first + 5]);
+    p.status = string(parts[first + 6]);
+    p.diagnosis = string(parts[first + 7]);
+    p.signature = string(parts[first + 8]);
+    return true;
+}
+
+static string formatTransaction(const Transaction& t) {
+    string row = to_string(t.id) + ',' + to_string(t.prescriptionId) + ',';
+    appendCsvFloat(row, t.amount);
+    row += ',';
+    appendCsvField(row, t.date);
+    row += ',';
+    appendCsvField(row, t.paymentMethod);
+    row += ',';
+    appendCsvField(row, t.signature);
+    return row;
+}
+
+static bool parseTransaction(const Fields& parts, size_t first, Transaction& t) {
+    if (parts.size() < first + 6
+        || !parseCsvInt(parts[first], t.id)
+        || !parseCsvInt(parts[first + 1], t.prescriptionId)
+        || !parseCsvFloat(parts[first + 2], t.amount)) return false;
+    t.date = string(parts[first + 3]);
+    t.paymentMethod = string(parts[first + 4]);
+    t.signature = string(parts[first + 5]);
+    return true;
+}
+
+static string formatLedgerSeal(const LedgerSeal& s) {
+    string row = to_string(s.count) + ',' + s.head + ',';
+    appendCsvField(row, s.signature);
+    return row;
+}
+
+static bool parseLedgerSeal(const Fields& parts, size_t first, LedgerSeal& s) {
+    if (parts.size() < first + 3 || !parseCsvSize(parts[first], s.count)) return false;
+    s.head = string(parts[first + 1]);
+    s.signature = string(parts[first + 2]);
+    return true;
+}
+
+// One manifest row: table ('P' or 'T') and its segment
+struct ManifestRow {
+    char table;
+    ArchiveSegment segment;
+};
+
+static string formatManifestRow(const ManifestRow& m) {
+    const ArchiveSegment& s = m.segment;
+    string row(1, m.table);
+    row += ',';
+    appendCsvField(row, s.file);
+    row += ',' + to_string(s.firstPos) + ',' + to_string(s.rows) + ',' + to_string(s.minDay) + ','
+           + to_string(s.maxDay) + ',' + to_string(s.maxId);
+    return row;
+}
+
+static bool parseManifestRow(const Fields& parts, size_t first, ManifestRow& m) {
+    ArchiveSegment& s = m.segment;
+    if (parts.size() < first + 7 || parts[first].size() != 1
+        || !parseCsvSize(parts[first + 2], s.firstPos)
+        || !parseCsvSize(parts[first + 3], s.rows)
+        || !parseCsvInt(parts[first + 4], s.minDay)
+        || !parseCsvInt(parts[first + 5], s.maxDay)
+        || !parseCsvInt(parts[first + 6], s.maxId)) return false;
+    m.table = parts[first][0];
+    s.file = string(parts[first + 1]);
+    return true;
+}
+
+template <typename T>
+static string formatTable(const vector<T>& rows, string (*format)(const T&)) {
+    string content;
+    for (const auto& row : rows) {
+        content += format(row);
+        content += '\n';
+    }
+    return content;
+}
+
+// Snapshots are written to a temporary file, flushed to disk and renamed
+// over the old one, so a crash never leaves a half-written file behind.
+static bool replaceFile(const string& path, const string& content) {
+    string tmpPath = path + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        cerr << "Error: cannot write " << tmpPath << "\n";
+        return false;
+    }
+    bool ok = fwrite(content.data(), 1, content.size(), f) == content.size() && fflush(f) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(f)) == 0;
+#else
+    ok = ok && fsync(fileno(f)) == 0;
+#endif
+    fclose(f);
+    if (!ok) {
+        cerr << "Error: failed to write " << tmpPath << "\n";
+        return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        cerr << "Error: cannot replace " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Tokenizes the whole file straight out of a read-only mapping; returns
+// false only if the file does not exist. Unparseable rows are skipped.
+template <typename T>
+static bool loadTextTable(const string& path, bool (*parse)(const Fields&, size_t, T&), vector<T>& rows) {
+    error_code ec;
+    if (!filesystem::exists(path, ec)) return false;
+    MappedFile file;
+    if (!file.open(path)) return true;   // empty file
+
+    CsvTokenizer tokenizer(string_view(file.data(), file.size()));
+    Fields fields;
+    while (tokenizer.nextRow(fields)) {
+        T row;
+        if (parse(fields, 0, row)) {
+            rows.push_back(move(row));
+        }
+    }
+    return true;
+}
+
+// --- Binary snapshot layouts (see SnapshotFile.h) ---
+// Function-local statics, because the global controller in main.cpp loads
+// snapshots before namespace-scope objects of this file may be constructed
+static const vector<ColumnKind>& drugColumns() {
+    static const vector<ColumnKind> columns = {
+        ColumnKind::String, ColumnKind::Float32, ColumnKind::Int32, ColumnKind::String, ColumnKind::Int32
+    };
+    return columns;
+}
+
+static const vector<ColumnKind>& prescriptionColumns() {
+    static const vector<ColumnKind> columns = {
+        ColumnKind::Int32, ColumnKind::String, ColumnKind::String, ColumnKind::String, ColumnKind::Int32,
+        ColumnKind::String, ColumnKind::String, ColumnKind::String, ColumnKind::String
+    };
+    return columns;
+}
+
+static const vector<ColumnKind>& transactionColumns() {
+    static const vector<ColumnKind> columns = {
+        ColumnKind::Int32, ColumnKind::Int32, ColumnKind::Float32, ColumnKind::String, ColumnKind::String,
+        ColumnKind::String
+    };
+    return columns;
+}
+
+// Encoders take a range of rows, so the hot part of a table and each
+// archive segment are written without copying them out first
+static string encodeDrugs(const vector<Drug>& drugs, size_t begin, size_t end) {
+    SnapshotWriter w('D', drugColumns(), end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        const Drug& d = drugs[i];
+        w.addString(0, d.name);
+        w.addFloat(1, d.price);
+        w.addInt(2, d.quantity);
+        w.addString(3, d.expiryDate);
+        w.addInt(4, d.minThreshold);
+        w.endRow();
     }
-    return tokens;
-}//=================================================================================
+    return w.encode();
+}
+
+static Drug drugAt(const SnapshotReader& r, size_t row) {
+    Drug d;
+    d.name = string(r.stringAt(0, row));
+    d.price = r.floatAt(1, row);
+    d.quantity = r.intAt(2, row);
+    d.expiryDate = string(r.stringAt(3, row));
+    d.minThreshold = r.intAt(4, row);
+    return d;
+}
+
+static string encodePrescriptions(const vector<Prescription>& prescriptions, size_t begin, size_t end) {
+    SnapshotWriter w('P', prescriptionColumns(), end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        const Prescription& p = prescriptions[i];
+        w.addInt(0, p.id);
+        w.addString(1, p.doctorName);
+        w.addString(2, p.patientName);
+        w.addString(3, p.drugName);
+        w.addInt(4, p.quantity);
+        w.addString(5, p.date);
+        w.addString(6, p.status);
+        w.addString(7, p.diagnosis);
+        w.addString(8, p.signature);
+        w.endRow();
+    }
+    return w.encode();
+}
+
+static Prescription prescriptionAt(const SnapshotReader& r, size_t row) {
+    Prescription p;
+    p.id = r.intAt(0, row);
+    p.doctorName = string(r.stringAt(1, row));
+    p.patientName = string(r.stringAt(2, row));
+    p.drugName = string(r.stringAt(3, row));
+    p.quantity = r.intAt(4, row);
+    p.date = string(r.stringAt(5, row));
+    p.status = string(r.stringAt(6, row));
+    p.diagnosis = string(r.stringAt(7, row));
+    p.signature = string(r.stringAt(8, row));
+    return p;
+}
+
+static string encodeTransactions(const vector<Transaction>& transactions, size_t begin, size_t end) {
+    SnapshotWriter w('T', transactionColumns(), end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        const Transaction& t = transactions[i];
+        w.addInt(0, t.id);
+        w.addInt(1, t.prescriptionId);
+        w.addFloat(2, t.amount);
+        w.addString(3, t.date);
+        w.addString(4, t.paymentMethod);
+        w.addString(5, t.signature);
+        w.endRow();
+    }
+    return w.encode();
+}
+
+static Transaction transactionAt(const SnapshotReader& r, size_t row) {
+    Transaction t;
+    t.id = r.intAt(0, row);
+    t.prescriptionId = r.intAt(1, row);
+    t.amount = r.floatAt(2, row);
+    t.date = string(r.stringAt(3, row));
+    t.paymentMethod = string(r.stringAt(4, row));
+    t.signature = string(r.stringAt(5, row));
+    return t;
+}
+
+// Copies every row out rather than serving them from the mapping: the
+// controller edits rows in place, replays the log into them and indexes
+// every one at startup anyway, and only the hot window is loaded (archived
+// segments are read on demand). SnapshotFileTest --bench puts the copy at
+// about 20 ms per 100,000 rows.
+template <typename T>
+static bool loadSnapshot(const string& path, char type, const vector<ColumnKind>& columns,
+                         T (*rowAt)(const SnapshotReader&, size_t), vector<T>& rows) {
+    SnapshotReader reader;
+    if (!reader.open(path, type, columns)) return false;
+    rows.reserve(reader.rowCount());
+    for (size_t i = 0; i < reader.rowCount(); ++i) {
+        rows.push_back(rowAt(reader, i));
+    }
+    return true;
+}
+
+// A table's snapshot is authoritative once it exists: returns false only
+// if there is none. One that exists but cannot be read stops the program,
+// leaving the file as it is, since importing the older .txt instead, or
+// letting the next compaction write over it, would lose its rows.
+template <typename T>
+static bool loadExistingSnapshot(const string& path, char type, const vector<ColumnKind>& columns,
+                                 T (*rowAt)(const SnapshotReader&, size_t), vector<T>& rows) {
+    error_code ec;
+    if (!filesystem::exists(path, ec) && !ec) return false;
+    if (!loadSnapshot(path, type, columns, rowAt, rows)) {
+        cerr << "Fatal: " << path << " exists but cannot be read; refusing to start. "
+             << "Restore it from a backup, or move it aside to start from the text files.\n";
+        exit(EXIT_FAILURE);
+    }
+    return true;
+}
+
+// replaceFile for encoded snapshots; "" means the encoder gave up
+static bool writeSnapshot(const string& path, const string& encoded) {
+    if (encoded.empty()) {
+        cerr << "Error: " << path << " not written\n";
+        return false;
+    }
+    return replaceFile(path, encoded);
+}
+
+static WriteAheadLog& writeAheadLog() {
+    static WriteAheadLog wal("hospital.wal");
+    return wal;
+}
 
 // --- Users ---
 vector<User> DataManager::loadUsers() {
     vector<User> users;
-    ifstream file("users.txt");
-    string line;
-    if (file.is_open()) {
-        while (getline(file, line)) {
-            auto parts = split(line, ',');
-            if (parts.size() >= 3) {
-                User u;
-                u.username = parts[0];
-                u.password = parts[1];
-                u.role = static_cast<UserRole>(stoi(parts[2]));
-                users.push_back(u);
-            }
-        }
-        file.close();
-    } else {
+    if (!loadTextTable("users.txt", parseUser, users)) {
         // Default admin if no file
         users.push_back({"admin", "admin123", UserRole::ADMIN});
         users.push_back({"doc", "1234", UserRole::DOCTOR});
@@ -47,33 +397,16 @@ vector<User> DataManager::loadUsers() {
 }
 
 void DataManager::saveUsers(const vector<User>& users) {
-    ofstream file("users.txt");
-    for (const auto& u : users) {
-        file << u.username << "," << u.password << "," << static_cast<int>(u.role) << "\n";
-    }
-    file.close();
+    replaceFile("users.txt", formatTable(users, formatUser));
 }
 
 // --- Drugs ---
+// The binary snapshot is authoritative once it exists; drugs.txt is only
+// read to import data from before the snapshot format.
 vector<Drug> DataManager::loadDrugs() {
     vector<Drug> drugs;
-    ifstream file("drugs.txt");
-    string line;
-    if (file.is_open()) {
-        while (getline(file, line)) {
-            auto parts = split(line, ',');
-            if (parts.size() >= 5) {
-                Drug d;
-                d.name = parts[0];
-                d.price = stof(parts[1]);
-                d.quantity = stoi(parts[2]);
-                d.expiryDate = parts[3];
-                d.minThreshold = stoi(parts[4]);
-                drugs.push_back(d);
-            }
-        }
-        file.close();
-    } else {
+    if (loadExistingSnapshot("drugs.snap", 'D', drugColumns(), drugAt, drugs)) return drugs;
+    if (!loadTextTable("drugs.txt", parseDrug, drugs)) {
         // File doesn't exist, start with empty inventory
         saveDrugs(drugs);
     }
@@ -98,79 +431,385 @@ bool DataManager::addDrug(const Drug& drug) {
 
 
 void DataManager::saveDrugs(const vector<Drug>& drugs) {
-    ofstream file("drugs.txt");
-    for (const auto& d : drugs) {
-        file << d.name << "," << d.price << "," << d.quantity << "," << d.expiryDate << "," << d.minThreshold << "\n";
-    }
-    file.close();
+    writeSnapshot("drugs.snap", encodeDrugs(drugs, 0, drugs.size()));
+}
+
+// The hot snapshot of a table whose first base rows are archived. Each
+// base gets its own file, so the old one stays valid until the manifest
+// naming the new base is on disk.
+static string hotSnapshotPath(const string& table, size_t base) {
+    return base == 0 ? table + ".snap" : table + "-" + to_string(base) + ".snap";
+}
+
+// The hot snapshot of an archived table must be there: compaction writes
+// it before the manifest that names its base.
+static void requireSnapshot(const string& path) {
+    cerr << "Fatal: " << path << " is missing; refusing to start.\n";
+    exit(EXIT_FAILURE);
 }
 
 // --- Prescriptions ---
-vector<Prescription> DataManager::loadPrescriptions() {
+// The legacy text file only ever holds a table with nothing archived
+vector<Prescription> DataManager::loadPrescriptions(size_t base) {
     vector<Prescription> prescriptions;
-    ifstream file("prescriptions.txt");
-    string line;
-    if (file.is_open()) {
-        while (getline(file, line)) {
-            auto parts = split(line, ',');
-            if (parts.size() >= 9) {
-                Prescription p;
-                p.id = stoi(parts[0]);
-                p.doctorName = parts[1];
-                p.patientName = parts[2];
-                p.drugName = parts[3];
-                p.quantity = stoi(parts[4]);
-                p.date = parts[5];
-                p.status = parts[6];
-                p.diagnosis = parts[7];
-                p.signature = parts[8];
-                prescriptions.push_back(p);
-            }
-        }
-        file.close();
+    string path = hotSnapshotPath("prescriptions", base);
+    if (!loadExistingSnapshot(path, 'P', prescriptionColumns(), prescriptionAt, prescriptions)) {
+        if (base != 0) requireSnapshot(path);
+        loadTextTable("prescriptions.txt", parsePrescription, prescriptions);
     }
     return prescriptions;
 }
 
-void DataManager::savePrescriptions(const vector<Prescription>& prescriptions) {
-    ofstream file("prescriptions.txt");
-    for (const auto& p : prescriptions) {
-        file << p.id << "," << p.doctorName << "," << p.patientName << "," 
-             << p.drugName << "," << p.quantity << "," << p.date << "," 
-             << p.status << "," << p.diagnosis << "," << p.signature << "\n";
-    }
-    file.close();
+void DataManager::savePrescriptions(const vector<Prescription>& prescriptions, size_t base) {
+    writeSnapshot(hotSnapshotPath("prescriptions", base), encodePrescriptions(prescriptions, 0, prescriptions.size()));
 }
 
 // --- Transactions ---
-vector<Transaction> DataManager::loadTransactions() {
+vector<Transaction> DataManager::loadTransactions(size_t base) {
     vector<Transaction> transactions;
-    ifstream file("transactions.txt");
-    string line;
-    if (file.is_open()) {
-        while (getline(file, line)) {
-            auto parts = split(line, ',');
-            if (parts.size() >= 6) {
-                Transaction t;
-                t.id = stoi(parts[0]);
-                t.prescriptionId = stoi(parts[1]);
-                t.amount = stof(parts[2]);
-                t.date = parts[3];
-                t.paymentMethod = parts[4];
-                t.signature = parts[5];
-                transactions.push_back(t);
-            }
-        }
-        file.close();
+    string path = hotSnapshotPath("transactions", base);
+    if (!loadExistingSnapshot(path, 'T', transactionColumns(), transactionAt, transactions)) {
+        if (base != 0) requireSnapshot(path);
+        loadTextTable("transactions.txt", parseTransaction, transactions);
     }
     return transactions;
 }
 
-void DataManager::saveTransactions(const vector<Transaction>& transactions) {
-    ofstream file("transactions.txt");
-    for (const auto& t : transactions) {
-        file << t.id << "," << t.prescriptionId << "," << t.amount << "," 
-             << t.date << "," << t.paymentMethod << "," << t.signature << "\n";
+void DataManager::saveTransactions(const vector<Transaction>& transactions, size_t base) {
+    writeSnapshot(hotSnapshotPath("transactions", base), encodeTransactions(transactions, 0, transactions.size()));
+}
+
+// --- Ledger seals ---
+// A few rows per thousand transactions, so plain text is fine
+vector<LedgerSeal> DataManager::loadLedgerSeals() {
+    vector<LedgerSeal> seals;
+    loadTextTable("ledger.txt", parseLedgerSeal, seals);
+    return seals;
+}
+
+void DataManager::saveLedgerSeals(const vector<LedgerSeal>& seals) {
+    replaceFile("ledger.txt", formatTable(seals, formatLedgerSeal));
+}
+
+// --- Archive ---
+// Settled months of prescriptions and transactions, one snapshot file per
+// segment, listed in the manifest. Segment files are written once and
+// never changed; a new manifest only ever adds segments.
+static const char archiveDirectory[] = "archive/";
+static const char archiveManifestPath[] = "archive/manifest.txt";
+
+static string formatManifest(const ArchiveManifest& manifest) {
+    vector<ManifestRow> rows;
+    for (const auto& s : manifest.prescriptions) rows.push_back({'P', s});
+    for (const auto& s : manifest.transactions) rows.push_back({'T', s});
+    return formatTable(rows, formatManifestRow);
+}
+
+ArchiveManifest DataManager::loadArchiveManifest() {
+    ArchiveManifest manifest;
+    vector<ManifestRow> rows;
+    loadTextTable(archiveManifestPath, parseManifestRow, rows);
+    for (const auto& row : rows) {
+        vector<ArchiveSegment>* segments = row.table == 'P' ? &manifest.prescriptions
+                                           : row.table == 'T' ? &manifest.transactions : nullptr;
+        // Positions would no longer line up with the log after a gap
+        if (!segments || row.segment.firstPos != ArchiveManifest::baseOf(*segments)) {
+            cerr << "Warning: archive manifest entry " << row.segment.file << " ignored\n";
+            continue;
+        }
+        segments->push_back(row.segment);
+    }
+    return manifest;
+}
+
+static bool equalsIgnoringCase(string_view a, string_view b) {
+    return a.size() == b.size() && equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+        return tolower(x) == tolower(y);
+    });
+}
+
+static bool openSegment(const ArchiveSegment& segment, char type, const vector<ColumnKind>& columns,
+                        SnapshotReader& reader) {
+    if (reader.open(archiveDirectory + segment.file, type, columns)) return true;
+    cerr << "Error: cannot read archive segment " << segment.file << "\n";
+    return false;
+}
+
+bool DataManager::readArchivedPrescriptions(const ArchiveSegment& segment, int fromDay, int toDay,
+                                            const string& patient, vector<Prescription>& rows) {
+    SnapshotReader reader;
+    if (!openSegment(segment, 'P', prescriptionColumns(), reader)) return false;
+    for (size_t i = 0; i < reader.rowCount(); ++i) {
+        int day = Date::parse(reader.stringAt(5, i));
+        if (day < fromDay || day > toDay) continue;
+        if (!patient.empty() && !equalsIgnoringCase(reader.stringAt(2, i), patient)) continue;
+        rows.push_back(prescriptionAt(reader, i));
+        rows.back().day = day;
+    }
+    return true;
+}
+
+bool DataManager::readArchivedTransactions(const ArchiveSegment& segment, int fromDay, int toDay,
+                                           vector<Transaction>& rows) {
+    SnapshotReader reader;
+    if (!openSegment(segment, 'T', transactionColumns(), reader)) return false;
+    for (size_t i = 0; i < reader.rowCount(); ++i) {
+        int day = Date::parse(reader.stringAt(3, i));
+        if (day < fromDay || day > toDay) continue;
+        rows.push_back(transactionAt(reader, i));
+        rows.back().day = day;
+    }
+    return true;
+}
+
+bool DataManager::findArchivedTransaction(const vector<ArchiveSegment>& segments, int id, size_t& pos) {
+    for (const auto& segment : segments) {
+        if (segment.maxId < id) continue;
+        SnapshotReader reader;
+        if (!openSegment(segment, 'T', transactionColumns(), reader)) continue;
+        for (size_t i = 0; i < reader.rowCount(); ++i) {
+            if (reader.intAt(0, i) != id) continue;
+            pos = segment.firstPos + i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Year * 12 + month - 1, or -1 for an undated row
+static int monthOf(int day) {
+    if (day == Date::invalid) return -1;
+    int year, month, dayOfMonth;
+    Date::toCivil(day, year, month, dayOfMonth);
+    return year * 12 + month - 1;
+}
+
+// Writes rows [0, count) of a hot table starting at position base as
+// segments of one month each, in table order. A row dated out of order
+// starts a new segment; undated rows join the one they fall in.
+template <typename T>
+static bool writeArchiveSegments(const string& table, const vector<T>& rows, size_t count, size_t base,
+                                 string (*encode)(const vector<T>&, size_t, size_t),
+                                 vector<ArchiveSegment>& segments) {
+    size_t begin = 0;
+    while (begin < count) {
+        ArchiveSegment s;
+        s.firstPos = base + begin;
+        s.minDay = INT_MAX;
+        s.maxDay = INT_MIN;
+        int month = -1;
+        size_t end = begin;
+        for (; end < count; ++end) {
+            int m = monthOf(rows[end].day);
+            if (m != -1 && month != -1 && m != month) break;
+            if (month == -1) month = m;
+            s.minDay = min(s.minDay, rows[end].day);
+            s.maxDay = max(s.maxDay, rows[end].day);
+            s.maxId = max(s.maxId, rows[end].id);
+        }
+        s.rows = end - begin;
+
+        char period[16] = "undated";
+        if (month != -1) snprintf(period, sizeof(period), "%04d-%02d", month / 12, month % 12 + 1);
+        s.file = table + "-" + period + "-" + to_string(s.firstPos) + ".snap";
+        if (!writeSnapshot(archiveDirectory + s.file, encode(rows, begin, end))) return false;
+        segments.push_back(s);
+        begin = end;
+    }
+    return true;
+}
+
+// --- Snapshot conversion ---
+// base is the number of the table's rows already archived. The text file
+// only ever held a whole table, so once any of it is archived the file was
+// imported long ago and its rows would shadow the archive if converted.
+template <typename T>
+static void convertTable(const string& name, size_t base, char type, const vector<ColumnKind>& columns,
+                         bool (*parse)(const Fields&, size_t, T&),
+                         T (*rowAt)(const SnapshotReader&, size_t),
+                         string (*encode)(const vector<T>&, size_t, size_t)) {
+    using Clock = chrono::steady_clock;
+    string textPath = name + ".txt";
+    string snapPath = hotSnapshotPath(name, base);
+    if (base != 0) {
+        cout << name << ": " << base << " rows archived, so " << textPath
+             << " was imported already; skipped\n";
+        return;
+    }
+
+    vector<T> fromText;
+    auto start = Clock::now();
+    if (!loadTextTable(textPath, parse, fromText)) {
+        cout << textPath << ": not found, skipped\n";
+        return;
+    }
+    double textMs = chrono::duration<double, milli>(Clock::now() - start).count();
+    error_code ec;
+    double textMB = filesystem::file_size(textPath, ec) / (1024.0 * 1024.0);
+
+    if (filesystem::exists(snapPath)) {
+        cout << snapPath << ": already exists, left unchanged\n";
+    } else if (!writeSnapshot(snapPath, encode(fromText, 0, fromText.size()))) {
+        return;
+    }
+
+    vector<T> fromSnapshot;
+    start = Clock::now();
+    loadSnapshot(snapPath, type, columns, rowAt, fromSnapshot);
+    double snapMs = chrono::duration<double, milli>(Clock::now() - start).count();
+
+    cout << name << ": " << fromText.size() << " rows as text in " << textMs << " ms ("
+         << (textMs > 0 ? textMB * 1000.0 / textMs : 0.0) << " MB/s), "
+         << fromSnapshot.size() << " rows from snapshot in " << snapMs << " ms\n";
+}
+
+void DataManager::convertToSnapshots() {
+    ArchiveManifest archive = loadArchiveManifest();
+    convertTable<Drug>("drugs", 0, 'D', drugColumns(), parseDrug, drugAt, encodeDrugs);
+    convertTable<Prescription>("prescriptions", archive.prescriptionBase(), 'P', prescriptionColumns(),
+                               parsePrescription, prescriptionAt, encodePrescriptions);
+    convertTable<Transaction>("transactions", archive.transactionBase(), 'T', transactionColumns(),
+                              parseTransaction, transactionAt, encodeTransactions);
+}
+
+// --- Write-ahead log ---
+uint64_t DataManager::logUser(size_t pos, const User& user) {
+    return writeAheadLog().append('U', to_string(pos) + "," + formatUser(user));
+}
+
+uint64_t DataManager::logDrug(size_t pos, const Drug& drug) {
+    return writeAheadLog().append('D', to_string(pos) + "," + formatDrug(drug));
+}
+
+uint64_t DataManager::logDrug(size_t pos, const function<Drug()>& current) {
+    return writeAheadLog().append('D', [&] { return to_string(pos) + "," + formatDrug(current()); });
+}
+
+uint64_t DataManager::logPrescription(size_t pos, const Prescription& p) {
+    return writeAheadLog().append('P', to_string(pos) + "," + formatPrescription(p));
+}
+
+uint64_t DataManager::logTransaction(size_t pos, const Transaction& t) {
+    return writeAheadLog().append('T', to_string(pos) + "," + formatTransaction(t));
+}
+
+uint64_t DataManager::logLedgerSeal(size_t batch, const LedgerSeal& seal) {
+    return writeAheadLog().append('L', to_string(batch) + "," + formatLedgerSeal(seal));
+}
+
+bool DataManager::commitLog(uint64_t seq) {
+    return writeAheadLog().waitDurable(seq);
+}
+
+void DataManager::configureGroupCommit(int maxDelayMicros, size_t maxBatchRecords) {
+    writeAheadLog().setGroupCommit(chrono::microseconds(maxDelayMicros), maxBatchRecords);
+}
+
+// Records carry full rows, so applying one overwrites the row at its
+// position or appends it. Replaying a record twice (e.g. after a crash
+// between writing snapshots and truncating the log) is harmless.
+template <typename T>
+static void applyRecord(vector<T>& rows, size_t pos, const T& row) {
+    if (pos < rows.size()) {
+        rows[pos] = row;
+    } else if (pos == rows.size()) {
+        rows.push_back(row);
+    } else {
+        cerr << "Warning: write-ahead log record beyond end of table ignored\n";
+    }
+}
+
+size_t DataManager::replayLog(vector<User>& users, vector<Drug>& drugs,
+                              vector<Prescription>& prescriptions, size_t prescriptionBase,
+                              vector<Transaction>& transactions, size_t transactionBase,
+                              vector<LedgerSeal>& seals) {
+    return writeAheadLog().replay([&](char type, const string& payload) {
+        CsvTokenizer tokenizer(payload);
+        Fields parts;
+        size_t pos;
+        bool ok = tokenizer.nextRow(parts) && parseCsvSize(parts[0], pos);
+        if (ok) {
+            switch (type) {
+                case 'U': { User u; if ((ok = parseUser(parts, 1, u))) applyRecord(users, pos, u); break; }
+                case 'D': { Drug d; if ((ok = parseDrug(parts, 1, d))) applyRecord(drugs, pos, d); break; }
+                // Archived rows are settled; a record for one predates the archiving
+                case 'P': {
+                    Prescription p;
+                    if ((ok = parsePrescription(parts, 1, p)) && pos >= prescriptionBase) {
+                        applyRecord(prescriptions, pos - prescriptionBase, p);
+                    }
+                    break;
+                }
+                case 'T': {
+                    Transaction t;
+                    if ((ok = parseTransaction(parts, 1, t)) && pos >= transactionBase) {
+                        applyRecord(transactions, pos - transactionBase, t);
+                    }
+                    break;
+                }
+                case 'L': { LedgerSeal l; if ((ok = parseLedgerSeal(parts, 1, l))) applyRecord(seals, pos, l); break; }
+                default:
+                    cerr << "Warning: unknown write-ahead log record '" << type << "'\n";
+                    return;
+            }
+        }
+        if (!ok) cerr << "Warning: malformed write-ahead log record skipped\n";
+    });
+}
+
+bool DataManager::logNeedsCompaction() {
+    return writeAheadLog().size() > logCompactionThreshold;
+}
+
+// Archiving writes the new segments, then the hot snapshots under their new
+// base, then the manifest. A crash before the manifest is replaced leaves
+// the old manifest, whose hot snapshots are only deleted afterwards; one
+// after it leaves log records for archived positions, which replay skips.
+bool DataManager::compact(const vector<User>& users, const vector<Drug>& drugs,
+                          const vector<Prescription>& prescriptions, size_t archivePrescriptions,
+                          const vector<Transaction>& transactions, size_t archiveTransactions,
+                          const vector<LedgerSeal>& seals, ArchiveManifest& manifest) {
+    writeAheadLog().sync();
+    ArchiveManifest next = manifest;
+    bool archiving = archivePrescriptions > 0 || archiveTransactions > 0;
+    if (archiving) {
+        error_code ec;
+        filesystem::create_directories(archiveDirectory, ec);
+        archiving = !ec
+                    && writeArchiveSegments("prescriptions", prescriptions, archivePrescriptions,
+                                            manifest.prescriptionBase(), encodePrescriptions, next.prescriptions)
+                    && writeArchiveSegments("transactions", transactions, archiveTransactions,
+                                            manifest.transactionBase(), encodeTransactions, next.transactions);
+        if (!archiving) {
+            cerr << "Warning: archiving failed, keeping all rows in the hot tables\n";
+            next = manifest;
+            archivePrescriptions = archiveTransactions = 0;
+        }
+    }
+
+    bool ok = replaceFile("users.txt", formatTable(users, formatUser))
+              && writeSnapshot("drugs.snap", encodeDrugs(drugs, 0, drugs.size()))
+              && writeSnapshot(hotSnapshotPath("prescriptions", next.prescriptionBase()),
+                               encodePrescriptions(prescriptions, archivePrescriptions, prescriptions.size()))
+              && writeSnapshot(hotSnapshotPath("transactions", next.transactionBase()),
+                               encodeTransactions(transactions, archiveTransactions, transactions.size()))
+              && replaceFile("ledger.txt", formatTable(seals, formatLedgerSeal))
+              && (!archiving || replaceFile(archiveManifestPath, formatManifest(next)));
+    // Until every snapshot is on disk the log is still the only full record
+    if (!ok) {
+        cerr << "Warning: compaction incomplete, keeping write-ahead log\n";
+        return false;
+    }
+    if (archiving) {
+        error_code ec;
+        if (next.prescriptionBase() != manifest.prescriptionBase()) {
+            filesystem::remove(hotSnapshotPath("prescriptions", manifest.prescriptionBase()), ec);
+        }
+        if (next.transactionBase() != manifest.transactionBase()) {
+            filesystem::remove(hotSnapshotPath("transactions", manifest.transactionBase()), ec);
+        }
+        manifest = next;
     }
-    file.close();
+    writeAheadLog().reset();
+    return archiving;
 }
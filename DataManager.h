@@ -3,10 +3,14 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <functional>
 #include "User.h"
 #include "Drug.h"
 #include "Prescription.h"
 #include "Transaction.h"
+#include "LedgerSeal.h"
+#include "ArchiveSegment.h"
 
 class DataManager {
 public:
@@ -17,11 +21,76 @@ public:
     static bool addDrug(const Drug& drug);
     static void saveDrugs(const std::vector<Drug>& drugs);
 
-    static std::vector<Prescription> loadPrescriptions();
-    static void savePrescriptions(const std::vector<Prescription>& prescriptions);
+    // The hot part of a table: rows from position base on, where base is
+    // the end of its archive (see ArchiveManifest)
+    static std::vector<Prescription> loadPrescriptions(size_t base = 0);
+    static void savePrescriptions(const std::vector<Prescription>& prescriptions, size_t base = 0);
 
-    static std::vector<Transaction> loadTransactions();
-    static void saveTransactions(const std::vector<Transaction>& transactions);
+    static std::vector<Transaction> loadTransactions(size_t base = 0);
+    static void saveTransactions(const std::vector<Transaction>& transactions, size_t base = 0);
+
+    // --- Archive ---
+    // Empty if nothing has been archived yet
+    static ArchiveManifest loadArchiveManifest();
+    // Appends the segment's rows dated fromDay..toDay (and, unless patient
+    // is empty, written for that patient, ignoring case) with their day
+    // numbers set. The file is mapped read-only for the call and only
+    // matching rows are decoded. False if it cannot be read.
+    static bool readArchivedPrescriptions(const ArchiveSegment& segment, int fromDay, int toDay,
+                                          const std::string& patient, std::vector<Prescription>& rows);
+    static bool readArchivedTransactions(const ArchiveSegment& segment, int fromDay, int toDay,
+                                         std::vector<Transaction>& rows);
+    // Table position of the archived transaction with this id, found by
+    // reading only the id column of segments whose ids reach it
+    static bool findArchivedTransaction(const std::vector<ArchiveSegment>& segments, int id, size_t& pos);
+
+    // Seals of the transaction ledger, one row per batch (ledger.txt)
+    static std::vector<LedgerSeal> loadLedgerSeals();
+    static void saveLedgerSeals(const std::vector<LedgerSeal>& seals);
+
+    // Drugs, prescriptions and transactions are snapshotted in the binary
+    // columnar format (*.snap). This imports each legacy *.txt file that has
+    // no snapshot yet and reports text vs snapshot load times. Tables with
+    // archived rows are skipped. Run it while no controller exists, since
+    // a controller's startup rewrites these files.
+    static void convertToSnapshots();
+
+    // --- Write-ahead log ---
+    // Mutations are appended as records keyed by their position in the
+    // in-memory vector. Each log* call returns a sequence number; commitLog
+    // blocks until that record (and everything before it) is durable. The
+    // snapshot files above are rewritten only when the log is compacted.
+    static uint64_t logUser(size_t pos, const User& user);
+    static uint64_t logDrug(size_t pos, const Drug& drug);
+    // Reads the row only once its place in the log is fixed; used for stock
+    // changes that do not hold the drugs lock exclusively
+    static uint64_t logDrug(size_t pos, const std::function<Drug()>& current);
+    static uint64_t logPrescription(size_t pos, const Prescription& p);
+    static uint64_t logTransaction(size_t pos, const Transaction& t);
+    static uint64_t logLedgerSeal(size_t batch, const LedgerSeal& seal);
+    static bool commitLog(uint64_t seq);
+    // Commits from concurrent callers are batched into one fsync. A batch is
+    // written after at most maxDelayMicros or once maxBatchRecords are queued.
+    static void configureGroupCommit(int maxDelayMicros, size_t maxBatchRecords);
+
+    // Re-applies logged mutations on top of freshly loaded snapshots.
+    // Prescription and transaction records carry table positions, so the
+    // hot tables are passed with their archive bases; records for archived
+    // positions are already in the archive and are skipped.
+    static size_t replayLog(std::vector<User>& users, std::vector<Drug>& drugs,
+                            std::vector<Prescription>& prescriptions, size_t prescriptionBase,
+                            std::vector<Transaction>& transactions, size_t transactionBase,
+                            std::vector<LedgerSeal>& seals);
+    static bool logNeedsCompaction();
+    // Writes new snapshots of every file, then truncates the log. The first
+    // archivePrescriptions and archiveTransactions rows of the hot tables
+    // are moved into new archive segments first; the manifest is the commit
+    // point. Returns true if they were archived (and manifest updated),
+    // false if they stay in the hot tables.
+    static bool compact(const std::vector<User>& users, const std::vector<Drug>& drugs,
+                        const std::vector<Prescription>& prescriptions, size_t archivePrescriptions,
+                        const std::vector<Transaction>& transactions, size_t archiveTransactions,
+                        const std::vector<LedgerSeal>& seals, ArchiveManifest& manifest);
 };
 
 #endif
@@ -0,0 +1,62 @@
+#include "Date.h"
+#include <ctime>
+
+namespace Date {
+
+// Proleptic Gregorian calendar, valid for any year
+int fromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void toCivil(int dayNumber, int& year, int& month, int& day) {
+    int z = dayNumber + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = yoe + era * 400 + (month <= 2);
+}
+
+static bool isLeap(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int parse(std::string_view s) {
+    if (s.size() != 10 || s[2] != '/' || s[5] != '/') return invalid;
+    int parts[3] = {0, 0, 0};
+    const int starts[3] = {0, 3, 6};
+    const int lengths[3] = {2, 2, 4};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < lengths[i]; ++j) {
+            char c = s[starts[i] + j];
+            if (c < '0' || c > '9') return invalid;
+            parts[i] = parts[i] * 10 + (c - '0');
+        }
+    }
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int day = parts[0], month = parts[1], year = parts[2];
+    if (month < 1 || month > 12 || day < 1) return invalid;
+    if (day > monthDays[month - 1] + (month == 2 && isLeap(year))) return invalid;
+    return fromCivil(year, month, day);
+}
+
+int today() {
+    time_t now = time(nullptr);
+    tm local;
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    return fromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef DATE_H
+#define DATE_H
+
+#include <climits>
+#include <string_view>
+
+// Calendar dates as day numbers (days since 1970-01-01), so they compare
+// and subtract as plain ints. Records keep their "DD/MM/YYYY" strings for
+// storage and signatures; the day number is parsed once, when a record is
+// loaded or created.
+namespace Date {
+    const int invalid = INT_MIN;   // sorts before every real date
+
+    // "DD/MM/YYYY" to a day number, or invalid if malformed
+    int parse(std::string_view ddmmyyyy);
+    int fromCivil(int year, int month, int day);
+    // The inverse of fromCivil
+    void toCivil(int dayNumber, int& year, int& month, int& day);
+    // Today in local time
+    int today();
+}
+
+#endif
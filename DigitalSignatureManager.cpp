@@ -1,201 +1,117 @@
 #include "DigitalSignatureManager.h"
+#include "CryptoApiSignatureBackend.h"
+#include "OpenSslSignatureBackend.h"
+#include "Base64.h"
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <future>
+#include <algorithm>
 
 using namespace std;
 
-// Base64 encoding table
-static const string base64_chars = 
-             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-             "abcdefghijklmnopqrstuvwxyz"
-             "0123456789+/";
-
-DigitalSignatureManager::DigitalSignatureManager() : hProv(0), hKey(0) {}
-
-DigitalSignatureManager::~DigitalSignatureManager() {
-    if (hKey) CryptDestroyKey(hKey);
-    if (hProv) CryptReleaseContext(hProv, 0);
+unique_ptr<SignatureBackend> createDefaultSignatureBackend() {
+#ifdef _WIN32
+    return make_unique<CryptoApiSignatureBackend>();
+#else
+    return make_unique<OpenSslSignatureBackend>();
+#endif
 }
 
-bool DigitalSignatureManager::init() {
-    const char* containerName = "HospitalSystemKeyContainer";
-    
-    // Try to acquire context for existing container
-    if (!CryptAcquireContext(&hProv, containerName, NULL, PROV_RSA_AES, 0)) {
-        // If doesn't exist, create it
-        if (GetLastError() == NTE_BAD_KEYSET) {
-            if (!CryptAcquireContext(&hProv, containerName, NULL, PROV_RSA_AES, CRYPT_NEWKEYSET)) {
-                cerr << "Error creating key container: " << GetLastError() << "\n";
-                return false;
-            }
-        } else {
-            cerr << "Error acquiring context: " << GetLastError() << "\n";
-            return false;
-        }
-    }
+DigitalSignatureManager::DigitalSignatureManager()
+    : DigitalSignatureManager(createDefaultSignatureBackend()) {}
 
-    // Try to get the signature key
-    if (!CryptGetUserKey(hProv, AT_SIGNATURE, &hKey)) {
-        if (GetLastError() == NTE_NO_KEY) {
-            // Generate if not found
-            if (!CryptGenKey(hProv, AT_SIGNATURE, CRYPT_EXPORTABLE, &hKey)) {
-                cerr << "Error generating key: " << GetLastError() << "\n";
-                return false;
-            }
-        } else {
-            cerr << "Error getting user key: " << GetLastError() << "\n";
-            return false;
-        }
-    }
+DigitalSignatureManager::DigitalSignatureManager(unique_ptr<SignatureBackend> b)
+    : backend(move(b)), cacheCapacity(4096) {}
 
-    return true;
+bool DigitalSignatureManager::init() {
+    return backend->init();
 }
 
 string DigitalSignatureManager::signData(const string& data) {
-    HCRYPTHASH hHash = 0;
-    string signature = "";
-
-    if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash)) {
-        cerr << "Error during CryptCreateHash." << endl;
-        return "";
-    }
-
-    if (!CryptHashData(hHash, (BYTE*)data.c_str(), data.length(), 0)) {
-        cerr << "Error during CryptHashData." << endl;
-        CryptDestroyHash(hHash);
-        return "";
-    }
-
-    DWORD dwSigLen = 0;
-    if (!CryptSignHash(hHash, AT_SIGNATURE, NULL, 0, NULL, &dwSigLen)) {
-        cerr << "Error during CryptSignHash (length)." << endl;
-        CryptDestroyHash(hHash);
-        return "";
-    }
-
-    vector<BYTE> pbSignature(dwSigLen);
-    if (!CryptSignHash(hHash, AT_SIGNATURE, NULL, 0, pbSignature.data(), &dwSigLen)) {
-        cerr << "Error during CryptSignHash (data)." << endl;
-        CryptDestroyHash(hHash);
-        return "";
-    }
-
-    signature = base64Encode(pbSignature);
-    CryptDestroyHash(hHash);
-    return signature;
+    vector<unsigned char> signature = backend->sign(data);
+    if (signature.empty()) return "";
+    return base64Encode(signature.data(), signature.size());
 }
 
 bool DigitalSignatureManager::verifySignature(const string& data, const string& signatureBase64) {
-    HCRYPTHASH hHash = 0;
-    HCRYPTKEY hPubKey = 0; // We would normally load the public key here. 
-                           // For this demo, since we are in the same session/object, we use the key pair we generated.
-                           // In a real scenario, you'd export the public key and import it for verification.
-                           // However, since we are verifying within the same running instance for this demo (or assuming shared key access),
-                           // we will use the existing hKey which contains the public key part.
-                           
-    // Note: In a real distributed system, the verifier needs the signer's PUBLIC key.
-    // Here we assume the controller holds the key pair for the "Hospital System Authority".
-
-    if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash)) {
-        return false;
-    }
-
-    if (!CryptHashData(hHash, (BYTE*)data.c_str(), data.length(), 0)) {
-        CryptDestroyHash(hHash);
-        return false;
-    }
-
-    vector<BYTE> pbSignature = base64Decode(signatureBase64);
-
-    if (!CryptVerifySignature(hHash, pbSignature.data(), pbSignature.size(), hKey, NULL, 0)) {
-        // cerr << "Signature verification failed." << endl; // Optional logging
-        CryptDestroyHash(hHash);
-        return false;
-    }
+    vector<unsigned char> signature;
+    if (!base64Decode(signatureBase64, signature)) return false;
+    return verifyDecoded(data, signature);
+}
 
-    CryptDestroyHash(hHash);
+bool DigitalSignatureManager::verifyDecoded(const string& data, const vector<unsigned char>& signature) {
+    if (signature.empty()) return false;
+    string key = cacheKey(data, signature);
+    if (!key.empty() && cachedAsValid(key)) return true;
+    if (!backend->verify(data, signature)) return false;
+    if (!key.empty()) rememberValid(key);
     return true;
 }
 
-string DigitalSignatureManager::base64Encode(const vector<BYTE>& data) {
-    string ret;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    size_t dataLen = data.size();
-    size_t idx = 0;
-
-    while (dataLen--) {
-        char_array_3[i++] = data[idx++];
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for(i = 0; (i <4) ; i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
+vector<bool> DigitalSignatureManager::verifyBatch(const vector<pair<string, string>>& items) {
+    vector<bool> results(items.size());
+    if (items.empty()) return results;
+
+    // Signature checks are independent, so contiguous slices of the batch
+    // run on separate threads; small batches stay on the caller's thread
+    const size_t minPerTask = 64;
+    size_t tasks = min<size_t>(max(1u, thread::hardware_concurrency()),
+                               (items.size() + minPerTask - 1) / minPerTask);
+    size_t perTask = (items.size() + tasks - 1) / tasks;
+
+    vector<char> valid(items.size());   // vector<bool> is not safe to fill in parallel
+    auto verifyRange = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            valid[i] = verifySignature(items[i].first, items[i].second);
         }
-    }
-
-    if (i) {
-        for(j = i; j < 3; j++)
-            char_array_3[j] = '\0';
-
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+    };
 
-        for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
-
-        while((i++ < 3))
-            ret += '=';
+    vector<future<void>> running;
+    for (size_t t = 1; t < tasks; ++t) {
+        running.push_back(async(launch::async, verifyRange, t * perTask, min(items.size(), (t + 1) * perTask)));
     }
+    verifyRange(0, min(items.size(), perTask));
+    for (auto& f : running) f.get();
 
-    return ret;
+    for (size_t i = 0; i < items.size(); ++i) results[i] = valid[i] != 0;
+    return results;
 }
 
-vector<BYTE> DigitalSignatureManager::base64Decode(const string& encoded_string) {
-    size_t in_len = encoded_string.size();
-    int i = 0;
-    int j = 0;
-    int in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3];
-    vector<BYTE> ret;
-
-    while (in_len-- && ( encoded_string[in_] != '=') && (isalnum(encoded_string[in_]) || (encoded_string[in_] == '+') || (encoded_string[in_] == '/'))) {
-        char_array_4[i++] = encoded_string[in_]; in_++;
-        if (i ==4) {
-            for (i = 0; i <4; i++)
-                char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-            for (i = 0; (i < 3); i++)
-                ret.push_back(char_array_3[i]);
-            i = 0;
-        }
-    }
+// --- Verified-signature cache ---
 
-    if (i) {
-        for (j = i; j <4; j++)
-            char_array_4[j] = 0;
+void DigitalSignatureManager::setCacheCapacity(size_t entries) {
+    lock_guard<mutex> guard(cacheMutex);
+    cacheCapacity = entries;
+    while (cacheOrder.size() > cacheCapacity) {
+        cacheEntries.erase(cacheOrder.back());
+        cacheOrder.pop_back();
+    }
+}
 
-        for (j = 0; j <4; j++)
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
+// The length prefix keeps (data, signature) splits from colliding
+string DigitalSignatureManager::cacheKey(const string& data, const vector<unsigned char>& signature) {
+    string material = to_string(data.size()) + ':' + data;
+    material.append(signature.begin(), signature.end());
+    vector<unsigned char> d = backend->digest(material);
+    return string(d.begin(), d.end());
+}
 
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+bool DigitalSignatureManager::cachedAsValid(const string& key) {
+    lock_guard<mutex> guard(cacheMutex);
+    auto it = cacheEntries.find(key);
+    if (it == cacheEntries.end()) return false;
+    cacheOrder.splice(cacheOrder.begin(), cacheOrder, it->second);
+    return true;
+}
 
-        for (j = 0; (j < i - 1); j++) ret.push_back(char_array_3[j]);
+void DigitalSignatureManager::rememberValid(const string& key) {
+    lock_guard<mutex> guard(cacheMutex);
+    if (cacheCapacity == 0 || cacheEntries.count(key)) return;
+    cacheOrder.push_front(key);
+    cacheEntries[key] = cacheOrder.begin();
+    if (cacheOrder.size() > cacheCapacity) {
+        cacheEntries.erase(cacheOrder.back());
+        cacheOrder.pop_back();
     }
-
-    return ret;
 }
@@ -2,28 +2,55 @@
 #define DIGITALSIGNATUREMANAGER_H
 
 #include <string>
-#include <windows.h>
-#include <wincrypt.h>
 #include <vector>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <utility>
+#include "SignatureBackend.h"
 
-#pragma comment(lib, "crypt32.lib")
-
+// Signs records and checks their signatures through a SignatureBackend.
+// Successful verifications are remembered in an LRU cache keyed by a
+// SHA-256 digest of (data, signature), so an unchanged record is not put
+// through the public-key check again. Safe to call from several threads.
 class DigitalSignatureManager {
 private:
-    HCRYPTPROV hProv;
-    HCRYPTKEY hKey;
+    std::unique_ptr<SignatureBackend> backend;
+
+    std::mutex cacheMutex;
+    std::list<std::string> cacheOrder;  // most recently used first
+    std::unordered_map<std::string, std::list<std::string>::iterator> cacheEntries;
+    size_t cacheCapacity;
+
+    std::string cacheKey(const std::string& data, const std::vector<unsigned char>& signature);
+    bool cachedAsValid(const std::string& key);
+    void rememberValid(const std::string& key);
+    bool verifyDecoded(const std::string& data, const std::vector<unsigned char>& signature);
 
 public:
     DigitalSignatureManager();
-    ~DigitalSignatureManager();
+    explicit DigitalSignatureManager(std::unique_ptr<SignatureBackend> backend);
 
     bool init();
     std::string signData(const std::string& data);
     bool verifySignature(const std::string& data, const std::string& signatureBase64);
-    
-private:
-    std::string base64Encode(const std::vector<BYTE>& data);
-    std::vector<BYTE> base64Decode(const std::string& encoded);
+    // Verifies many (data, signature) pairs, spreading cache misses across
+    // hardware threads; result[i] belongs to items[i]
+    std::vector<bool> verifyBatch(const std::vector<std::pair<std::string, std::string>>& items);
+
+    // SHA-256 of data, from the backend
+    std::vector<unsigned char> digest(const std::string& data) { return backend->digest(data); }
+    // Secure random bytes, from the backend
+    bool randomBytes(unsigned char* out, size_t length) { return backend->randomBytes(out, length); }
+    // PBKDF2-HMAC-SHA256, from the backend
+    bool deriveKey(const std::string& password, const std::vector<unsigned char>& salt,
+                   unsigned iterations, unsigned char* out, size_t length) {
+        return backend->deriveKey(password, salt, iterations, out, length);
+    }
+
+    void setCacheCapacity(size_t entries);
+    const char* backendName() const { return backend->name(); }
 };
 
 #endif
@@ -2,6 +2,7 @@
 #define DRUG_H
 
 #include <string>
+#include "Date.h"
 
 struct Drug {
     std::string name;
@@ -9,6 +10,7 @@ struct Drug {
     int quantity;
     std::string expiryDate; // Format: DD/MM/YYYY
     int minThreshold;  // For low stock alert
+    int expiryDay = Date::invalid;  // expiryDate parsed; set by the controller
 
     bool isLowStock() const {
         return quantity <= minThreshold;
@@ -0,0 +1,28 @@
+#ifndef DRUGQUERY_H
+#define DRUGQUERY_H
+
+#include <string>
+#include <vector>
+#include "Drug.h"
+#include "Date.h"
+
+// One page of the inventory. Filters combine; the page order is that of
+// the index driving the query: soonest expiry first when expiringBefore
+// is set, otherwise by name (ignoring case).
+struct DrugQuery {
+    std::string namePrefix;             // ignoring case; "" for all
+    bool lowStockOnly = false;
+    int expiringBefore = Date::invalid; // day number; dated drugs only
+    size_t limit = 50;
+    // nextCursor of the previous page, asked with the same filters; "" for
+    // the first page
+    std::string cursor;
+};
+
+struct DrugPage {
+    std::vector<Drug> drugs;
+    // Where the next page starts; "" once the last page has been served
+    std::string nextCursor;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "EpidemicDetector.h"
+#include "Utils.h"
+#include "Date.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// A diagnosis silent for longer than this is treated as silent for this
+// long; by then its baseline has decayed to nothing anyway
+static const int maxCatchUpDays = 366;
+
+EpidemicDetector::EpidemicDetector() {}
+
+size_t EpidemicDetector::slot(int day) const {
+    int w = config.windowDays;
+    return static_cast<size_t>(((day % w) + w) % w);
+}
+
+// Case counts are roughly Poisson, so the spread is taken as at least
+// sqrt(mean) while the EWMA variance is still settling, and never below 1
+double EpidemicDetector::deviationOf(const Series& s) const {
+    return max({sqrt(s.var), sqrt(s.mean), 1.0});
+}
+
+// EWMA mean/variance and CUSUM step for one finished day
+void EpidemicDetector::closeDay(Series& s, int cases) const {
+    if (s.closedDays++ == 0) {
+        s.mean = cases;   // the first day seeds the baseline
+        return;
+    }
+    s.cusum = max(0.0, s.cusum + cases - s.mean - config.k * deviationOf(s));
+    double diff = cases - s.mean;
+    s.mean += config.alpha * diff;
+    s.var = (1 - config.alpha) * (s.var + config.alpha * diff * diff);
+}
+
+// Moves the newest bucket forward to day, closing the days in between
+void EpidemicDetector::advance(Series& s, int day) const {
+    if (day <= s.day) return;
+    int gap = day - s.day;
+    closeDay(s, s.buckets[slot(s.day)]);
+    for (int i = 1; i < min(gap, maxCatchUpDays); ++i) closeDay(s, 0);
+    for (int i = 1; i <= min(gap, config.windowDays); ++i) {
+        int& b = s.buckets[slot(s.day + i)];
+        s.window -= b;
+        b = 0;
+    }
+    s.day = day;
+}
+
+double EpidemicDetector::liveCusum(const Series& s, int day) const {
+    int cases = day == s.day ? s.buckets[slot(day)] : 0;
+    return max(0.0, s.cusum + cases - s.mean - config.k * deviationOf(s));
+}
+
+bool EpidemicDetector::isAlerting(const Series& s, int day) const {
+    return s.window >= config.minCases && liveCusum(s, day) > config.h * deviationOf(s);
+}
+
+void EpidemicDetector::reset(const Config& c, vector<pair<string, int>> cases) {
+    int now = Date::today();
+    for (auto& entry : cases) {
+        if (entry.second == Date::invalid || entry.second > now) entry.second = now;
+    }
+    // Replayed oldest first, so each day closes once as it would have live
+    stable_sort(cases.begin(), cases.end(),
+                [](const pair<string, int>& a, const pair<string, int>& b) { return a.second < b.second; });
+
+    {
+        lock_guard<mutex> guard(detectorMutex);
+        config = c;
+        config.windowDays = max(1, config.windowDays);
+        config.alpha = min(1.0, max(0.01, config.alpha));
+        series.clear();
+    }
+    for (const auto& entry : cases) add(entry.first, entry.second);
+}
+
+bool EpidemicDetector::record(const string& diagnosis, int day) {
+    int now = Date::today();
+    if (day == Date::invalid || day > now) day = now;
+    return add(diagnosis, day);
+}
+
+bool EpidemicDetector::add(const string& diagnosis, int day) {
+    if (diagnosis.empty()) return false;
+    string key = Utils::toLowerCase(diagnosis);
+
+    lock_guard<mutex> guard(detectorMutex);
+    auto inserted = series.try_emplace(key);
+    Series& s = inserted.first->second;
+    if (inserted.second) {
+        s.name = diagnosis;
+        s.day = day;
+        s.buckets.assign(config.windowDays, 0);
+    }
+    advance(s, day);
+    // Cases dated before the window only ever mattered to older baselines
+    if (s.day - day < config.windowDays) {
+        ++s.buckets[slot(day)];
+        ++s.window;
+    }
+    bool alerting = isAlerting(s, s.day);
+    bool raised = alerting && !s.alerting;
+    s.alerting = alerting;
+    return raised;
+}
+
+EpidemicDetector::Config EpidemicDetector::getConfig() const {
+    lock_guard<mutex> guard(detectorMutex);
+    return config;
+}
+
+// Each series is brought forward to today on a copy, so a diagnosis with
+// no recent cases reports its decayed state without changing it
+EpidemicDetector::Report EpidemicDetector::report() const {
+    int now = Date::today();
+    Report r;
+    lock_guard<mutex> guard(detectorMutex);
+    r.config = config;
+    r.trends.reserve(series.size());
+    for (const auto& entry : series) {
+        Series s = entry.second;
+        advance(s, now);
+        Trend t;
+        t.diagnosis = s.name;
+        t.today = s.day - now < config.windowDays ? s.buckets[slot(now)] : 0;
+        t.window = s.window;
+        t.baseline = s.mean;
+        t.deviation = deviationOf(s);
+        t.cusum = liveCusum(s, s.day);
+        t.alert = isAlerting(s, s.day);
+        r.trends.push_back(move(t));
+    }
+    sort(r.trends.begin(), r.trends.end(), [](const Trend& a, const Trend& b) {
+        if (a.alert != b.alert) return a.alert;
+        if (a.window != b.window) return a.window > b.window;
+        return a.diagnosis < b.diagnosis;
+    });
+    return r;
+}
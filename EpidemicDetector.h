@@ -0,0 +1,92 @@
+#ifndef EPIDEMICDETECTOR_H
+#define EPIDEMICDETECTOR_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Streaming outbreak detection over prescription diagnoses. Each diagnosis
+// keeps daily case counts for the last windowDays days in a ring, an EWMA
+// baseline (mean and variance) of its daily counts, and a one-sided CUSUM
+// of how far each closed day rose above that baseline. Recording a case
+// only advances that diagnosis's own state, so it costs O(1) however long
+// the history is.
+//
+// A diagnosis is alerting when the CUSUM including today's partial count
+// exceeds h standard deviations and the window holds at least minCases.
+// The first closed day seeds the baseline. Standard deviations are
+// floored at sqrt(baseline), as for Poisson counts, and at 1 case, so a
+// quiet or young baseline does not alert on a handful of prescriptions.
+//
+// The internal lock is a leaf, like DashboardStats'.
+class EpidemicDetector {
+public:
+    struct Config {
+        int windowDays = 7;     // days counted in the window total
+        double alpha = 0.2;     // EWMA weight of the newest closed day
+        double k = 0.5;         // CUSUM slack, in standard deviations
+        double h = 4.0;         // CUSUM alert threshold, in standard deviations
+        int minCases = 5;       // no alert below this many cases in the window
+    };
+
+    struct Trend {
+        std::string diagnosis;
+        int today = 0;          // cases dated today
+        int window = 0;         // cases in the last windowDays days
+        double baseline = 0;    // expected cases per day
+        double deviation = 0;   // standard deviation of cases per day, floored as for the alarm
+        double cusum = 0;       // including today, in cases
+        bool alert = false;
+    };
+
+    struct Report {
+        Config config;
+        std::vector<Trend> trends;   // alerts first, then by window total
+    };
+
+private:
+    struct Series {
+        std::string name;       // as first seen
+        int day = 0;            // newest day bucket
+        std::vector<int> buckets;
+        int window = 0;
+        double mean = 0;
+        double var = 0;
+        double cusum = 0;
+        int closedDays = 0;
+        bool alerting = false;
+    };
+
+    mutable std::mutex detectorMutex;
+    Config config;
+    std::unordered_map<std::string, Series> series;   // by lower-cased diagnosis
+
+    // Callers hold detectorMutex
+    void advance(Series& s, int day) const;
+    void closeDay(Series& s, int cases) const;
+    double deviationOf(const Series& s) const;
+    double liveCusum(const Series& s, int day) const;
+    bool isAlerting(const Series& s, int day) const;
+    size_t slot(int day) const;   // index of day in a series' ring
+
+    // record() for a day already clamped to today at the latest
+    bool add(const std::string& diagnosis, int day);
+
+public:
+    EpidemicDetector();
+
+    // Clears all state and replays (diagnosis, day number) pairs in date
+    // order. Cases without a valid date, or dated after today, count as
+    // today's, here and in record; a future date would otherwise move the
+    // series past today and hide today's cases.
+    void reset(const Config& c, std::vector<std::pair<std::string, int>> cases);
+
+    // Returns true when this case puts its diagnosis into alert
+    bool record(const std::string& diagnosis, int day);
+
+    Config getConfig() const;
+    Report report() const;
+};
+
+#endif
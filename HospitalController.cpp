@@ -1,75 +1,647 @@
 #include "HospitalController.h"
 #include "Utils.h"
+#include "Date.h"
 #include <iostream>
 #include <algorithm>
 #include <map>
+#include <charconv>
+#include <cctype>
 
 using namespace std;
 
-HospitalController::HospitalController() : currentUser(nullptr) {
+// The signed fields of each record
+static string prescriptionSigningData(const Prescription& p) {
+    return p.patientName + p.drugName + to_string(p.quantity) + p.date;
+}
+
+static string transactionSigningData(const Transaction& t) {
+    return to_string(t.id) + to_string(t.prescriptionId) + to_string(t.amount) + t.date;
+}
+
+HospitalController::HospitalController(bool reserve)
+    : hotWindowMonths(3), sessions(signatureManager), passwordHasher(signatureManager), maxPrescriptionId(0), maxTransactionId(0), reserveOnCreate(reserve), signatureSeq(0),
+      ledger(signatureManager), signingQueue(signatureManager) {
     if (!signatureManager.init()) {
         cerr << "Warning: Digital Signature Manager failed to initialize.\n";
     }
     users = DataManager::loadUsers();
     drugs = DataManager::loadDrugs();
-    prescriptions = DataManager::loadPrescriptions();
-    transactions = DataManager::loadTransactions();
+    archive = DataManager::loadArchiveManifest();
+    prescriptions = DataManager::loadPrescriptions(archive.prescriptionBase());
+    transactions = DataManager::loadTransactions(archive.transactionBase());
+    vector<LedgerSeal> seals = DataManager::loadLedgerSeals();
+    if (DataManager::replayLog(users, drugs, prescriptions, archive.prescriptionBase(), transactions,
+                               archive.transactionBase(), seals) > 0) {
+        cout << "Recovered changes from the write-ahead log.\n";
+    }
+    uint64_t renumberSeq = max(renumberDuplicatePrescriptions(), renumberDuplicateTransactions(seals));
+    // Archived transactions are settled and never change, so their revenue
+    // is summed once, a segment at a time, and kept across later resets
+    for (const auto& segment : archive.transactions) {
+        vector<Transaction> rows;
+        DataManager::readArchivedTransactions(segment, INT_MIN, INT_MAX, rows);
+        dashboard.addArchived(rows, 0, rows.size());
+    }
+    rebuildIndexes();
+    if (renumberSeq) persist(renumberSeq);
+    if (reserveOnCreate) reservePendingPrescriptions();
+
+    // Transactions from before the ledger (or billed after the last seal
+    // made it to disk) are sealed now; queueUnsignedRecords signs them
+    uint64_t sealSeq = 0;
+    for (size_t batch : ledger.rebuild(archive.transactionBase() + transactions.size(), transactionRows(), seals)) {
+        sealSeq = DataManager::logLedgerSeal(batch, ledger.seal(batch));
+    }
+    if (!ledger.intact()) {
+        cerr << "SECURITY ALERT: transactions no longer match the sealed ledger; no new batches will be sealed.\n";
+    }
+
+    // One commit covers every signature stored by a batch
+    signingQueue.setAfterBatch([this] {
+        uint64_t seq = signatureSeq.load();
+        if (seq) persist(seq);
+    });
+    queueUnsignedRecords();
+    if (sealSeq) persist(sealSeq);
+
+    // Settled history from before the hot window (all of it, the first
+    // time) moves to the archive now rather than at the next compaction
+    bool archivable;
+    {
+        shared_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        shared_lock<shared_mutex> transactionsLock(transactionsMutex);
+        int hotStart = hotWindowStart();
+        archivable = archivablePrescriptions(hotStart) > 0 || archivableTransactions(hotStart) > 0;
+    }
+    if (archivable) compact();
 }
 
 HospitalController::~HospitalController() {
-    DataManager::saveUsers(users);
-    DataManager::saveDrugs(drugs);
-    DataManager::savePrescriptions(prescriptions);
-    DataManager::saveTransactions(transactions);
+    // Seal whatever the open batch holds, so nothing billed is left out
+    {
+        unique_lock<shared_mutex> lock(transactionsMutex);
+        size_t batch = ledger.closeOpenBatch();
+        if (batch != static_cast<size_t>(-1)) {
+            DataManager::logLedgerSeal(batch, ledger.seal(batch));
+            queueLedgerSigning(batch);
+        }
+    }
+    signingQueue.drain();
+    compact();
+}
+
+bool HospitalController::persist(uint64_t seq) {
+    bool durable = DataManager::commitLog(seq);
+    if (!durable) {
+        cerr << "Error: the change could not be written to disk and may be lost on restart.\n";
+    }
+    if (DataManager::logNeedsCompaction()) {
+        compact();
+    }
+    return durable;
+}
+
+void HospitalController::setChangeListener(function<void()> listener) {
+    lock_guard<mutex> guard(listenerMutex);
+    changeListener = move(listener);
+}
+
+void HospitalController::notifyChange() {
+    lock_guard<mutex> guard(listenerMutex);
+    if (changeListener) changeListener();
+}
+
+void HospitalController::setHotWindowMonths(int months) {
+    hotWindowMonths = max(1, months);
+}
+
+void HospitalController::setPasswordHashing(const PasswordHasher::Config& config) {
+    passwordHasher.configure(config);
+}
+
+// Writers log while holding their table lock exclusively, so shared locks
+// keep them out. Stock changes only hold the drugs lock shared, hence the
+// exclusive lock there. The snapshots and the log reset then see one state.
+void HospitalController::compact() {
+    lock_guard<mutex> guard(compactionMutex);
+    int hotStart = hotWindowStart();
+    bool archiving;
+    {
+        shared_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        shared_lock<shared_mutex> transactionsLock(transactionsMutex);
+        archiving = archivablePrescriptions(hotStart) > 0 || archivableTransactions(hotStart) > 0;
+    }
+    shared_lock<shared_mutex> usersLock(usersMutex);
+    unique_lock<shared_mutex> drugsLock(drugsMutex);
+    if (!archiving) {
+        shared_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        shared_lock<shared_mutex> transactionsLock(transactionsMutex);
+        DataManager::compact(users, drugsWithStock(), prescriptions, 0, transactions, 0, ledger.getSeals(), archive);
+        return;
+    }
+
+    // Archiving drops rows from the hot tables, so only then are they
+    // locked exclusively
+    unique_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+    unique_lock<shared_mutex> transactionsLock(transactionsMutex);
+    size_t archivedPrescriptions = archivablePrescriptions(hotStart);
+    size_t archivedTransactions = archivableTransactions(hotStart);
+    if (!DataManager::compact(users, drugsWithStock(), prescriptions, archivedPrescriptions, transactions,
+                              archivedTransactions, ledger.getSeals(), archive)) {
+        return;
+    }
+    dashboard.addArchived(transactions, 0, archivedTransactions);
+    prescriptions.erase(prescriptions.begin(), prescriptions.begin() + archivedPrescriptions);
+    prescriptions.shrink_to_fit();
+    transactions.erase(transactions.begin(), transactions.begin() + archivedTransactions);
+    transactions.shrink_to_fit();
+    rebuildRecordIndexes();
+}
+
+// --- Archive ---
+int HospitalController::hotWindowStart() const {
+    int year, month, day;
+    Date::toCivil(Date::today(), year, month, day);
+    int first = year * 12 + month - 1 - (hotWindowMonths.load() - 1);
+    return Date::fromCivil(first / 12, first % 12 + 1, 1);
+}
+
+// Unsigned rows are excluded too: their signing callbacks look them up in
+// the hot table
+size_t HospitalController::archivablePrescriptions(int hotStart) const {
+    size_t count = 0;
+    for (const auto& p : prescriptions) {
+        if (p.day >= hotStart || p.status == "pending" || p.signature.empty()) break;
+        ++count;
+    }
+    return count;
+}
+
+size_t HospitalController::archivableTransactions(int hotStart) const {
+    size_t count = 0;
+    for (const auto& t : transactions) {
+        if (t.day >= hotStart || t.paymentMethod == "Pending" || t.signature.empty()) break;
+        ++count;
+    }
+    return count;
+}
+
+// The ledger reads rows in position order, so archived ones are decoded a
+// whole segment at a time and kept until it moves past them. A segment
+// that cannot be read yields empty rows, which fail to match their seal.
+TransactionLedger::RowSource HospitalController::transactionRows() const {
+    struct Segment {
+        size_t first = 0;
+        size_t end = 0;
+        vector<Transaction> rows;
+    };
+    auto cached = make_shared<Segment>();
+    return [this, cached](size_t pos) -> Transaction {
+        size_t base = archive.transactionBase();
+        if (pos >= base) return pos - base < transactions.size() ? transactions[pos - base] : Transaction();
+        if (pos < cached->first || pos >= cached->end) {
+            auto segment = upper_bound(archive.transactions.begin(), archive.transactions.end(), pos,
+                                       [](size_t p, const ArchiveSegment& s) { return p < s.firstPos; }) - 1;
+            cached->first = segment->firstPos;
+            cached->end = segment->firstPos + segment->rows;
+            cached->rows.clear();
+            DataManager::readArchivedTransactions(*segment, INT_MIN, INT_MAX, cached->rows);
+        }
+        size_t i = pos - cached->first;
+        return i < cached->rows.size() ? cached->rows[i] : Transaction();
+    };
+}
+
+// Segments overlapping fromDay..toDay
+static vector<ArchiveSegment> segmentsBetween(const vector<ArchiveSegment>& segments, int fromDay, int toDay) {
+    vector<ArchiveSegment> overlapping;
+    for (const auto& s : segments) {
+        if (s.maxDay >= fromDay && s.minDay <= toDay) overlapping.push_back(s);
+    }
+    return overlapping;
+}
+
+// Listed segments never change, so they are read after the table lock is
+// released. Archived rows are merged in date order with the hot ones.
+template <typename T, typename Read>
+static vector<T> withArchived(const vector<ArchiveSegment>& segments, vector<T> hot, Read read) {
+    vector<T> rows;
+    for (const auto& s : segments) read(s, rows);
+    if (rows.empty()) return hot;
+    rows.insert(rows.end(), make_move_iterator(hot.begin()), make_move_iterator(hot.end()));
+    stable_sort(rows.begin(), rows.end(), [](const T& a, const T& b) { return a.day < b.day; });
+    return rows;
+}
+
+// --- Indexes ---
+// checkExpiry warns about drugs expiring within this many days
+static const int expiryWarningDays = 30;
+
+// Records are mostly created in date order, so this is usually a push_back
+static void indexByDay(vector<pair<int, size_t>>& index, int day, size_t pos) {
+    pair<int, size_t> entry(day, pos);
+    if (index.empty() || index.back() < entry) {
+        index.push_back(entry);
+    } else {
+        index.insert(upper_bound(index.begin(), index.end(), entry), entry);
+    }
+}
+
+// Positions dated fromDay..toDay inclusive, as an iterator range
+static pair<vector<pair<int, size_t>>::const_iterator, vector<pair<int, size_t>>::const_iterator>
+dayRange(const vector<pair<int, size_t>>& index, int fromDay, int toDay) {
+    auto first = lower_bound(index.begin(), index.end(), make_pair(fromDay, size_t(0)));
+    auto last = toDay == INT_MAX ? index.end()
+                                 : lower_bound(first, index.end(), make_pair(toDay + 1, size_t(0)));
+    return {first, max(first, last)};
+}
+
+void HospitalController::rebuildIndexes() {
+    userIndex.clear();
+    userIndex.reserve(users.size());
+    for (size_t i = 0; i < users.size(); ++i) {
+        userIndex.emplace(users[i].username, i);   // first entry wins, as the old scan did
+    }
+
+    drugIndex.clear();
+    drugsByExpiry.clear();
+    drugsByName.clear();
+    stock.clear();
+    drugIndex.reserve(drugs.size());
+    drugsByName.reserve(drugs.size());
+    {
+        lock_guard<mutex> guard(lowStockMutex);
+        lowStockDrugs.clear();
+    }
+    for (size_t i = 0; i < drugs.size(); ++i) {
+        string name = Utils::toLowerCase(drugs[i].name);
+        // First entry wins, matching the old linear scan on duplicate names
+        drugIndex.emplace(name, i);
+        stock.emplace_back(drugs[i].quantity);
+        drugs[i].expiryDay = Date::parse(drugs[i].expiryDate);
+        drugsByExpiry.emplace_back(drugs[i].expiryDay, i);
+        if (drugs[i].isLowStock()) {
+            lock_guard<mutex> guard(lowStockMutex);
+            lowStockDrugs.emplace(name, i);
+        }
+        drugsByName.emplace_back(move(name), i);
+    }
+    sort(drugsByExpiry.begin(), drugsByExpiry.end());
+    sort(drugsByName.begin(), drugsByName.end());
+    rebuildRecordIndexes();
+}
+
+void HospitalController::rebuildRecordIndexes() {
+    prescriptionIndex.clear();
+    transactionIndex.clear();
+    prescriptionsByStatus.clear();
+    prescriptionsByPatient.clear();
+    prescriptionsByDay.clear();
+    transactionsByDay.clear();
+    maxPrescriptionId = ArchiveManifest::maxIdOf(archive.prescriptions);
+    maxTransactionId = ArchiveManifest::maxIdOf(archive.transactions);
+
+    prescriptionIndex.reserve(prescriptions.size());
+    for (size_t i = 0; i < prescriptions.size(); ++i) {
+        prescriptions[i].day = Date::parse(prescriptions[i].date);
+        indexPrescription(i);
+    }
+    transactionIndex.reserve(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        transactionIndex.emplace(transactions[i].id, i);
+        maxTransactionId = max(maxTransactionId, transactions[i].id);
+        transactions[i].day = Date::parse(transactions[i].date);
+        indexByDay(transactionsByDay, transactions[i].day, i);
+    }
+
+    vector<Drug> current = drugsWithStock();
+    int lowStock = count_if(current.begin(), current.end(), [](const Drug& d) { return d.isLowStock(); });
+    auto pending = prescriptionsByStatus.find("pending");
+    dashboard.reset(transactions, lowStock, pending == prescriptionsByStatus.end() ? 0 : (int)pending->second.size());
+    resetEpidemics(epidemics.getConfig());
+}
+
+void HospitalController::resetEpidemics(const EpidemicDetector::Config& config) {
+    vector<pair<string, int>> cases;
+    cases.reserve(prescriptions.size());
+    for (const auto& p : prescriptions) cases.emplace_back(p.diagnosis, p.day);
+    epidemics.reset(config, move(cases));
+}
+
+// Hand-edited or legacy files can hold two prescriptions with one id. The
+// first keeps it and each later one gets a fresh id after every known one,
+// so the id index reaches every row. The id is not signed, so signatures
+// still hold. Returns the log sequence to commit, or 0 if nothing changed.
+uint64_t HospitalController::renumberDuplicatePrescriptions() {
+    int maxId = ArchiveManifest::maxIdOf(archive.prescriptions);
+    for (const auto& p : prescriptions) maxId = max(maxId, p.id);
+    unordered_set<int> seen;
+    seen.reserve(prescriptions.size());
+    uint64_t seq = 0;
+    for (size_t i = 0; i < prescriptions.size(); ++i) {
+        Prescription& p = prescriptions[i];
+        if (seen.insert(p.id).second) continue;
+        cerr << "Warning: prescription id " << p.id << " is used more than once; the one for "
+             << p.patientName << " is now id " << maxId + 1 << ".\n";
+        p.id = ++maxId;
+        seen.insert(p.id);
+        seq = DataManager::logPrescription(archive.prescriptionBase() + i, p);
+    }
+    return seq;
+}
+
+// The same for transactions, except that a row already covered by a stored
+// ledger seal keeps its id: the id is part of the row's leaf hash, so a new
+// one would break the seal. Only the first of such a pair is found by id.
+// A renumbered row's signature covered the old id; it is cleared so that
+// queueUnsignedRecords signs the row again.
+uint64_t HospitalController::renumberDuplicateTransactions(const vector<LedgerSeal>& seals) {
+    size_t sealedRows = 0;
+    for (const auto& s : seals) sealedRows += s.count;
+    int maxId = ArchiveManifest::maxIdOf(archive.transactions);
+    for (const auto& t : transactions) maxId = max(maxId, t.id);
+    unordered_set<int> seen;
+    seen.reserve(transactions.size());
+    uint64_t seq = 0;
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        Transaction& t = transactions[i];
+        if (seen.insert(t.id).second) continue;
+        size_t pos = archive.transactionBase() + i;
+        if (pos < sealedRows) {
+            cerr << "Warning: transaction id " << t.id << " is used more than once; the later one is sealed "
+                 << "in the ledger and keeps its id.\n";
+            continue;
+        }
+        cerr << "Warning: transaction id " << t.id << " is used more than once; the one for prescription "
+             << t.prescriptionId << " is now id " << maxId + 1 << ".\n";
+        t.id = ++maxId;
+        t.signature = "";
+        seen.insert(t.id);
+        seq = DataManager::logTransaction(pos, t);
+    }
+    return seq;
+}
+
+void HospitalController::indexPrescription(size_t pos) {
+    const Prescription& p = prescriptions[pos];
+    prescriptionIndex.emplace(p.id, pos);
+    maxPrescriptionId = max(maxPrescriptionId, p.id);
+    prescriptionsByStatus[p.status].insert(pos);
+    prescriptionsByPatient[Utils::toLowerCase(p.patientName)].push_back(pos);
+    indexByDay(prescriptionsByDay, p.day, pos);
+}
+
+void HospitalController::setPrescriptionStatus(Prescription& p, const string& status) {
+    size_t pos = &p - prescriptions.data();
+    dashboard.adjustPending((status == "pending") - (p.status == "pending"));
+    prescriptionsByStatus[p.status].erase(pos);
+    p.status = status;
+    prescriptionsByStatus[status].insert(pos);
+}
+
+Drug* HospitalController::drugByName(const string& name) {
+    auto it = drugIndex.find(Utils::toLowerCase(name));
+    return it == drugIndex.end() ? nullptr : &drugs[it->second];
+}
+
+Drug HospitalController::drugWithStock(size_t pos) const {
+    Drug d = drugs[pos];
+    d.quantity = stock[pos].onHand.load();
+    return d;
+}
+
+vector<Drug> HospitalController::drugsWithStock() const {
+    vector<Drug> current = drugs;
+    for (size_t i = 0; i < current.size(); ++i) {
+        current[i].quantity = stock[i].onHand.load();
+    }
+    return current;
+}
+
+// Reservations live only in memory, so after a restart they are taken again
+// for every pending prescription, oldest first, as far as stock allows.
+void HospitalController::reservePendingPrescriptions() {
+    auto it = prescriptionsByStatus.find("pending");
+    if (it == prescriptionsByStatus.end()) return;
+    for (size_t pos : it->second) {
+        const Prescription& p = prescriptions[pos];
+        auto drug = drugIndex.find(Utils::toLowerCase(p.drugName));
+        if (drug != drugIndex.end() && stock[drug->second].reserve(p.quantity)) {
+            reservedPrescriptions.insert(p.id);
+        }
+    }
+}
+
+Prescription* HospitalController::findPrescription(int id) {
+    auto it = prescriptionIndex.find(id);
+    return it == prescriptionIndex.end() ? nullptr : &prescriptions[it->second];
+}
+
+Transaction* HospitalController::findTransaction(int id) {
+    auto it = transactionIndex.find(id);
+    return it == transactionIndex.end() ? nullptr : &transactions[it->second];
+}
+
+// --- Background signing ---
+void HospitalController::queuePrescriptionSigning(const Prescription& p) {
+    int id = p.id;
+    pendingSignatures[id] = signingQueue.submit(prescriptionSigningData(p), [this, id](const string& signature) {
+        unique_lock<shared_mutex> lock(prescriptionsMutex);
+        pendingSignatures.erase(id);
+        Prescription* stored = findPrescription(id);
+        if (!stored || signature.empty()) return;   // retried on next start
+        stored->signature = signature;
+        uint64_t seq = DataManager::logPrescription(archive.prescriptionBase() + (stored - prescriptions.data()), *stored);
+        noteSignatureSeq(seq);
+    });
+}
+
+void HospitalController::queueTransactionSigning(const Transaction& t) {
+    int id = t.id;
+    signingQueue.submit(transactionSigningData(t), [this, id](const string& signature) {
+        unique_lock<shared_mutex> lock(transactionsMutex);
+        Transaction* stored = findTransaction(id);
+        if (!stored || signature.empty()) return;
+        stored->signature = signature;
+        uint64_t seq = DataManager::logTransaction(archive.transactionBase() + (stored - transactions.data()), *stored);
+        noteSignatureSeq(seq);
+    });
+}
+
+void HospitalController::queueLedgerSigning(size_t batch) {
+    signingQueue.submit(TransactionLedger::sealData(batch, ledger.seal(batch)), [this, batch](const string& signature) {
+        unique_lock<shared_mutex> lock(transactionsMutex);
+        if (signature.empty()) return;
+        ledger.setSignature(batch, signature);
+        uint64_t seq = DataManager::logLedgerSeal(batch, ledger.seal(batch));
+        noteSignatureSeq(seq);
+    });
+}
+
+// Callbacks for different tables run concurrently, so keep the maximum
+void HospitalController::noteSignatureSeq(uint64_t seq) {
+    uint64_t previous = signatureSeq.load();
+    while (previous < seq && !signatureSeq.compare_exchange_weak(previous, seq)) {}
+}
+
+// Records stored just before a crash (or whose signing failed) are still
+// pending; sign them now
+void HospitalController::queueUnsignedRecords() {
+    {
+        unique_lock<shared_mutex> lock(prescriptionsMutex);
+        for (const auto& p : prescriptions) {
+            if (p.signature.empty()) queuePrescriptionSigning(p);
+        }
+    }
+    unique_lock<shared_mutex> lock(transactionsMutex);
+    for (const auto& t : transactions) {
+        if (t.signature.empty()) queueTransactionSigning(t);
+    }
+    // Never sign a seal over a chain that failed to match
+    if (!ledger.intact()) return;
+    const auto& seals = ledger.getSeals();
+    for (size_t batch = 0; batch < seals.size(); ++batch) {
+        if (seals[batch].signature.empty()) queueLedgerSigning(batch);
+    }
 }
 
 // --- User Management ---
-bool HospitalController::login(const string& username, const string& password) {
-    for (auto& u : users) {
-        if (u.username == username && u.password == password) {
-            currentUser = &u;
-            return true;
+bool HospitalController::authenticate(const string& username, const string& password, AuthenticateCallback done) {
+    User user;
+    bool known = false;
+    {
+        shared_lock<shared_mutex> lock(usersMutex);
+        auto it = userIndex.find(username);
+        if (it != userIndex.end()) {
+            user = users[it->second];
+            known = true;
         }
     }
-    return false;
+    // Unknown names cost as much as a wrong password, so timing does not
+    // tell which usernames exist
+    string stored = known ? user.password : passwordHasher.decoyRecord();
+    return passwordHasher.verify(password, stored, [this, username, stored, known, user, done = move(done)](
+                                                       const PasswordHasher::Outcome& checked) mutable {
+        PasswordHasher::Outcome outcome = checked;
+        if (!known && outcome.result == PasswordHasher::Result::Match) outcome.result = PasswordHasher::Result::Mismatch;
+        if (outcome.result != PasswordHasher::Result::Match || outcome.upgraded.empty()) {
+            done(outcome.result, user);
+            return;
+        }
+
+        // Migrate the record, unless it changed while it was being checked
+        uint64_t seq = 0;
+        {
+            unique_lock<shared_mutex> lock(usersMutex);
+            auto it = userIndex.find(username);
+            if (it != userIndex.end() && users[it->second].password == stored) {
+                users[it->second].password = outcome.upgraded;
+                seq = DataManager::logUser(it->second, users[it->second]);
+            }
+        }
+        if (seq) persist(seq);
+        user.password = outcome.upgraded;
+        done(outcome.result, user);
+    });
 }
 
-void HospitalController::logout() {
-    currentUser = nullptr;
+PasswordHasher::Result HospitalController::authenticate(const string& username, const string& password, User& user) {
+    promise<PasswordHasher::Result> result;
+    future<PasswordHasher::Result> answer = result.get_future();
+    bool queued = authenticate(username, password, [&](PasswordHasher::Result r, const User& u) {
+        user = u;
+        result.set_value(r);
+    });
+    return queued ? answer.get() : PasswordHasher::Result::Busy;
 }
 
-User* HospitalController::getCurrentUser() {
-    return currentUser;
+bool HospitalController::login(const string& username, const string& password, LoginCallback done) {
+    return authenticate(username, password, [this, done = move(done)](PasswordHasher::Result result, const User& user) {
+        done(result == PasswordHasher::Result::Match ? sessions.create(user) : "", result == PasswordHasher::Result::Busy);
+    });
 }
 
-void HospitalController::addUser(const User& user) {
-    users.push_back(user);
-    DataManager::saveUsers(users);
+string HospitalController::login(const string& username, const string& password, bool* busy) {
+    User user;
+    PasswordHasher::Result result = authenticate(username, password, user);
+    if (busy) *busy = result == PasswordHasher::Result::Busy;
+    if (result != PasswordHasher::Result::Match) return "";
+    return sessions.create(user);
 }
 
-// --- Inventory ---
-void HospitalController::addDrug(const Drug& drug) {
-    drugs.push_back(drug);
-    DataManager::saveDrugs(drugs);
+void HospitalController::logout(const string& token) {
+    sessions.remove(token);
+}
+
+optional<User> HospitalController::getSessionUser(const string& token) {
+    User user;
+    if (!sessions.lookup(token, user)) return nullopt;
+    return user;
 }
 
-vector<Drug>& HospitalController::getDrugs() {
-    return drugs;
+size_t HospitalController::getUserCount() const {
+    shared_lock<shared_mutex> lock(usersMutex);
+    return users.size();
 }
 
-Drug* HospitalController::findDrug(const string& name) {
-    for (auto& d : drugs) {
-        if (Utils::toLowerCase(d.name) == Utils::toLowerCase(name)) {
-            return &d;
+bool HospitalController::addUser(const User& user) {
+    // Hashed before taking the lock; should that fail, the plaintext is
+    // stored and gets hashed at the user's first login
+    User stored = user;
+    string record = passwordHasher.hash(user.password);
+    if (!record.empty()) stored.password = record;
+    uint64_t seq;
+    {
+        unique_lock<shared_mutex> lock(usersMutex);
+        users.push_back(stored);
+        userIndex.emplace(stored.username, users.size() - 1);
+        seq = DataManager::logUser(users.size() - 1, stored);
+    }
+    return persist(seq);
+}
+
+// --- Inventory ---
+bool HospitalController::addDrug(const Drug& drug) {
+    uint64_t seq;
+    {
+        unique_lock<shared_mutex> lock(drugsMutex);
+        drugs.push_back(drug);
+        drugs.back().expiryDay = Date::parse(drug.expiryDate);
+        stock.emplace_back(drug.quantity);
+        size_t pos = drugs.size() - 1;
+        pair<string, size_t> byName(Utils::toLowerCase(drug.name), pos);
+        drugIndex.emplace(byName.first, pos);
+        indexByDay(drugsByExpiry, drugs.back().expiryDay, pos);
+        drugsByName.insert(upper_bound(drugsByName.begin(), drugsByName.end(), byName), byName);
+        if (drug.isLowStock()) {
+            dashboard.adjustLowStock(1);
+            lock_guard<mutex> guard(lowStockMutex);
+            lowStockDrugs.insert(byName);
         }
+        seq = DataManager::logDrug(drugs.size() - 1, drug);
     }
-    return nullptr;
+    bool saved = persist(seq);
+    notifyChange();
+    return saved;
+}
+
+vector<Drug> HospitalController::getDrugs() const {
+    shared_lock<shared_mutex> lock(drugsMutex);
+    return drugsWithStock();
+}
+
+optional<Drug> HospitalController::findDrug(const string& name) const {
+    shared_lock<shared_mutex> lock(drugsMutex);
+    auto it = drugIndex.find(Utils::toLowerCase(name));
+    if (it == drugIndex.end()) return nullopt;
+    return drugWithStock(it->second);
 }
 
 void HospitalController::checkLowStock() {
+    shared_lock<shared_mutex> lock(drugsMutex);
     cout << "\n--- Low Stock Alert ---\n";
     bool found = false;
-    for (const auto& d : drugs) {
+    for (const auto& d : drugsWithStock()) {
         if (d.isLowStock()) {
             cout << "WARNING: " << d.name << " is low (" << d.quantity << " left)\n";
             found = true;
@@ -78,147 +650,522 @@ void HospitalController::checkLowStock() {
     if (!found) cout << "All stock levels are healthy.\n";
 }
 
+vector<Drug> HospitalController::getExpiredDrugs() const {
+    vector<Drug> expired;
+    shared_lock<shared_mutex> lock(drugsMutex);
+    // Skips drugs whose expiry date could not be parsed
+    auto range = dayRange(drugsByExpiry, Date::invalid + 1, Date::today() - 1);
+    for (auto it = range.first; it != range.second; ++it) expired.push_back(drugWithStock(it->second));
+    return expired;
+}
+
+vector<Drug> HospitalController::getDrugsExpiringWithin(int days) const {
+    vector<Drug> expiring;
+    int today = Date::today();
+    shared_lock<shared_mutex> lock(drugsMutex);
+    auto range = dayRange(drugsByExpiry, today, today + max(days, 0));
+    for (auto it = range.first; it != range.second; ++it) expiring.push_back(drugWithStock(it->second));
+    return expiring;
+}
+
+// Whether name starts with prefix, which is already case-folded
+static bool hasFoldedPrefix(const string& name, const string& prefix) {
+    if (name.size() < prefix.size()) return false;
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (tolower((unsigned char)name[i]) != prefix[i]) return false;
+    }
+    return true;
+}
+
+// The cursor is the position of the last drug served, tagged with the
+// order it was served in ('n'ame or 'e'xpiry). Drugs keep their position,
+// name and expiry, so it marks the same place in the index however many
+// drugs have been added since.
+bool HospitalController::getDrugPage(const DrugQuery& query, DrugPage& page) const {
+    page.drugs.clear();
+    page.nextCursor.clear();
+    bool byExpiry = query.expiringBefore != Date::invalid;
+    string prefix = Utils::toLowerCase(query.namePrefix);
+    size_t limit = max<size_t>(1, query.limit);
+
+    shared_lock<shared_mutex> lock(drugsMutex);
+    bool resume = !query.cursor.empty();
+    size_t after = 0;
+    if (resume) {
+        const string& cursor = query.cursor;
+        if (cursor.size() < 2 || cursor[0] != (byExpiry ? 'e' : 'n')) return false;
+        auto parsed = from_chars(cursor.data() + 1, cursor.data() + cursor.size(), after);
+        if (parsed.ec != errc() || parsed.ptr != cursor.data() + cursor.size() || after >= drugs.size()) return false;
+        if (byExpiry && drugs[after].expiryDay == Date::invalid) return false;
+    }
+    char order = byExpiry ? 'e' : 'n';
+    size_t last = 0;
+    // Takes the rows accept()s from the run where inRange() holds until the
+    // page is full; a cursor is only handed out if the run has rows left
+    auto fill = [&](auto it, auto end, auto inRange, auto accept) {
+        for (; it != end && inRange(*it) && page.drugs.size() < limit; ++it) {
+            if (!accept(*it)) continue;
+            page.drugs.push_back(drugWithStock(it->second));
+            last = it->second;
+        }
+        if (it != end && inRange(*it) && page.drugs.size() == limit) page.nextCursor = order + to_string(last);
+    };
+
+    if (byExpiry) {
+        // Drugs with no parseable expiry date are never "expiring before"
+        pair<int, size_t> from = resume ? make_pair(drugs[after].expiryDay, after) : make_pair(Date::invalid + 1, size_t(0));
+        auto first = resume ? upper_bound(drugsByExpiry.begin(), drugsByExpiry.end(), from)
+                            : lower_bound(drugsByExpiry.begin(), drugsByExpiry.end(), from);
+        auto inRange = [&](const pair<int, size_t>& entry) { return entry.first < query.expiringBefore; };
+        fill(first, drugsByExpiry.end(), inRange, [&](const pair<int, size_t>& entry) {
+            size_t pos = entry.second;
+            if (query.lowStockOnly && stock[pos].onHand.load() > drugs[pos].minThreshold) return false;
+            return prefix.empty() || hasFoldedPrefix(drugs[pos].name, prefix);
+        });
+        return true;
+    }
+
+    // By name: rows sharing the prefix are contiguous, so the walk stops
+    // at the first one that does not
+    pair<string, size_t> from = resume ? make_pair(Utils::toLowerCase(drugs[after].name), after) : make_pair(prefix, size_t(0));
+    auto inPrefix = [&](const pair<string, size_t>& entry) {
+        return entry.first.compare(0, prefix.size(), prefix) == 0;
+    };
+    auto any = [](const pair<string, size_t>&) { return true; };
+    if (query.lowStockOnly) {
+        lock_guard<mutex> guard(lowStockMutex);
+        auto first = resume ? lowStockDrugs.upper_bound(from) : lowStockDrugs.lower_bound(from);
+        fill(first, lowStockDrugs.end(), inPrefix, any);
+    } else {
+        auto first = resume ? upper_bound(drugsByName.begin(), drugsByName.end(), from)
+                            : lower_bound(drugsByName.begin(), drugsByName.end(), from);
+        fill(first, drugsByName.end(), inPrefix, any);
+    }
+    return true;
+}
+
 void HospitalController::checkExpiry() {
-    // Simplified expiry check (comparing strings for now, ideally use time_t)
     cout << "\n--- Expiry Check ---\n";
-    string today = Utils::getCurrentDate();
-    // In a real app, parse date and compare. Here we just list them.
-    for (const auto& d : drugs) {
-        cout << "Drug: " << d.name << " Expires: " << d.expiryDate << "\n";
+    int today = Date::today();
+    bool found = false;
+    for (const auto& d : getExpiredDrugs()) {
+        cout << "EXPIRED: " << d.name << " (expired " << d.expiryDate << ", " << d.quantity << " in stock)\n";
+        found = true;
     }
+    for (const auto& d : getDrugsExpiringWithin(expiryWarningDays)) {
+        cout << "WARNING: " << d.name << " expires " << d.expiryDate << " (in " << d.expiryDay - today << " days)\n";
+        found = true;
+    }
+    if (!found) cout << "No drugs expired or expiring within " << expiryWarningDays << " days.\n";
 }
 
 // --- Prescription ---
 void HospitalController::createPrescription(const Prescription& p) {
     Prescription newP = p;
-    // Sign the critical data: patientName + drugName + quantity + date
-    string dataToSign = newP.patientName + newP.drugName + to_string(newP.quantity) + newP.date;
-    newP.signature = signatureManager.signData(dataToSign);
-    
-    prescriptions.push_back(newP);
-    DataManager::savePrescriptions(prescriptions);
-    
-    // Reserve stock logic could go here, but for now we deduct on dispense
-    cout << "Prescription created for " << p.patientName << "\n";
+    // Signed in the background over patientName + drugName + quantity + date
+    newP.signature = "";
+    newP.day = Date::parse(newP.date);
+
+    if (reserveOnCreate) {
+        shared_lock<shared_mutex> lock(drugsMutex);
+        auto it = drugIndex.find(Utils::toLowerCase(newP.drugName));
+        if (it == drugIndex.end() || !stock[it->second].reserve(newP.quantity)) {
+            cout << "Error: Insufficient stock to reserve for this prescription.\n";
+            return;
+        }
+    }
+
+    uint64_t seq;
+    bool outbreak;
+    {
+        unique_lock<shared_mutex> lock(prescriptionsMutex);
+        // Ids come from rand() in the console; keep them unique so the id
+        // index stays one-to-one. Archived ids are not indexed, so any id
+        // up to the archived maximum is replaced too.
+        if (prescriptionIndex.count(newP.id) || newP.id <= ArchiveManifest::maxIdOf(archive.prescriptions)) {
+            newP.id = maxPrescriptionId + 1;
+        }
+        prescriptions.push_back(newP);
+        indexPrescription(prescriptions.size() - 1);
+        if (newP.status == "pending") dashboard.adjustPending(1);
+        outbreak = epidemics.record(newP.diagnosis, newP.day);
+        if (reserveOnCreate) reservedPrescriptions.insert(newP.id);
+        seq = DataManager::logPrescription(archive.prescriptionBase() + prescriptions.size() - 1, newP);
+        queuePrescriptionSigning(newP);
+    }
+    bool saved = persist(seq);
+    notifyChange();
+
+    if (saved) {
+        cout << "Prescription created for " << p.patientName << "\n";
+    } else {
+        cout << "Prescription for " << p.patientName << " was not saved.\n";
+    }
+    if (outbreak) {
+        cout << "ALERT: Potential outbreak of " << newP.diagnosis << " detected!\n";
+    }
 }
 
 vector<Prescription> HospitalController::getPendingPrescriptions() {
     vector<Prescription> pending;
-    for (const auto& p : prescriptions) {
-        if (p.status == "pending") {
-            pending.push_back(p);
-        }
+    shared_lock<shared_mutex> lock(prescriptionsMutex);
+    auto it = prescriptionsByStatus.find("pending");
+    if (it == prescriptionsByStatus.end()) return pending;
+
+    pending.reserve(it->second.size());
+    for (size_t pos : it->second) {
+        pending.push_back(prescriptions[pos]);
     }
     return pending;
 }
 
-void HospitalController::dispensePrescription(int prescriptionId) {
-    for (auto& p : prescriptions) {
-        if (p.id == prescriptionId && p.status == "pending") {
-            // Verify Signature
-            string dataToVerify = p.patientName + p.drugName + to_string(p.quantity) + p.date;
-            if (!signatureManager.verifySignature(dataToVerify, p.signature)) {
-                cout << "SECURITY ALERT: Digital Signature Verification Failed! Prescription may be tampered.\n";
-                return;
+vector<Prescription> HospitalController::getPrescriptionsBetween(int fromDay, int toDay) const {
+    vector<Prescription> dated;
+    vector<ArchiveSegment> segments;
+    {
+        shared_lock<shared_mutex> lock(prescriptionsMutex);
+        segments = segmentsBetween(archive.prescriptions, fromDay, toDay);
+        auto range = dayRange(prescriptionsByDay, fromDay, toDay);
+        dated.reserve(range.second - range.first);
+        for (auto it = range.first; it != range.second; ++it) dated.push_back(prescriptions[it->second]);
+    }
+    return withArchived(segments, move(dated), [&](const ArchiveSegment& s, vector<Prescription>& rows) {
+        DataManager::readArchivedPrescriptions(s, fromDay, toDay, "", rows);
+    });
+}
+
+vector<Prescription> HospitalController::getPrescriptionsForPatient(const string& patient, int fromDay,
+                                                                    int toDay) const {
+    vector<Prescription> found;
+    if (patient.empty()) return found;
+    vector<ArchiveSegment> segments;
+    {
+        shared_lock<shared_mutex> lock(prescriptionsMutex);
+        segments = segmentsBetween(archive.prescriptions, fromDay, toDay);
+        auto it = prescriptionsByPatient.find(Utils::toLowerCase(patient));
+        if (it != prescriptionsByPatient.end()) {
+            for (size_t pos : it->second) {
+                const Prescription& p = prescriptions[pos];
+                if (p.day >= fromDay && p.day <= toDay) found.push_back(p);
             }
+        }
+    }
+    stable_sort(found.begin(), found.end(), [](const Prescription& a, const Prescription& b) { return a.day < b.day; });
+    return withArchived(segments, move(found), [&](const ArchiveSegment& s, vector<Prescription>& rows) {
+        DataManager::readArchivedPrescriptions(s, fromDay, toDay, patient, rows);
+    });
+}
 
-            Drug* d = findDrug(p.drugName);
-            if (d && d->quantity >= p.quantity) {
-                d->quantity -= p.quantity;
-                p.status = "dispensed";
-                
-                // Auto-generate bill
-                generateBill(p.id);
-                
-                DataManager::saveDrugs(drugs);
-                DataManager::savePrescriptions(prescriptions);
-                cout << "Dispensed successfully. Bill generated.\n";
-            } else {
-                cout << "Error: Insufficient stock or drug not found.\n";
+void HospitalController::dispensePrescription(int prescriptionId) {
+    // Prescription contents never change after creation, so the signature
+    // can be checked on a copy without holding any lock
+    Prescription copy;
+    bool found = false;
+    shared_future<string> signing;
+    {
+        shared_lock<shared_mutex> lock(prescriptionsMutex);
+        if (const Prescription* p = findPrescription(prescriptionId)) {
+            copy = *p;
+            found = true;
+            auto it = pendingSignatures.find(prescriptionId);
+            if (it != pendingSignatures.end()) signing = it->second;
+        }
+    }
+    if (!found || copy.status != "pending") {
+        cout << "Prescription not found or already dispensed.\n";
+        return;
+    }
+    // A prescription created moments ago may still be queued for signing
+    if (copy.signature.empty() && signing.valid()) {
+        copy.signature = signing.get();
+    }
+    // No signature means signing failed, not that the record was altered
+    if (copy.signature.empty()) {
+        {
+            unique_lock<shared_mutex> lock(prescriptionsMutex);
+            const Prescription* stored = findPrescription(prescriptionId);
+            if (stored && stored->signature.empty() && !pendingSignatures.count(prescriptionId)) {
+                queuePrescriptionSigning(*stored);
             }
+        }
+        cout << "Prescription could not be signed yet. Please try dispensing again.\n";
+        return;
+    }
+
+    // Verify Signature
+    if (!signatureManager.verifySignature(prescriptionSigningData(copy), copy.signature)) {
+        cout << "SECURITY ALERT: Digital Signature Verification Failed! Prescription may be tampered.\n";
+        return;
+    }
+
+    // The drugs lock is only shared: stock moves through the atomic
+    // counters, so dispensers of the same drug never wait on each other.
+    shared_lock<shared_mutex> drugsLock(drugsMutex);
+    auto drug = drugIndex.find(Utils::toLowerCase(copy.drugName));
+    if (drug == drugIndex.end()) {
+        cout << "Error: Insufficient stock or drug not found.\n";
+        return;
+    }
+    size_t drugPos = drug->second;
+    StockLevel& level = stock[drugPos];
+
+    // Only this method removes ids, and only for a pending prescription it
+    // claims below, so a reservation seen here is still there at the claim
+    bool reserved;
+    {
+        shared_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        reserved = reservedPrescriptions.count(prescriptionId) > 0;
+    }
+    if (!reserved && !level.reserve(copy.quantity)) {
+        cout << "Error: Insufficient stock or drug not found.\n";
+        return;
+    }
+
+    uint64_t seq;
+    {
+        unique_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        // Another thread may have dispensed it since the check above, and
+        // a compaction may have archived it since
+        Prescription* p = findPrescription(prescriptionId);
+        if (!p || p->status != "pending") {
+            if (!reserved) level.release(copy.quantity);
+            cout << "Prescription not found or already dispensed.\n";
             return;
         }
+        reservedPrescriptions.erase(prescriptionId);
+        setPrescriptionStatus(*p, "dispensed");
+        seq = DataManager::logPrescription(archive.prescriptionBase() + (p - prescriptions.data()), *p);
+    }
+
+    // Exactly one dispenser sees the level cross the threshold
+    int left = level.commit(copy.quantity);
+    int threshold = drugs[drugPos].minThreshold;
+    if (left <= threshold && left + copy.quantity > threshold) {
+        dashboard.adjustLowStock(1);
+        lock_guard<mutex> guard(lowStockMutex);
+        lowStockDrugs.emplace(Utils::toLowerCase(drugs[drugPos].name), drugPos);
+    }
+    seq = max(seq, DataManager::logDrug(drugPos, [&] { return drugWithStock(drugPos); }));
+
+    // Auto-generate bill
+    {
+        unique_lock<shared_mutex> transactionsLock(transactionsMutex);
+        seq = max(seq, billPrescription(copy));
+    }
+    drugsLock.unlock();
+
+    bool saved = persist(seq);
+    notifyChange();
+    if (saved) {
+        cout << "Dispensed successfully. Bill generated.\n";
+    } else {
+        cout << "Dispensed, but the sale was not saved and may be lost on restart.\n";
     }
-    cout << "Prescription not found or already dispensed.\n";
 }
 
 // --- Billing ---
 void HospitalController::generateBill(int prescriptionId) {
-    for (const auto& p : prescriptions) {
-        if (p.id == prescriptionId) {
-            Drug* d = findDrug(p.drugName);
-            if (d) {
-                Transaction t;
-                t.id = transactions.size() + 1;
-                t.prescriptionId = prescriptionId;
-                t.amount = p.quantity * d->price;
-                t.date = Utils::getCurrentDate();
-                t.paymentMethod = "Pending";
-                
-                // Sign transaction
-                string dataToSign = to_string(t.id) + to_string(t.prescriptionId) + to_string(t.amount) + t.date;
-                t.signature = signatureManager.signData(dataToSign);
-
-                transactions.push_back(t);
-                DataManager::saveTransactions(transactions);
-                cout << "Bill generated: KES " << t.amount << "\n";
-            }
+    uint64_t seq = 0;
+    {
+        shared_lock<shared_mutex> drugsLock(drugsMutex);
+        shared_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        unique_lock<shared_mutex> transactionsLock(transactionsMutex);
+        const Prescription* p = findPrescription(prescriptionId);
+        if (p) seq = billPrescription(*p);
+    }
+    if (seq) {
+        persist(seq);
+        notifyChange();
+    }
+}
+
+// Returns the log sequence of the new transaction, or 0 if nothing was billed
+uint64_t HospitalController::billPrescription(const Prescription& p) {
+    const Drug* d = drugByName(p.drugName);
+    if (d) {
+        Transaction t;
+        t.id = ++maxTransactionId;
+        t.prescriptionId = p.id;
+        t.amount = p.quantity * d->price;
+        t.date = Utils::getCurrentDate();
+        t.day = Date::parse(t.date);
+        t.paymentMethod = "Pending";
+        t.signature = "";   // signed in the background
+
+        transactions.push_back(t);
+        transactionIndex.emplace(t.id, transactions.size() - 1);
+        indexByDay(transactionsByDay, t.day, transactions.size() - 1);
+        dashboard.transactionAdded(t);
+        uint64_t seq = DataManager::logTransaction(archive.transactionBase() + transactions.size() - 1, t);
+        queueTransactionSigning(t);
+        // The seal is logged after the rows it covers, so replay never
+        // restores a seal without them
+        size_t batch = ledger.append(t);
+        if (batch != static_cast<size_t>(-1)) {
+            seq = DataManager::logLedgerSeal(batch, ledger.seal(batch));
+            queueLedgerSigning(batch);
         }
+        cout << "Bill generated: KES " << t.amount << "\n";
+        return seq;
     }
+    return 0;
 }
 
 void HospitalController::processPayment(int transactionId, const string& method) {
-    for (auto& t : transactions) {
-        if (t.id == transactionId) {
-            t.paymentMethod = method;
-            DataManager::saveTransactions(transactions);
+    uint64_t seq = 0;
+    {
+        unique_lock<shared_mutex> lock(transactionsMutex);
+        Transaction* t = findTransaction(transactionId);
+        if (t) {
+            Transaction before = *t;
+            t->paymentMethod = method;
+            dashboard.transactionUpdated(before, *t);
+            seq = DataManager::logTransaction(archive.transactionBase() + (t - transactions.data()), *t);
+        }
+    }
+    if (seq) {
+        bool saved = persist(seq);
+        notifyChange();
+        if (saved) {
             cout << "Payment processed via " << method << "\n";
-            return;
+        } else {
+            cout << "Payment via " << method << " was not saved.\n";
         }
+        return;
     }
     cout << "Transaction not found.\n";
 }
 
-float HospitalController::getDailyRevenue() {
-    float total = 0;
-    string today = Utils::getCurrentDate();
-    for (const auto& t : transactions) {
-        if (t.date == today && t.paymentMethod != "Pending") {
-            total += t.amount;
-        }
+float HospitalController::getDailyRevenue() const {
+    return dashboard.revenueToday();
+}
+
+vector<Transaction> HospitalController::getRecentTransactions(size_t count) const {
+    shared_lock<shared_mutex> lock(transactionsMutex);
+    count = min(count, transactions.size());
+    return vector<Transaction>(transactions.rbegin(), transactions.rbegin() + count);
+}
+
+vector<Transaction> HospitalController::getTransactionsBetween(int fromDay, int toDay) const {
+    vector<Transaction> dated;
+    vector<ArchiveSegment> segments;
+    {
+        shared_lock<shared_mutex> lock(transactionsMutex);
+        segments = segmentsBetween(archive.transactions, fromDay, toDay);
+        auto range = dayRange(transactionsByDay, fromDay, toDay);
+        dated.reserve(range.second - range.first);
+        for (auto it = range.first; it != range.second; ++it) dated.push_back(transactions[it->second]);
     }
-    return total;
+    return withArchived(segments, move(dated), [&](const ArchiveSegment& s, vector<Transaction>& rows) {
+        DataManager::readArchivedTransactions(s, fromDay, toDay, rows);
+    });
+}
+
+DashboardStats::Snapshot HospitalController::getDashboard(size_t recentTransactions) const {
+    return dashboard.snapshot(recentTransactions);
+}
+
+// --- Ledger audit ---
+bool HospitalController::getLedgerProof(int transactionId, TransactionLedger::Proof& proof) const {
+    shared_lock<shared_mutex> lock(transactionsMutex);
+    size_t base = archive.transactionBase();
+    size_t pos;
+    auto it = transactionIndex.find(transactionId);
+    if (it != transactionIndex.end()) {
+        pos = base + it->second;
+    } else if (!DataManager::findArchivedTransaction(archive.transactions, transactionId, pos)) {
+        return false;
+    }
+    auto rows = transactionRows();
+    return rows(pos).id == transactionId && ledger.proof(pos, rows, proof);
+}
+
+// A proof is self-contained, so it is checked without the lock
+bool HospitalController::verifyLedgerProof(const TransactionLedger::Proof& proof) const {
+    return ledger.verify(proof);
 }
 
-vector<Transaction>& HospitalController::getTransactions() {
-    return transactions;
+TransactionLedger::AuditResult HospitalController::auditLedger() const {
+    shared_lock<shared_mutex> lock(transactionsMutex);
+    return ledger.audit(archive.transactionBase() + transactions.size(), transactionRows());
 }
 
 // --- AI & Reporting ---
+// Reads the detector's running state; nothing is rescanned
 void HospitalController::checkEpidemicTrends() {
-    map<string, int> diagnosisCounts;
-    for (const auto& p : prescriptions) {
-        // Simple check: count diagnoses in the list
-        // Ideally filter by date (last 24h)
-        diagnosisCounts[p.diagnosis]++;
-    }
+    auto report = getEpidemicReport();
 
     cout << "\n--- AI Epidemic Detection ---\n";
     bool alert = false;
-    for (const auto& pair : diagnosisCounts) {
-        if (pair.second > 5) { // Threshold of 5 cases
-            cout << "ALERT: Potential outbreak of " << pair.first << " detected! (" << pair.second << " cases)\n";
-            alert = true;
-        }
+    for (const auto& t : report.trends) {
+        if (!t.alert) break;   // alerts sort first
+        ostringstream baseline;
+        baseline << fixed << setprecision(1) << t.baseline;
+        cout << "ALERT: Potential outbreak of " << t.diagnosis << " detected! (" << t.today << " cases today, "
+             << t.window << " in " << report.config.windowDays << " days, baseline "
+             << baseline.str() << "/day)\n";
+        alert = true;
     }
     if (!alert) cout << "No abnormal trends detected.\n";
 }
 
+EpidemicDetector::Report HospitalController::getEpidemicReport() const {
+    return epidemics.report();
+}
+
+void HospitalController::configureEpidemicDetection(const EpidemicDetector::Config& config) {
+    unique_lock<shared_mutex> lock(prescriptionsMutex);
+    resetEpidemics(config);
+}
+
 void HospitalController::generateReport() {
+    size_t drugCount, prescriptionCount, transactionCount, archivedPrescriptionCount, archivedTransactionCount;
+    vector<pair<string, string>> signedData;
+    vector<ArchiveSegment> archivedPrescriptions;
+    {
+        shared_lock<shared_mutex> drugsLock(drugsMutex);
+        drugCount = drugs.size();
+    }
+    {
+        shared_lock<shared_mutex> prescriptionsLock(prescriptionsMutex);
+        archivedPrescriptions = archive.prescriptions;
+        archivedPrescriptionCount = archive.prescriptionBase();
+        prescriptionCount = archivedPrescriptionCount + prescriptions.size();
+        signedData.reserve(prescriptions.size());
+        for (const auto& p : prescriptions) {
+            signedData.emplace_back(prescriptionSigningData(p), p.signature);
+        }
+    }
+    {
+        shared_lock<shared_mutex> transactionsLock(transactionsMutex);
+        archivedTransactionCount = archive.transactionBase();
+        transactionCount = archivedTransactionCount + transactions.size();
+    }
     cout << "\n--- System Report ---\n";
-    cout << "Total Users: " << users.size() << "\n";
-    cout << "Total Drugs: " << drugs.size() << "\n";
-    cout << "Total Prescriptions: " << prescriptions.size() << "\n";
-    cout << "Total Transactions: " << transactions.size() << "\n";
+    cout << "Total Users: " << getUserCount() << "\n";
+    cout << "Total Drugs: " << drugCount << "\n";
+    cout << "Total Prescriptions: " << prescriptionCount << " (" << archivedPrescriptionCount << " archived)\n";
+    cout << "Total Transactions: " << transactionCount << " (" << archivedTransactionCount << " archived)\n";
+    auto valid = signatureManager.verifyBatch(signedData);
+    size_t failing = count(valid.begin(), valid.end(), false);
+    // Archived months are checked one segment at a time; unreadable rows count as failing
+    for (const auto& segment : archivedPrescriptions) {
+        vector<Prescription> rows;
+        DataManager::readArchivedPrescriptions(segment, INT_MIN, INT_MAX, "", rows);
+        signedData.clear();
+        for (const auto& p : rows) signedData.emplace_back(prescriptionSigningData(p), p.signature);
+        valid = signatureManager.verifyBatch(signedData);
+        failing += count(valid.begin(), valid.end(), false) + (segment.rows - min(segment.rows, rows.size()));
+    }
+    cout << "Prescriptions failing signature check: " << failing << "\n";
+    auto audit = auditLedger();
+    if (audit.firstBadBatch != static_cast<size_t>(-1)) {
+        cout << "Transaction ledger: TAMPERED, batch " << audit.firstBadBatch << " does not match its seal\n";
+    } else if (audit.batches > 0 && !audit.signatureValid) {
+        cout << "Transaction ledger: seal signature INVALID\n";
+    } else {
+        cout << "Transaction ledger: intact, " << audit.sealedRows << " of " << transactionCount
+             << " transactions sealed in " << audit.batches << " batches\n";
+    }
     cout << "Daily Revenue: KES " << getDailyRevenue() << "\n";
 }
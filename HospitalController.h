@@ -3,53 +3,251 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <optional>
+#include <atomic>
+#include <future>
+#include <functional>
 #include "User.h"
 #include "Drug.h"
 #include "Prescription.h"
 #include "Transaction.h"
-#include "Transaction.h"
+#include "StockLevel.h"
+#include "DrugQuery.h"
 #include "DataManager.h"
 #include "DigitalSignatureManager.h"
+#include "SigningQueue.h"
+#include "TransactionLedger.h"
+#include "DashboardStats.h"
+#include "EpidemicDetector.h"
+#include "SessionTable.h"
+#include "PasswordHasher.h"
 
+// Thread safety: every table is guarded by its own reader-writer lock, so
+// the web server's read-heavy endpoints run in parallel and only contend
+// with writers of the same table. Public methods take the locks they need
+// and hand out copies, never references into the tables. When several
+// locks are held they are always taken in the order users, drugs,
+// prescriptions, transactions. Stock levels are atomic counters, so
+// dispensing only needs the drugs lock shared.
+//
+// Prescriptions and transactions are partitioned by age. Settled rows
+// dated before the hot window (the current month and the hotWindowMonths
+// - 1 before it) are moved at compaction into read-only monthly archive
+// segments and dropped from memory; date-range and patient queries map
+// only the segments whose dates overlap. The in-memory vectors hold the
+// hot rows, at table positions archive base + index.
 class HospitalController {
 private:
     std::vector<User> users;
     std::vector<Drug> drugs;
+    // Live stock, one entry per drug (a deque so entries never move). The
+    // quantity field of drugs[] is only the value loaded from disk.
+    std::deque<StockLevel> stock;
     std::vector<Prescription> prescriptions;
     std::vector<Transaction> transactions;
-    User* currentUser;
+    // Its prescription and transaction segments are guarded by the
+    // matching table lock; archiving holds both exclusively
+    ArchiveManifest archive;
+    std::atomic<int> hotWindowMonths;
+    mutable std::shared_mutex usersMutex;
+    mutable std::shared_mutex drugsMutex;
+    mutable std::shared_mutex prescriptionsMutex;
+    mutable std::shared_mutex transactionsMutex;
+    std::mutex compactionMutex;
+
     DigitalSignatureManager signatureManager;
+    // Signed-in console and web users, by token
+    SessionTable sessions;
+    // Checks login passwords off the request threads
+    PasswordHasher passwordHasher;
+
+    // Indexes into the vectors above, guarded by the same table locks. They
+    // hold positions rather than pointers because push_back may reallocate;
+    // records are only erased by archiving, which rebuilds them.
+    std::unordered_map<std::string, size_t> userIndex;       // username
+    std::unordered_map<std::string, size_t> drugIndex;       // case-folded name
+    std::unordered_map<int, size_t> prescriptionIndex;       // prescription id
+    std::unordered_map<int, size_t> transactionIndex;        // transaction id
+    std::map<std::string, std::set<size_t>> prescriptionsByStatus;
+    std::unordered_map<std::string, std::vector<size_t>> prescriptionsByPatient;   // case-folded
+    // (day number, position), sorted: drug expiry, prescription and
+    // transaction dates. Undated records sort first under Date::invalid.
+    using DayIndex = std::vector<std::pair<int, size_t>>;
+    DayIndex drugsByExpiry;
+    // (case-folded name, position), sorted: the name order of drug pages
+    using NameIndex = std::vector<std::pair<std::string, size_t>>;
+    NameIndex drugsByName;
+    // The drugs at or below their threshold, in the same order. Dispensing
+    // adds to it with the drugs lock only shared, so it has its own mutex,
+    // taken after the drugs lock.
+    mutable std::mutex lowStockMutex;
+    std::set<std::pair<std::string, size_t>> lowStockDrugs;
+    DayIndex prescriptionsByDay;
+    DayIndex transactionsByDay;
+    int maxPrescriptionId;                 // including archived ids
+    int maxTransactionId;                  // including archived ids
+    // Updated alongside every change to the tables above
+    DashboardStats dashboard;
+    // Fed each new prescription's diagnosis
+    EpidemicDetector epidemics;
+
+    // With reserveOnCreate, creating a prescription reserves its stock and
+    // the ids here hold a reservation (guarded by prescriptionsMutex)
+    const bool reserveOnCreate;
+    std::unordered_set<int> reservedPrescriptions;
+
+    // Records are persisted with an empty signature ("signature pending")
+    // and signed by signingQueue. Prescriptions still waiting have a future
+    // here (guarded by prescriptionsMutex) that dispensing can wait on.
+    std::unordered_map<int, std::shared_future<std::string>> pendingSignatures;
+    std::atomic<uint64_t> signatureSeq;     // last log record of a signing callback
+    // Merkle/hash-chain view of the transactions, guarded by transactionsMutex
+    TransactionLedger ledger;
+    std::mutex listenerMutex;
+    std::function<void()> changeListener;
+    // Declared last so its workers stop before anything they touch is gone
+    SigningQueue signingQueue;
+
+    // Callers hold the lock of the table being looked up or changed
+    void rebuildIndexes();
+    // The prescription and transaction indexes, dashboard and outbreak
+    // baselines; callers also hold the drugs lock
+    void rebuildRecordIndexes();
+    uint64_t renumberDuplicatePrescriptions();
+    uint64_t renumberDuplicateTransactions(const std::vector<LedgerSeal>& seals);
+    void indexPrescription(size_t pos);
+    void setPrescriptionStatus(Prescription& p, const std::string& status);
+    Drug* drugByName(const std::string& name);
+    // Copies with the live stock filled in; callers hold the drugs lock
+    Drug drugWithStock(size_t pos) const;
+    std::vector<Drug> drugsWithStock() const;
+    void reservePendingPrescriptions();
+    Prescription* findPrescription(int id);
+    Transaction* findTransaction(int id);
+
+    // Queue a stored record for signing; callers hold its table lock
+    // exclusively, so the callback cannot run before the record is indexed
+    void queuePrescriptionSigning(const Prescription& p);
+    void queueTransactionSigning(const Transaction& t);
+    void queueLedgerSigning(size_t batch);
+    void queueUnsignedRecords();
+    void noteSignatureSeq(uint64_t seq);
+
+    // Bills a prescription without committing, so dispensing can make the
+    // stock, status and bill changes durable together. Callers hold the
+    // drugs lock (shared at least) and the transactions lock exclusively.
+    uint64_t billPrescription(const Prescription& p);
+    // Waits until the log holds everything up to seq, then compacts the log
+    // when it has grown large. Call without holding any table lock, so that
+    // other writers can join the same group commit. False, after saying
+    // so, when the records could not be made durable; the operation must
+    // then not be reported as done.
+    bool persist(uint64_t seq);
+    void compact();
+    // First day of the hot window
+    int hotWindowStart() const;
+    // How many leading hot rows can be archived: dated before hotStart and
+    // settled (dispensed or paid, and signed), so they never change again.
+    // Counting stops at the first row that is not.
+    size_t archivablePrescriptions(int hotStart) const;
+    size_t archivableTransactions(int hotStart) const;
+    // Transactions by table position for the ledger, archived ones read a
+    // segment at a time; callers hold transactionsMutex
+    TransactionLedger::RowSource transactionRows() const;
+    void notifyChange();
+    // Caller holds prescriptionsMutex
+    void resetEpidemics(const EpidemicDetector::Config& config);
 
 public:
-    HospitalController();
+    explicit HospitalController(bool reserveOnCreate = false);
     ~HospitalController();
 
+    // Called, without any table lock held, after each change to stock,
+    // prescriptions or transactions; it should only note the change and
+    // return. Pass nullptr to remove it.
+    void setChangeListener(std::function<void()> listener);
+    // Months kept in memory, counting the current one (default 3); older
+    // settled records are archived at the next compaction
+    void setHotWindowMonths(int months);
+    // Cost of new password records and the login admission limits
+    void setPasswordHashing(const PasswordHasher::Config& config);
+
     // User Management
-    bool login(const std::string& username, const std::string& password);
-    void logout();
-    User* getCurrentUser();
-    void addUser(const User& user);
+    // Checks credentials without opening a session. done runs on a hashing
+    // worker with the result and, on a match, the user. Busy means the
+    // hashing service turned the check away; false, without calling done,
+    // if it did so at once. A match against a plaintext record (or one at
+    // an outdated cost) replaces it with a fresh hash.
+    using AuthenticateCallback = std::function<void(PasswordHasher::Result result, const User& user)>;
+    bool authenticate(const std::string& username, const std::string& password, AuthenticateCallback done);
+    PasswordHasher::Result authenticate(const std::string& username, const std::string& password, User& user);
+    // Opens a session once the credentials check out. done runs on a
+    // hashing worker with its token, or "" if the credentials are wrong or
+    // busy is set; false, without calling done, if turned away at once.
+    using LoginCallback = std::function<void(const std::string& token, bool busy)>;
+    bool login(const std::string& username, const std::string& password, LoginCallback done);
+    // The same, waiting on the calling thread
+    std::string login(const std::string& username, const std::string& password, bool* busy = nullptr);
+    void logout(const std::string& token);
+    // The session's user (without password), or nullopt once it has expired
+    std::optional<User> getSessionUser(const std::string& token);
+    size_t getUserCount() const;
+    // False if the user could not be saved
+    bool addUser(const User& user);
 
     // Inventory
-    void addDrug(const Drug& drug);
-    std::vector<Drug>& getDrugs();
-    Drug* findDrug(const std::string& name);
+    // False if the drug could not be saved
+    bool addDrug(const Drug& drug);
+    std::vector<Drug> getDrugs() const;
+    std::optional<Drug> findDrug(const std::string& name) const;
     void checkLowStock();
+    // Soonest expiry first; both are O(log n + k) on the expiry index
+    std::vector<Drug> getExpiredDrugs() const;
+    std::vector<Drug> getDrugsExpiringWithin(int days) const;
+    // One page of drugs, in O(log n + page) on the name, low-stock or
+    // expiry index (plus rows skipped by any further filters); false if
+    // the cursor is not one this query could have handed out
+    bool getDrugPage(const DrugQuery& query, DrugPage& page) const;
     void checkExpiry();
 
     // Prescription
     void createPrescription(const Prescription& p);
     std::vector<Prescription> getPendingPrescriptions();
     void dispensePrescription(int prescriptionId);
+    // Dated fromDay..toDay inclusive (Date day numbers), oldest first
+    std::vector<Prescription> getPrescriptionsBetween(int fromDay, int toDay) const;
+    // The patient's prescriptions (ignoring case) dated fromDay..toDay
+    std::vector<Prescription> getPrescriptionsForPatient(const std::string& patient, int fromDay, int toDay) const;
 
     // Billing
     void generateBill(int prescriptionId);
     void processPayment(int transactionId, const std::string& method);
-    float getDailyRevenue();
-    std::vector<Transaction>& getTransactions();
+    float getDailyRevenue() const;
+    // Newest first
+    std::vector<Transaction> getRecentTransactions(size_t count) const;
+    // Dated fromDay..toDay inclusive, oldest first
+    std::vector<Transaction> getTransactionsBetween(int fromDay, int toDay) const;
+    // Today's revenue, low-stock and pending counts and the newest
+    // transactions, without touching the tables
+    DashboardStats::Snapshot getDashboard(size_t recentTransactions) const;
+
+    // Ledger audit
+    bool getLedgerProof(int transactionId, TransactionLedger::Proof& proof) const;
+    bool verifyLedgerProof(const TransactionLedger::Proof& proof) const;
+    TransactionLedger::AuditResult auditLedger() const;
 
     // AI & Reporting
     void checkEpidemicTrends();
+    EpidemicDetector::Report getEpidemicReport() const;
+    // Replays every prescription under the new windows and thresholds
+    void configureEpidemicDetection(const EpidemicDetector::Config& config);
     void generateReport();
 };
 
@@ -0,0 +1,296 @@
+#include "HttpRequestParser.h"
+#include <cstring>
+#include <cctype>
+
+using namespace std;
+
+static bool equalsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+static bool containsIgnoreCase(string_view haystack, string_view needle) {
+    if (needle.size() > haystack.size()) return false;
+    for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        if (equalsIgnoreCase(haystack.substr(i, needle.size()), needle)) return true;
+    }
+    return false;
+}
+
+// Longest chunk-size line, extensions included
+static const size_t maxChunkLine = 1024;
+
+static bool isTokenChar(char c) {
+    return isalnum((unsigned char)c) || strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
+
+// --- HttpRequest ---
+
+string_view HttpRequest::header(string_view name) const {
+    for (const auto& h : headers) {
+        if (equalsIgnoreCase(h.name, name)) return h.value;
+    }
+    return string_view();
+}
+
+// HTTP/1.1 connections persist unless the client asks to close; HTTP/1.0
+// clients have to opt in.
+bool HttpRequest::keepAlive() const {
+    string_view connection = header("Connection");
+    if (containsIgnoreCase(connection, "close")) return false;
+    if (containsIgnoreCase(connection, "keep-alive")) return true;
+    return version == "HTTP/1.1";
+}
+
+// --- HttpRequestParser ---
+
+HttpRequestParser::HttpRequestParser(size_t headerLimit, size_t bodyLimit, size_t headerCountLimit)
+    : maxHeaderBytes(headerLimit), maxBodyBytes(bodyLimit), maxHeaderCount(headerCountLimit) {
+    reset();
+}
+
+void HttpRequestParser::reset() {
+    state = State::RequestLine;
+    status = Status::Incomplete;
+    error = 0;
+    pos = 0;
+    methodSpan = targetSpan = versionSpan = bodySpan = Span();
+    headerSpans.clear();
+    contentLength = 0;
+    chunkRemaining = 0;
+    chunked = false;
+    expectContinue = false;
+    decodedBody.clear();
+    req = HttpRequest();
+}
+
+HttpRequestParser::Status HttpRequestParser::fail(int httpStatus) {
+    state = State::Failed;
+    error = httpStatus;
+    status = Status::Error;
+    return status;
+}
+
+// Finds the next line starting at pos. lineEnd excludes the CR/LF, next is
+// the offset just past the LF. Bare LF line endings are tolerated.
+bool HttpRequestParser::nextLine(const char* data, size_t length, size_t& lineEnd, size_t& next) {
+    const char* nl = (const char*)memchr(data + pos, '\n', length - pos);
+    if (!nl) return false;
+    next = (nl - data) + 1;
+    lineEnd = nl - data;
+    if (lineEnd > pos && data[lineEnd - 1] == '\r') --lineEnd;
+    return true;
+}
+
+HttpRequestParser::Status HttpRequestParser::parse(const char* data, size_t length) {
+    if (status != Status::Incomplete) return status;
+
+    while (true) {
+        size_t lineEnd = 0, next = 0;
+        switch (state) {
+            case State::RequestLine:
+            case State::Headers: {
+                if (!nextLine(data, length, lineEnd, next)) {
+                    if (length > maxHeaderBytes) return fail(431);
+                    return Status::Incomplete;
+                }
+                if (next > maxHeaderBytes) return fail(431);
+
+                if (state == State::RequestLine) {
+                    // Stray CRLFs between pipelined requests are ignored
+                    if (lineEnd == pos) { pos = next; break; }
+                    if (!parseRequestLine(data, pos, lineEnd)) return fail(400);
+                    state = State::Headers;
+                    pos = next;
+                } else if (lineEnd == pos) {
+                    pos = next;
+                    beginBody(data);
+                    if (state == State::Done || state == State::Failed) return status;
+                } else {
+                    if (headerSpans.size() >= maxHeaderCount) return fail(431);
+                    if (!parseHeaderLine(data, pos, lineEnd)) return fail(400);
+                    pos = next;
+                }
+                break;
+            }
+            case State::Body: {
+                if (length - pos < contentLength) return Status::Incomplete;
+                bodySpan.offset = pos;
+                bodySpan.length = contentLength;
+                pos += contentLength;
+                return finish(data);
+            }
+            case State::ChunkSize: {
+                if (!nextLine(data, length, lineEnd, next)) {
+                    if (length - pos > maxChunkLine) return fail(400);
+                    return Status::Incomplete;
+                }
+                // Also checked once the whole line is here, so the limit
+                // does not depend on how the line was split across reads
+                if (next - 1 - pos > maxChunkLine) return fail(400);
+                size_t size = 0;
+                size_t i = pos;
+                for (; i < lineEnd && isxdigit((unsigned char)data[i]); ++i) {
+                    if (size > (maxBodyBytes >> 4)) return fail(413);
+                    char c = data[i];
+                    size = size * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower(c) - 'a' + 10));
+                }
+                // Chunk extensions after ';' are ignored
+                if (i == pos || (i < lineEnd && data[i] != ';' && data[i] != ' ' && data[i] != '\t')) return fail(400);
+                if (decodedBody.size() + size > maxBodyBytes) return fail(413);
+                pos = next;
+                chunkRemaining = size;
+                state = size == 0 ? State::Trailers : State::ChunkData;
+                break;
+            }
+            case State::ChunkData: {
+                // Copy whatever part of the chunk has arrived so partial reads
+                // are never rescanned.
+                size_t available = min(length - pos, chunkRemaining);
+                decodedBody.append(data + pos, available);
+                pos += available;
+                chunkRemaining -= available;
+                if (chunkRemaining > 0) return Status::Incomplete;
+                state = State::ChunkDataEnd;
+                break;
+            }
+            case State::ChunkDataEnd: {
+                if (length - pos < 1) return Status::Incomplete;
+                if (data[pos] == '\n') { pos += 1; state = State::ChunkSize; break; }
+                if (length - pos < 2) return Status::Incomplete;
+                if (data[pos] != '\r' || data[pos + 1] != '\n') return fail(400);
+                pos += 2;
+                state = State::ChunkSize;
+                break;
+            }
+            case State::Trailers: {
+                if (!nextLine(data, length, lineEnd, next)) {
+                    if (length - pos > maxHeaderBytes) return fail(431);
+                    return Status::Incomplete;
+                }
+                if (next - 1 - pos > maxHeaderBytes) return fail(431);
+                // Trailer fields are accepted but not exposed
+                bool blank = lineEnd == pos;
+                pos = next;
+                if (blank) return finish(data);
+                break;
+            }
+            case State::Done:
+            case State::Failed:
+                return status;
+        }
+    }
+}
+
+bool HttpRequestParser::parseRequestLine(const char* data, size_t begin, size_t end) {
+    const char* line = data + begin;
+    size_t len = end - begin;
+
+    const char* sp1 = (const char*)memchr(line, ' ', len);
+    if (!sp1 || sp1 == line) return false;
+    const char* sp2 = (const char*)memchr(sp1 + 1, ' ', len - (sp1 + 1 - line));
+    if (!sp2 || sp2 == sp1 + 1) return false;
+
+    for (const char* c = line; c < sp1; ++c) {
+        if (!isTokenChar(*c)) return false;
+    }
+
+    methodSpan = { begin, (size_t)(sp1 - line) };
+    targetSpan = { begin + (sp1 + 1 - line), (size_t)(sp2 - sp1 - 1) };
+    versionSpan = { begin + (sp2 + 1 - line), (size_t)(line + len - sp2 - 1) };
+
+    string_view version(data + versionSpan.offset, versionSpan.length);
+    return version == "HTTP/1.1" || version == "HTTP/1.0";
+}
+
+bool HttpRequestParser::parseHeaderLine(const char* data, size_t begin, size_t end) {
+    const char* line = data + begin;
+    size_t len = end - begin;
+
+    const char* colon = (const char*)memchr(line, ':', len);
+    if (!colon || colon == line) return false;
+    for (const char* c = line; c < colon; ++c) {
+        if (!isTokenChar(*c)) return false;
+    }
+
+    size_t valueBegin = colon + 1 - line;
+    size_t valueEnd = len;
+    while (valueBegin < valueEnd && (line[valueBegin] == ' ' || line[valueBegin] == '\t')) ++valueBegin;
+    while (valueEnd > valueBegin && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) --valueEnd;
+
+    Span name = { begin, (size_t)(colon - line) };
+    Span value = { begin + valueBegin, valueEnd - valueBegin };
+    headerSpans.push_back({ name, value });
+    return true;
+}
+
+// Decides how the body is framed once the blank line after the headers has
+// been consumed.
+void HttpRequestParser::beginBody(const char* data) {
+    bool haveLength = false;
+    for (const auto& h : headerSpans) {
+        string_view name(data + h.first.offset, h.first.length);
+        string_view value(data + h.second.offset, h.second.length);
+
+        if (equalsIgnoreCase(name, "Content-Length")) {
+            if (value.empty()) { fail(400); return; }
+            size_t parsed = 0;
+            for (char c : value) {
+                if (!isdigit((unsigned char)c)) { fail(400); return; }
+                if (parsed > maxBodyBytes) break;
+                parsed = parsed * 10 + (c - '0');
+            }
+            if (haveLength && parsed != contentLength) { fail(400); return; }
+            contentLength = parsed;
+            haveLength = true;
+        } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+            if (!equalsIgnoreCase(value, "chunked")) { fail(501); return; }
+            chunked = true;
+        } else if (equalsIgnoreCase(name, "Expect")) {
+            expectContinue = equalsIgnoreCase(value, "100-continue");
+        }
+    }
+
+    // A request carrying both framings is a smuggling vector; refuse it
+    if (chunked && haveLength) { fail(400); return; }
+    if (contentLength > maxBodyBytes) { fail(413); return; }
+
+    if (chunked) {
+        state = State::ChunkSize;
+    } else if (contentLength > 0) {
+        state = State::Body;
+    } else {
+        bodySpan = { pos, 0 };
+        finish(data);
+    }
+}
+
+HttpRequestParser::Status HttpRequestParser::finish(const char* data) {
+    req.method = string_view(data + methodSpan.offset, methodSpan.length);
+    req.target = string_view(data + targetSpan.offset, targetSpan.length);
+    req.version = string_view(data + versionSpan.offset, versionSpan.length);
+
+    size_t question = req.target.find('?');
+    req.path = req.target.substr(0, question);
+    req.query = question == string_view::npos ? string_view() : req.target.substr(question + 1);
+
+    req.headers.clear();
+    req.headers.reserve(headerSpans.size());
+    for (const auto& h : headerSpans) {
+        req.headers.push_back({ string_view(data + h.first.offset, h.first.length),
+                                string_view(data + h.second.offset, h.second.length) });
+    }
+
+    if (chunked) {
+        req.body = string_view(decodedBody);
+    } else {
+        req.body = string_view(data + bodySpan.offset, bodySpan.length);
+    }
+
+    state = State::Done;
+    status = Status::Complete;
+    return status;
+}
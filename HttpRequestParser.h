@@ -0,0 +1,87 @@
+#ifndef HTTPREQUESTPARSER_H
+#define HTTPREQUESTPARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// A parsed request. All views point either into the buffer last handed to
+// HttpRequestParser::parse() or, for chunked bodies, into the parser itself,
+// so a request is only valid until that buffer changes or the parser is reset.
+struct HttpRequest {
+    std::string_view method;
+    std::string_view target;  // path plus query, as sent
+    std::string_view path;
+    std::string_view query;   // without the leading '?'
+    std::string_view version;
+    std::vector<HttpHeader> headers;
+    std::string_view body;
+
+    // Case-insensitive lookup; returns an empty view if the header is absent
+    std::string_view header(std::string_view name) const;
+    bool keepAlive() const;
+};
+
+// Incremental HTTP/1.x request parser. parse() may be called repeatedly as
+// more bytes arrive; the buffer must keep the bytes already seen at the same
+// offsets but is free to move (e.g. a std::string that reallocates). Only
+// offsets are stored while parsing, views are materialised on completion.
+class HttpRequestParser {
+public:
+    enum class Status { Incomplete, Complete, Error };
+
+    HttpRequestParser(size_t maxHeaderBytes = 16 * 1024,
+                      size_t maxBodyBytes = 8 * 1024 * 1024,
+                      size_t maxHeaderCount = 64);
+
+    Status parse(const char* data, size_t length);
+    void reset();
+
+    const HttpRequest& request() const { return req; }
+    // Bytes of the buffer that belong to the completed request
+    size_t consumed() const { return pos; }
+    // 400, 413, 431 or 501 once parse() returned Error
+    int errorStatus() const { return error; }
+    // True once the header block is in and the client sent Expect: 100-continue
+    bool expectsContinue() const { return expectContinue && state > State::Headers && state != State::Done; }
+
+private:
+    enum class State { RequestLine, Headers, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, Done, Failed };
+
+    struct Span {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    size_t maxHeaderBytes;
+    size_t maxBodyBytes;
+    size_t maxHeaderCount;
+
+    State state;
+    Status status;
+    int error;
+    size_t pos;
+    Span methodSpan, targetSpan, versionSpan, bodySpan;
+    std::vector<std::pair<Span, Span>> headerSpans;
+    size_t contentLength;
+    size_t chunkRemaining;
+    bool chunked;
+    bool expectContinue;
+    std::string decodedBody;
+    HttpRequest req;
+
+    Status fail(int httpStatus);
+    Status finish(const char* data);
+    bool nextLine(const char* data, size_t length, size_t& lineEnd, size_t& next);
+    bool parseRequestLine(const char* data, size_t begin, size_t end);
+    bool parseHeaderLine(const char* data, size_t begin, size_t end);
+    void beginBody(const char* data);
+};
+
+#endif
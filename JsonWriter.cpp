@@ -0,0 +1,121 @@
+#include "JsonWriter.h"
+#include <cmath>
+
+using namespace std;
+
+JsonWriter::JsonWriter(string& o) : out(o), afterKey(false) {}
+
+// Called before every value or key: a comma if the enclosing container
+// already has a member, nothing right after a key
+void JsonWriter::separate() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (hasMembers.empty()) return;
+    if (hasMembers.back()) out += ',';
+    hasMembers.back() = true;
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    out += '{';
+    hasMembers.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    hasMembers.pop_back();
+    out += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    out += '[';
+    hasMembers.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    hasMembers.pop_back();
+    out += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(string_view name) {
+    separate();
+    appendJsonString(out, name);
+    out += ':';
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(string_view s) {
+    separate();
+    appendJsonString(out, s);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+    separate();
+    out += b ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(string_view json) {
+    separate();
+    out.append(json.data(), json.size());
+    return *this;
+}
+
+// Floats go through the float overload of to_chars, so 12.3f prints as
+// 12.3 rather than 12.300000190734863
+void JsonWriter::number(double v) {
+    separate();
+    if (!isfinite(v)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    float f = static_cast<float>(v);
+    auto result = static_cast<double>(f) == v ? to_chars(buffer, buffer + sizeof(buffer), f)
+                                                 : to_chars(buffer, buffer + sizeof(buffer), v);
+    out.append(buffer, result.ptr);
+}
+
+// Copies runs of plain characters in one append; only quotes, backslashes
+// and control characters are escaped. Other bytes, including UTF-8
+// sequences, pass through unchanged.
+void appendJsonString(string& out, string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    size_t runStart = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+        }
+    }
+    out.append(s.data() + runStart, s.size() - runStart);
+    out += '"';
+}
@@ -0,0 +1,64 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <type_traits>
+
+// Appends JSON to a string owned by the caller, so one buffer (e.g. a
+// connection's output buffer, or a per-thread scratch buffer) serves many
+// responses without reallocating. The writer places commas and colons;
+// strings are escaped per RFC 8259, numbers are formatted with to_chars
+// (shortest round-trip for floats) and non-finite numbers become null.
+//
+//     JsonWriter json(out);
+//     json.beginObject().field("name", d.name).field("price", d.price).endObject();
+class JsonWriter {
+private:
+    std::string& out;
+    std::vector<bool> hasMembers;   // one entry per open object or array
+    bool afterKey;
+
+    void separate();
+    void number(double v);
+
+public:
+    explicit JsonWriter(std::string& out);
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view s);
+    JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+    JsonWriter& value(const std::string& s) { return value(std::string_view(s)); }
+    JsonWriter& value(bool b);
+    JsonWriter& value(float v) { number(v); return *this; }
+    JsonWriter& value(double v) { number(v); return *this; }
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    JsonWriter& value(T v) {
+        separate();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+        out.append(buffer, result.ptr);
+        return *this;
+    }
+    JsonWriter& null();
+    // Inserts an already serialised JSON value as is
+    JsonWriter& raw(std::string_view json);
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) {
+        key(name);
+        return value(v);
+    }
+};
+
+// Appends s as a quoted, escaped JSON string
+void appendJsonString(std::string& out, std::string_view s);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef LEDGERSEAL_H
+#define LEDGERSEAL_H
+
+#include <string>
+
+// One closed batch of the transaction ledger (see TransactionLedger.h)
+struct LedgerSeal {
+    size_t count;          // transactions in the batch
+    std::string head;      // hex chain head after the batch
+    std::string signature; // signature over the head; empty while pending
+};
+
+#endif
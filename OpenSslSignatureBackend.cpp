@@ -0,0 +1,114 @@
+#include "OpenSslSignatureBackend.h"
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+
+using namespace std;
+
+OpenSslSignatureBackend::OpenSslSignatureBackend(const string& path) : keyPath(path), key(nullptr) {}
+
+OpenSslSignatureBackend::~OpenSslSignatureBackend() {
+    EVP_PKEY_free(key);
+}
+
+bool OpenSslSignatureBackend::init() {
+    if (key) return true;
+    return loadKey() || generateKey();
+}
+
+bool OpenSslSignatureBackend::loadKey() {
+    FILE* f = fopen(keyPath.c_str(), "rb");
+    if (!f) return false;
+    key = PEM_read_PrivateKey(f, NULL, NULL, NULL);
+    fclose(f);
+    if (!key || EVP_PKEY_id(key) != EVP_PKEY_ED25519) {
+        cerr << "Error: " << keyPath << " does not hold an Ed25519 private key\n";
+        EVP_PKEY_free(key);
+        key = nullptr;
+        // Refuse to fall through to generateKey() and overwrite it
+        return false;
+    }
+    return true;
+}
+
+bool OpenSslSignatureBackend::generateKey() {
+    if (access(keyPath.c_str(), F_OK) == 0) return false;
+
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, NULL);
+    bool ok = ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_keygen(ctx, &key) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        cerr << "Error generating Ed25519 key\n";
+        return false;
+    }
+
+    // Only the owner may read the private key
+    int fd = open(keyPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    FILE* f = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!f) {
+        if (fd >= 0) close(fd);
+        cerr << "Error: cannot create " << keyPath << "\n";
+        return false;
+    }
+    ok = PEM_write_PrivateKey(f, key, NULL, NULL, 0, NULL, NULL) == 1;
+    ok = fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+    fclose(f);
+    if (!ok) cerr << "Error: cannot write " << keyPath << "\n";
+    return ok;
+}
+
+vector<unsigned char> OpenSslSignatureBackend::sign(const string& data) {
+    vector<unsigned char> signature;
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    size_t length = 0;
+    // Ed25519 hashes internally, so no digest is passed and the one-shot
+    // EVP_DigestSign is required
+    if (ctx && key && EVP_DigestSignInit(ctx, NULL, NULL, NULL, key) == 1
+        && EVP_DigestSign(ctx, NULL, &length, (const unsigned char*)data.data(), data.size()) == 1) {
+        signature.resize(length);
+        if (EVP_DigestSign(ctx, signature.data(), &length, (const unsigned char*)data.data(), data.size()) == 1) {
+            signature.resize(length);
+        } else {
+            signature.clear();
+        }
+    }
+    if (signature.empty()) cerr << "Error during EVP_DigestSign.\n";
+    EVP_MD_CTX_free(ctx);
+    return signature;
+}
+
+bool OpenSslSignatureBackend::verify(const string& data, const vector<unsigned char>& signature) {
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    bool ok = ctx && key && EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, key) == 1
+              && EVP_DigestVerify(ctx, signature.data(), signature.size(),
+                                  (const unsigned char*)data.data(), data.size()) == 1;
+    EVP_MD_CTX_free(ctx);
+    return ok;
+}
+
+vector<unsigned char> OpenSslSignatureBackend::digest(const string& data) {
+    vector<unsigned char> value(EVP_MAX_MD_SIZE);
+    unsigned int length = 0;
+    if (EVP_Digest(data.data(), data.size(), value.data(), &length, EVP_sha256(), NULL) != 1) return {};
+    value.resize(length);
+    return value;
+}
+
+bool OpenSslSignatureBackend::randomBytes(unsigned char* out, size_t length) {
+    return RAND_bytes(out, (int)length) == 1;
+}
+
+bool OpenSslSignatureBackend::deriveKey(const string& password, const vector<unsigned char>& salt,
+                                        unsigned iterations, unsigned char* out, size_t length) {
+    return PKCS5_PBKDF2_HMAC(password.data(), (int)password.size(), salt.data(), (int)salt.size(),
+                             (int)iterations, EVP_sha256(), (int)length, out) == 1;
+}
+
+#endif
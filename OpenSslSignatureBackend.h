@@ -0,0 +1,40 @@
+#ifndef OPENSSLSIGNATUREBACKEND_H
+#define OPENSSLSIGNATUREBACKEND_H
+
+#ifndef _WIN32
+
+#include "SignatureBackend.h"
+
+struct evp_pkey_st;
+
+// Ed25519 signatures through OpenSSL's EVP interface. The private key is
+// kept as PEM in keyPath (created with mode 0600 on first start). EVP_PKEY
+// is read-only after loading, so calls need no lock; every call uses its
+// own EVP_MD_CTX.
+class OpenSslSignatureBackend : public SignatureBackend {
+private:
+    std::string keyPath;
+    evp_pkey_st* key;
+
+    bool loadKey();
+    bool generateKey();
+
+public:
+    explicit OpenSslSignatureBackend(const std::string& keyPath = "hospital_signing.pem");
+    ~OpenSslSignatureBackend() override;
+    OpenSslSignatureBackend(const OpenSslSignatureBackend&) = delete;
+    OpenSslSignatureBackend& operator=(const OpenSslSignatureBackend&) = delete;
+
+    bool init() override;
+    std::vector<unsigned char> sign(const std::string& data) override;
+    bool verify(const std::string& data, const std::vector<unsigned char>& signature) override;
+    std::vector<unsigned char> digest(const std::string& data) override;
+    bool randomBytes(unsigned char* out, size_t length) override;
+    bool deriveKey(const std::string& password, const std::vector<unsigned char>& salt,
+                   unsigned iterations, unsigned char* out, size_t length) override;
+    const char* name() const override { return "OpenSSL Ed25519"; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+#include "PasswordHasher.h"
+#include "Base64.h"
+#include <algorithm>
+
+using namespace std;
+
+static const char recordScheme[] = "pbkdf2-sha256";
+static const size_t saltBytes = 16;
+static const size_t hashBytes = 32;
+// Refuse to spend longer than this on a record, whatever it says
+static const unsigned maxIterations = 10000000;
+
+// Compares every byte whatever the first difference, so the time taken
+// says nothing about how much of a guess was right
+static bool constantTimeEqual(const unsigned char* a, size_t aLength, const unsigned char* b, size_t bLength) {
+    unsigned char diff = aLength == bLength ? 0 : 1;
+    size_t length = max(aLength, bLength);
+    for (size_t i = 0; i < length; ++i) {
+        diff |= (i < aLength ? a[i] : 0) ^ (i < bLength ? b[i] : 0);
+    }
+    return diff == 0;
+}
+
+// Splits a record into its iteration count, salt and hash
+static bool parseRecord(const string& stored, unsigned& iterations, vector<unsigned char>& salt,
+                        vector<unsigned char>& hash) {
+    size_t schemeEnd = stored.find('$');
+    if (schemeEnd == string::npos || stored.compare(0, schemeEnd, recordScheme) != 0) return false;
+    size_t iterationsEnd = stored.find('$', schemeEnd + 1);
+    if (iterationsEnd == string::npos) return false;
+    size_t saltEnd = stored.find('$', iterationsEnd + 1);
+    if (saltEnd == string::npos) return false;
+
+    unsigned long count = 0;
+    for (size_t i = schemeEnd + 1; i < iterationsEnd; ++i) {
+        if (stored[i] < '0' || stored[i] > '9') return false;
+        count = count * 10 + (stored[i] - '0');
+        if (count > maxIterations) return false;
+    }
+    if (count == 0) return false;
+    iterations = (unsigned)count;
+
+    string_view record(stored);
+    return base64Decode(record.substr(iterationsEnd + 1, saltEnd - iterationsEnd - 1), salt) &&
+           base64Decode(record.substr(saltEnd + 1), hash) && !salt.empty() && !hash.empty();
+}
+
+PasswordHasher::PasswordHasher(DigitalSignatureManager& m, unsigned workerCount)
+    : manager(m), stopping(false) {
+    if (workerCount == 0) workerCount = max(1u, thread::hardware_concurrency() / 2);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&PasswordHasher::workerLoop, this);
+    }
+}
+
+PasswordHasher::~PasswordHasher() {
+    {
+        lock_guard<mutex> guard(queueMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void PasswordHasher::configure(const Config& c) {
+    lock_guard<mutex> guard(queueMutex);
+    config = c;
+    config.iterations = min(max(1u, config.iterations), maxIterations);
+}
+
+PasswordHasher::Config PasswordHasher::getConfig() {
+    lock_guard<mutex> guard(queueMutex);
+    return config;
+}
+
+bool PasswordHasher::isHashed(const string& stored) {
+    return stored.compare(0, sizeof(recordScheme) - 1, recordScheme) == 0 &&
+           stored.size() > sizeof(recordScheme) - 1 && stored[sizeof(recordScheme) - 1] == '$';
+}
+
+bool PasswordHasher::verify(const string& password, const string& stored, Callback done) {
+    Job job;
+    job.password = password;
+    job.stored = stored;
+    job.queued = Clock::now();
+    job.done = move(done);
+    {
+        lock_guard<mutex> guard(queueMutex);
+        if (stopping || jobs.size() >= config.maxQueued) return false;
+        jobs.push_back(move(job));
+    }
+    workAvailable.notify_one();
+    return true;
+}
+
+PasswordHasher::Outcome PasswordHasher::verify(const string& password, const string& stored) {
+    promise<Outcome> result;
+    future<Outcome> answer = result.get_future();
+    if (!verify(password, stored, [&result](const Outcome& outcome) { result.set_value(outcome); })) {
+        return Outcome();
+    }
+    return answer.get();
+}
+
+string PasswordHasher::hash(const string& password) {
+    return makeRecord(password, getConfig().iterations);
+}
+
+string PasswordHasher::decoyRecord() {
+    static const unsigned char zeros[hashBytes] = {};
+    return string(recordScheme) + "$" + to_string(getConfig().iterations) + "$" +
+           base64Encode(zeros, saltBytes) + "$" + base64Encode(zeros, hashBytes);
+}
+
+string PasswordHasher::makeRecord(const string& password, unsigned iterations) {
+    vector<unsigned char> salt(saltBytes);
+    unsigned char hash[hashBytes];
+    if (!manager.randomBytes(salt.data(), salt.size()) ||
+        !manager.deriveKey(password, salt, iterations, hash, sizeof(hash))) {
+        return "";
+    }
+    return string(recordScheme) + "$" + to_string(iterations) + "$" +
+           base64Encode(salt.data(), salt.size()) + "$" + base64Encode(hash, sizeof(hash));
+}
+
+PasswordHasher::Outcome PasswordHasher::check(const string& password, const string& stored, unsigned current) {
+    Outcome outcome;
+    outcome.result = Result::Mismatch;
+    bool upgrade;
+    if (isHashed(stored)) {
+        unsigned iterations;
+        vector<unsigned char> salt, expected;
+        if (!parseRecord(stored, iterations, salt, expected)) return outcome;
+        vector<unsigned char> derived(expected.size());
+        if (!manager.deriveKey(password, salt, iterations, derived.data(), derived.size()) ||
+            !constantTimeEqual(derived.data(), derived.size(), expected.data(), expected.size())) {
+            return outcome;
+        }
+        upgrade = iterations != current || expected.size() != hashBytes;
+    } else {
+        if (!constantTimeEqual((const unsigned char*)password.data(), password.size(),
+                               (const unsigned char*)stored.data(), stored.size())) {
+            return outcome;
+        }
+        upgrade = true;
+    }
+    outcome.result = Result::Match;
+    if (upgrade) outcome.upgraded = makeRecord(password, current);
+    return outcome;
+}
+
+void PasswordHasher::workerLoop() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        workAvailable.wait(lock, [&] { return stopping || !jobs.empty(); });
+        // Callbacks run without the queue lock, so they may queue more
+        if (stopping) {
+            deque<Job> refused;
+            refused.swap(jobs);
+            lock.unlock();
+            for (auto& job : refused) job.done(Outcome());
+            return;
+        }
+
+        Job job = move(jobs.front());
+        jobs.pop_front();
+        Config current = config;
+        lock.unlock();
+
+        if (Clock::now() - job.queued > current.maxWait) {
+            job.done(Outcome());
+        } else {
+            job.done(check(job.password, job.stored, current.iterations));
+        }
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef PASSWORDHASHER_H
+#define PASSWORDHASHER_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <chrono>
+#include "DigitalSignatureManager.h"
+
+// Checks passwords against stored records on a fixed pool of workers, so a
+// burst of logins costs at most workerCount cores however many request
+// threads are waiting. Records look like
+//   pbkdf2-sha256$<iterations>$<salt>$<hash>
+// with the salt and hash in base64; anything else is taken to be a legacy
+// plaintext password.
+//
+// Admission control: at most maxQueued checks may wait for a worker. Past
+// that a check is refused at once with Busy, as is one that waited longer
+// than maxWait before a worker got to it (its client has likely given up),
+// so an overload turns into quick "try again" answers instead of a pile of
+// blocked threads.
+class PasswordHasher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        unsigned iterations = 100000;               // cost of new records
+        size_t maxQueued = 16;
+        std::chrono::milliseconds maxWait{1000};
+    };
+
+    enum class Result { Match, Mismatch, Busy };
+
+    struct Outcome {
+        Result result = Result::Busy;
+        // On a match against a plaintext record or one made at another
+        // cost: a fresh record at the current cost to store in its place
+        std::string upgraded;
+    };
+
+    using Callback = std::function<void(const Outcome& outcome)>;
+
+private:
+    struct Job {
+        std::string password;
+        std::string stored;
+        Clock::time_point queued;
+        Callback done;
+    };
+
+    DigitalSignatureManager& manager;
+
+    std::mutex queueMutex;
+    std::condition_variable workAvailable;
+    Config config;
+    std::deque<Job> jobs;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void workerLoop();
+    Outcome check(const std::string& password, const std::string& stored, unsigned iterations);
+    std::string makeRecord(const std::string& password, unsigned iterations);
+
+public:
+    PasswordHasher(DigitalSignatureManager& manager, unsigned workerCount = 0);
+    // Checks still queued are answered Busy
+    ~PasswordHasher();
+    PasswordHasher(const PasswordHasher&) = delete;
+    PasswordHasher& operator=(const PasswordHasher&) = delete;
+
+    // Applies to records made and checks queued from now on
+    void configure(const Config& config);
+    Config getConfig();
+
+    // Queues a check of password against a stored record. done runs on a
+    // worker once it is answered (Busy if it waited past maxWait or the
+    // hasher is shutting down). False, without calling done, if the queue
+    // is full.
+    bool verify(const std::string& password, const std::string& stored, Callback done);
+    // The same, waiting for the answer on the calling thread
+    Outcome verify(const std::string& password, const std::string& stored);
+    // A new record at the current cost, made on the calling thread (for
+    // accounts being created, which are not worth refusing); "" on failure
+    std::string hash(const std::string& password);
+    // A well-formed record that matches no password, costing as much to
+    // check as a real one; checked for unknown users so that they take as
+    // long to turn away as a wrong password does
+    std::string decoyRecord();
+
+    static bool isHashed(const std::string& stored);
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define PRESCRIPTION_H
 
 #include <string>
+#include "Date.h"
 
 struct Prescription {
     int id;
@@ -13,6 +14,7 @@ struct Prescription {
     std::string status; // "pending", "dispensed"
     std::string diagnosis; // For AI epidemic detection
     std::string signature; // Digital signature for verification
+    int day = Date::invalid; // date parsed; set by the controller
 };
 
 #endif
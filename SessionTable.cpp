@@ -0,0 +1,62 @@
+#include "SessionTable.h"
+#include <functional>
+
+using namespace std;
+
+static const chrono::minutes sweepInterval(1);
+
+SessionTable::SessionTable(DigitalSignatureManager& m, chrono::seconds timeout)
+    : manager(m), idleTimeout(timeout) {}
+
+// Tokens are uniformly random, so any hash spreads them evenly
+SessionTable::Shard& SessionTable::shardOf(const string& token) {
+    return shards[hash<string>()(token) % shardCount];
+}
+
+string SessionTable::create(const User& user) {
+    static const char digits[] = "0123456789abcdef";
+    unsigned char bytes[tokenBytes];
+    if (!manager.randomBytes(bytes, sizeof(bytes))) return "";
+    string token;
+    token.reserve(tokenBytes * 2);
+    for (unsigned char c : bytes) {
+        token += digits[c >> 4];
+        token += digits[c & 0xF];
+    }
+
+    Shard& shard = shardOf(token);
+    Clock::time_point now = Clock::now();
+    lock_guard<mutex> guard(shard.lock);
+    if (now >= shard.nextSweep) {
+        for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+            it = it->second.expires <= now ? shard.sessions.erase(it) : next(it);
+        }
+        shard.nextSweep = now + sweepInterval;
+    }
+    shard.sessions[token] = {user.username, user.role, now + idleTimeout};
+    return token;
+}
+
+bool SessionTable::lookup(const string& token, User& user) {
+    if (token.size() != tokenBytes * 2) return false;
+    Shard& shard = shardOf(token);
+    Clock::time_point now = Clock::now();
+    lock_guard<mutex> guard(shard.lock);
+    auto it = shard.sessions.find(token);
+    if (it == shard.sessions.end()) return false;
+    if (it->second.expires <= now) {
+        shard.sessions.erase(it);
+        return false;
+    }
+    it->second.expires = now + idleTimeout;
+    user.username = it->second.username;
+    user.password.clear();
+    user.role = it->second.role;
+    return true;
+}
+
+void SessionTable::remove(const string& token) {
+    Shard& shard = shardOf(token);
+    lock_guard<mutex> guard(shard.lock);
+    shard.sessions.erase(token);
+}
@@ -0,0 +1,59 @@
+#ifndef SESSIONTABLE_H
+#define SESSIONTABLE_H
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "User.h"
+#include "DigitalSignatureManager.h"
+
+// Signed-in sessions by opaque token. A token is 128 random bits from the
+// signature backend, hex encoded, and maps to the user's name and role; it
+// is never derived from the credentials. Sessions expire after idleTimeout
+// without a lookup, and each lookup renews them.
+//
+// The table is split into shards by token hash, each with its own lock, so
+// concurrent requests looking up different sessions rarely meet on the
+// same mutex. Expired sessions are dropped when looked up, and each shard
+// is swept at most once a minute as sessions are created in it.
+class SessionTable {
+public:
+    using Clock = std::chrono::steady_clock;
+    static const size_t shardCount = 16;
+    static const size_t tokenBytes = 16;
+
+private:
+    struct Session {
+        std::string username;
+        UserRole role;
+        Clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<std::string, Session> sessions;
+        Clock::time_point nextSweep;
+    };
+
+    DigitalSignatureManager& manager;
+    const std::chrono::seconds idleTimeout;
+    std::array<Shard, shardCount> shards;
+
+    Shard& shardOf(const std::string& token);
+
+public:
+    explicit SessionTable(DigitalSignatureManager& manager,
+                          std::chrono::seconds idleTimeout = std::chrono::minutes(30));
+
+    // Opens a session for user; returns its token, or "" if no random
+    // bytes could be had
+    std::string create(const User& user);
+    // The session's user, with an empty password; false if the token is
+    // unknown or expired
+    bool lookup(const std::string& token, User& user);
+    void remove(const std::string& token);
+};
+
+#endif
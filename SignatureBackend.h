@@ -0,0 +1,31 @@
+#ifndef SIGNATUREBACKEND_H
+#define SIGNATUREBACKEND_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// One signing key pair held by a platform crypto library. Once init() has
+// succeeded, sign/verify/digest may be called from several threads at once.
+class SignatureBackend {
+public:
+    virtual ~SignatureBackend() = default;
+
+    // Loads the key pair, creating and storing a new one on first use
+    virtual bool init() = 0;
+    virtual std::vector<unsigned char> sign(const std::string& data) = 0;
+    virtual bool verify(const std::string& data, const std::vector<unsigned char>& signature) = 0;
+    // SHA-256 of data
+    virtual std::vector<unsigned char> digest(const std::string& data) = 0;
+    // Fills out with cryptographically secure random bytes
+    virtual bool randomBytes(unsigned char* out, size_t length) = 0;
+    // PBKDF2-HMAC-SHA256 of password and salt, length bytes into out
+    virtual bool deriveKey(const std::string& password, const std::vector<unsigned char>& salt,
+                           unsigned iterations, unsigned char* out, size_t length) = 0;
+    virtual const char* name() const = 0;
+};
+
+// CryptoAPI RSA on Windows, OpenSSL Ed25519 elsewhere
+std::unique_ptr<SignatureBackend> createDefaultSignatureBackend();
+
+#endif
@@ -0,0 +1,73 @@
+#include "SigningQueue.h"
+#include <algorithm>
+
+using namespace std;
+
+SigningQueue::SigningQueue(DigitalSignatureManager& m, unsigned workerCount, size_t batch)
+    : manager(m), maxBatch(max<size_t>(1, batch)), busyWorkers(0), stopping(false) {
+    if (workerCount == 0) workerCount = max(1u, thread::hardware_concurrency() / 2);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&SigningQueue::workerLoop, this);
+    }
+}
+
+SigningQueue::~SigningQueue() {
+    {
+        lock_guard<mutex> guard(queueMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void SigningQueue::setAfterBatch(function<void()> hook) {
+    lock_guard<mutex> guard(queueMutex);
+    afterBatch = move(hook);
+}
+
+shared_future<string> SigningQueue::submit(string data, Callback onSigned) {
+    Job job;
+    job.data = move(data);
+    job.onSigned = move(onSigned);
+    shared_future<string> result = job.result.get_future().share();
+    {
+        lock_guard<mutex> guard(queueMutex);
+        jobs.push_back(move(job));
+    }
+    workAvailable.notify_one();
+    return result;
+}
+
+void SigningQueue::drain() {
+    unique_lock<mutex> lock(queueMutex);
+    idle.wait(lock, [&] { return jobs.empty() && busyWorkers == 0; });
+}
+
+void SigningQueue::workerLoop() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        workAvailable.wait(lock, [&] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) return;   // stopping, and nothing left to sign
+
+        // Take everything that queued up while the last batch was signed
+        vector<Job> batch;
+        while (!jobs.empty() && batch.size() < maxBatch) {
+            batch.push_back(move(jobs.front()));
+            jobs.pop_front();
+        }
+        function<void()> hook = afterBatch;
+        ++busyWorkers;
+        lock.unlock();
+
+        for (auto& job : batch) {
+            string signature = manager.signData(job.data);
+            if (job.onSigned) job.onSigned(signature);
+            job.result.set_value(signature);
+        }
+        if (hook) hook();
+
+        lock.lock();
+        --busyWorkers;
+        if (jobs.empty() && busyWorkers == 0) idle.notify_all();
+    }
+}
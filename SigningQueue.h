@@ -0,0 +1,60 @@
+#ifndef SIGNINGQUEUE_H
+#define SIGNINGQUEUE_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include "DigitalSignatureManager.h"
+
+// Moves signing off the request path. submit() only queues the data and
+// returns a future; a small pool of workers takes whatever has queued up
+// (up to maxBatch jobs), signs it, runs each job's callback and fulfils
+// its future, then runs afterBatch once for the whole batch, e.g. to make
+// the stored signatures durable with a single commit.
+class SigningQueue {
+public:
+    using Callback = std::function<void(const std::string& signature)>;
+
+private:
+    struct Job {
+        std::string data;
+        Callback onSigned;
+        std::promise<std::string> result;
+    };
+
+    DigitalSignatureManager& manager;
+    std::function<void()> afterBatch;
+    size_t maxBatch;
+
+    std::mutex queueMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable idle;
+    std::deque<Job> jobs;
+    size_t busyWorkers;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void workerLoop();
+
+public:
+    SigningQueue(DigitalSignatureManager& manager, unsigned workerCount = 0, size_t maxBatch = 64);
+    // Signs everything still queued before returning
+    ~SigningQueue();
+    SigningQueue(const SigningQueue&) = delete;
+    SigningQueue& operator=(const SigningQueue&) = delete;
+
+    void setAfterBatch(std::function<void()> hook);
+
+    // onSigned runs on a worker before the future becomes ready. An empty
+    // signature means signing failed.
+    std::shared_future<std::string> submit(std::string data, Callback onSigned = nullptr);
+    // Blocks until the queue is empty and no batch is in progress
+    void drain();
+};
+
+#endif
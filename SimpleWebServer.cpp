@@ -1,12 +1,132 @@
 #include "SimpleWebServer.h"
+#include "CsvTokenizer.h"
+#include "JsonWriter.h"
+#include "Compression.h"
+#include "Date.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
 
 using namespace std;
 
-SimpleWebServer::SimpleWebServer(HospitalController* ctrl, int p) : controller(ctrl), port(p), isRunning(false), serverSocket(INVALID_SOCKET) {}
+// Cap on unparsed input per connection; the parser enforces the per-request
+// header and body limits, this only bounds what a pipelining client can queue
+static const size_t maxInputBuffer = 16 * 1024 * 1024;
+// Pipelined requests are left unparsed while this much output is unsent
+static const size_t maxPendingOutput = 1024 * 1024;
+// Per-thread response scratch buffers above this size are released
+static const size_t maxPooledBody = 16 * 1024 * 1024;
+// Changes arriving within this window of the first go out as one event
+static const int eventCoalesceMillis = 100;
+// Comment line sent to quiet event streams, so dead peers are noticed
+static const int eventHeartbeatSeconds = 30;
+// An event stream with this much unsent output is dropped rather than
+// buffered without bound for a client that is not reading
+static const size_t maxEventBacklog = 256 * 1024;
+
+static const char eventStreamHeaders[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "retry: 3000\n\n";
+
+static int lastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+static void cleanupSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// Very simple parsing of the raw JSON the frontend sends:
+// {"username": "u", "password": "p"}
+static void parseCredentials(const string& body, string& u, string& p) {
+    size_t uPos = body.find("\"username\":");
+    if (uPos != string::npos) {
+        size_t start = body.find("\"", uPos + 11) + 1;
+        size_t end = body.find("\"", start);
+        u = body.substr(start, end - start);
+    }
+
+    size_t pPos = body.find("\"password\":");
+    if (pPos != string::npos) {
+        size_t start = body.find("\"", pPos + 11) + 1;
+        size_t end = body.find("\"", start);
+        p = body.substr(start, end - start);
+    }
+}
+
+static const char* const dashboardFieldNames[] = {"revenue", "lowStock", "pendingRx", "recentTransactions"};
+
+// Each dashboard field serialised on its own, so the event stream can tell
+// which ones changed since it last published
+static array<string, 4> dashboardFieldsOf(const DashboardStats::Snapshot& stats) {
+    array<string, 4> fields;
+    JsonWriter(fields[0]).value(stats.revenueToday);
+    JsonWriter(fields[1]).value(stats.lowStock);
+    JsonWriter(fields[2]).value(stats.pendingPrescriptions);
+    // Last 5 transactions
+    JsonWriter json(fields[3]);
+    json.beginArray();
+    for (const auto& t : stats.recent) {
+        json.beginObject()
+            .field("id", t.id)
+            .field("amount", t.amount)
+            .field("date", t.date)
+            .field("method", t.paymentMethod)
+            .endObject();
+    }
+    json.endArray();
+    return fields;
+}
+
+// An SSE "dashboard" event holding the fields flagged in changed, or all
+// of them when changed is null. Compact JSON has no raw newlines, so it
+// fits on one data line.
+static string dashboardEvent(const array<string, 4>& fields, const array<bool, 4>* changed) {
+    string event = "event: dashboard\ndata: ";
+    JsonWriter json(event);
+    json.beginObject();
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (!changed || (*changed)[i]) json.key(dashboardFieldNames[i]).raw(fields[i]);
+    }
+    json.endObject();
+    event += "\n\n";
+    return event;
+}
+
+SimpleWebServer::SimpleWebServer(HospitalController* ctrl, int p, unsigned int workers)
+    : serverSocket(INVALID_SOCKET), controller(ctrl), isRunning(false), port(p), workerCount(workers),
+      idleTimeoutSeconds(15), compressionLevel(6), compressionThreshold(1024), eventsDirty(false), eventSeq(0) {
+    if (workerCount == 0) workerCount = max(2u, thread::hardware_concurrency());
+#ifndef _WIN32
+    epollFd = -1;
+    lastSweep = 0;
+    pendingLogins = 0;
+#endif
+}
 
 SimpleWebServer::~SimpleWebServer() {
     stop();
@@ -14,22 +134,37 @@ SimpleWebServer::~SimpleWebServer() {
 
 void SimpleWebServer::stop() {
     isRunning = false;
+#ifdef _WIN32
     if (serverSocket != INVALID_SOCKET) {
         closesocket(serverSocket);
         serverSocket = INVALID_SOCKET;
     }
     WSACleanup();
+#endif
+    // The epoll workers notice the flag within one wait timeout and start()
+    // tears down the listener and open connections once they have exited.
+}
+
+void SimpleWebServer::setIdleTimeout(int seconds) {
+    idleTimeoutSeconds = seconds;
+}
+
+void SimpleWebServer::setCompression(int level, size_t minBytes) {
+    compressionLevel = max(0, min(level, 9));
+    compressionThreshold = minBytes;
 }
 
 void SimpleWebServer::start() {
+#ifdef _WIN32
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
         cerr << "WSAStartup failed.\n";
         return;
     }
+#endif
 
     struct addrinfo *result = NULL, hints;
-    ZeroMemory(&hints, sizeof(hints));
+    memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_INET;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
@@ -38,38 +173,48 @@ void SimpleWebServer::start() {
     string portStr = to_string(port);
     if (getaddrinfo(NULL, portStr.c_str(), &hints, &result) != 0) {
         cerr << "getaddrinfo failed.\n";
-        WSACleanup();
+        cleanupSockets();
         return;
     }
 
     serverSocket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
     if (serverSocket == INVALID_SOCKET) {
-        cerr << "Error at socket(): " << WSAGetLastError() << "\n";
+        cerr << "Error at socket(): " << lastSocketError() << "\n";
         freeaddrinfo(result);
-        WSACleanup();
+        cleanupSockets();
         return;
     }
 
+#ifndef _WIN32
+    int reuse = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
     if (bind(serverSocket, result->ai_addr, (int)result->ai_addrlen) == SOCKET_ERROR) {
-        cerr << "bind failed with error: " << WSAGetLastError() << "\n";
+        cerr << "bind failed with error: " << lastSocketError() << "\n";
         freeaddrinfo(result);
         closesocket(serverSocket);
-        WSACleanup();
+        cleanupSockets();
         return;
     }
 
     freeaddrinfo(result);
 
     if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
-        cerr << "Listen failed with error: " << WSAGetLastError() << "\n";
+        cerr << "Listen failed with error: " << lastSocketError() << "\n";
         closesocket(serverSocket);
-        WSACleanup();
+        cleanupSockets();
         return;
     }
 
     isRunning = true;
     cout << "Web Server started on http://localhost:" << port << "\n";
 
+    dashboardFields = dashboardFieldsOf(controller->getDashboard(5));
+    controller->setChangeListener([this] { markChanged(); });
+    eventThread = thread(&SimpleWebServer::eventLoop, this);
+
+#ifdef _WIN32
     while (isRunning) {
         SOCKET clientSocket = accept(serverSocket, NULL, NULL);
         if (clientSocket == INVALID_SOCKET) {
@@ -80,64 +225,399 @@ void SimpleWebServer::start() {
         // Handle in a new thread (detached for simplicity in this demo)
         thread(&SimpleWebServer::handleClient, this, clientSocket).detach();
     }
+    stopEvents();
+#else
+    fcntl(serverSocket, F_SETFL, fcntl(serverSocket, F_GETFL, 0) | O_NONBLOCK);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        cerr << "epoll_create1 failed with error: " << errno << "\n";
+        closesocket(serverSocket);
+        serverSocket = INVALID_SOCKET;
+        isRunning = false;
+        return;
+    }
+
+    // Every fd is registered EPOLLONESHOT: whichever worker receives the event
+    // owns the socket until it re-arms it, so no two workers race on one fd.
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = serverSocket;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, serverSocket, &ev);
+
+    cout << "Serving with " << workerCount << " I/O worker threads\n";
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&SimpleWebServer::workerLoop, this);
+    }
+    for (auto& w : workers) w.join();
+    workers.clear();
+    // Logins still being checked call back into the server and its
+    // connections
+    {
+        unique_lock<mutex> lock(loginMutex);
+        loginsIdle.wait(lock, [&] { return pendingLogins == 0; });
+    }
+    stopEvents();
+    eventClients.clear();
+
+    {
+        lock_guard<mutex> guard(connectionsMutex);
+        for (auto& entry : connections) closesocket(entry.first);
+        connections.clear();
+    }
+    close(epollFd);
+    epollFd = -1;
+    closesocket(serverSocket);
+    serverSocket = INVALID_SOCKET;
+#endif
 }
 
+#ifndef _WIN32
+// --- Event loop (Linux epoll) ---
+
+void SimpleWebServer::workerLoop() {
+    epoll_event events[64];
+    while (isRunning) {
+        int n = epoll_wait(epollFd, events, 64, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            cerr << "epoll_wait failed with error: " << errno << "\n";
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == serverSocket) {
+                acceptConnections();
+            } else {
+                serviceConnection(events[i].data.fd, events[i].events);
+            }
+        }
+        sweepIdleConnections();
+    }
+}
+
+void SimpleWebServer::acceptConnections() {
+    while (true) {
+        SOCKET clientSocket = accept4(serverSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket == INVALID_SOCKET) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK && isRunning) {
+                cerr << "accept failed: " << errno << "\n";
+            }
+            break;
+        }
+
+        int noDelay = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        auto conn = make_shared<Connection>(clientSocket);
+        {
+            lock_guard<mutex> guard(connectionsMutex);
+            connections[clientSocket] = conn;
+        }
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = clientSocket;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientSocket, &ev) < 0) {
+            closeConnection(*conn);
+        }
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = serverSocket;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, serverSocket, &ev);
+}
+
+void SimpleWebServer::serviceConnection(SOCKET fd, uint32_t events) {
+    shared_ptr<Connection> conn;
+    {
+        lock_guard<mutex> guard(connectionsMutex);
+        auto it = connections.find(fd);
+        if (it == connections.end()) return; // stale event for a closed socket
+        conn = it->second;
+    }
+
+    lock_guard<mutex> guard(conn->lock);
+    if (conn->fd == INVALID_SOCKET) return;
+
+    bool open = !(events & EPOLLERR);
+    if (open && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) open = readFrom(*conn);
+    // A login's answer could not be sent after a full hangup, and the
+    // hangup would be reported again on every rearm while it is checked
+    if (open && (events & EPOLLHUP) && conn->awaitingResponse) open = false;
+    while (open) {
+        try {
+            processRequests(*conn);
+        } catch (const exception& e) {
+            cerr << "Error in processRequests: " << e.what() << "\n";
+            open = false;
+        } catch (...) {
+            cerr << "Unknown error in processRequests\n";
+            open = false;
+        }
+        bool heldBack = conn->fileFd >= 0 || conn->outBuf.size() >= maxPendingOutput;
+        if (open) open = flush(*conn);
+        // Requests held back behind a file body or a large backlog are
+        // served as soon as it has all gone out, not at the next event
+        if (!open || !heldBack || !conn->outBuf.empty() || conn->fileFd >= 0 || conn->inBuf.empty()) break;
+    }
+    if (open && conn->closeAfterWrite && conn->outBuf.empty() && conn->fileFd < 0 && !conn->awaitingResponse) {
+        open = false;
+    }
+
+    if (open) {
+        rearm(*conn);
+    } else {
+        closeConnection(*conn);
+    }
+}
+
+// Drains the socket into inBuf. Returns false on a hard error; a clean EOF
+// only marks the connection so pending responses still get written.
+bool SimpleWebServer::readFrom(Connection& conn) {
+    char buffer[16384];
+    while (true) {
+        ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.inBuf.append(buffer, n);
+            conn.lastActivity = Connection::nowMillis();
+            if (conn.inBuf.size() > maxInputBuffer) return false;
+            continue;
+        }
+        if (n == 0) {
+            conn.closeAfterWrite = true;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+bool SimpleWebServer::flush(Connection& conn) {
+    while (conn.outOffset < conn.outBuf.size()) {
+        ssize_t n = send(conn.fd, conn.outBuf.data() + conn.outOffset,
+                         conn.outBuf.size() - conn.outOffset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.outOffset += n;
+            conn.lastActivity = Connection::nowMillis();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+    conn.outBuf.clear();
+    conn.outOffset = 0;
+
+    // The file body goes from the page cache to the socket without a copy
+    // through user space
+    while (conn.fileFd >= 0 && conn.fileRemaining > 0) {
+        ssize_t n = sendfile(conn.fd, conn.fileFd, &conn.fileOffset, conn.fileRemaining);
+        if (n > 0) {
+            conn.fileRemaining -= n;
+            conn.lastActivity = Connection::nowMillis();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;   // error, or the file shrank below its Content-Length
+    }
+    if (conn.fileFd >= 0) {
+        close(conn.fileFd);
+        conn.fileFd = -1;
+    }
+    return true;
+}
+
+// Answers every complete request in inBuf, in order, so pipelined requests
+// from one read are all served before the socket is re-armed. The parser
+// resumes where it stopped, so a request split across reads is not rescanned.
+void SimpleWebServer::processRequests(Connection& conn) {
+    if (conn.streaming) {
+        conn.inBuf.clear();
+        return;
+    }
+    size_t consumed = 0;
+    while (!conn.closeAfterWrite && conn.fileFd < 0 && !conn.awaitingResponse && conn.outBuf.size() < maxPendingOutput) {
+        auto status = conn.parser.parse(conn.inBuf.data() + consumed, conn.inBuf.size() - consumed);
+        if (status == HttpRequestParser::Status::Incomplete) {
+            if (conn.parser.expectsContinue() && !conn.continueSent) {
+                conn.outBuf += "HTTP/1.1 100 Continue\r\n\r\n";
+                conn.continueSent = true;
+            }
+            break;
+        }
+        if (status == HttpRequestParser::Status::Error) {
+            conn.outBuf += errorResponse(conn.parser.errorStatus());
+            conn.closeAfterWrite = true;
+            break;
+        }
+
+        const HttpRequest& request = conn.parser.request();
+        if (request.method == "GET" && request.path == "/api/events") {
+            openEventStream(conn);
+            conn.inBuf.clear();
+            conn.parser.reset();
+            return;
+        }
+
+        bool keepAlive = true;
+        FileBody file;
+        if (request.method == "POST" && request.path == "/api/login") {
+            keepAlive = isRunning && request.keepAlive();
+            beginLogin(conn, request, keepAlive);
+        } else {
+            buildResponse(request, keepAlive, conn.outBuf, &file);
+        }
+        if (file.fd >= 0) {
+            conn.fileFd = file.fd;
+            conn.fileOffset = 0;
+            conn.fileRemaining = file.length;
+        }
+        consumed += conn.parser.consumed();
+        conn.parser.reset();
+        conn.continueSent = false;
+        if (!keepAlive) conn.closeAfterWrite = true;
+    }
+    conn.inBuf.erase(0, consumed);
+}
+
+void SimpleWebServer::rearm(Connection& conn) {
+    epoll_event ev = {};
+    ev.data.fd = conn.fd;
+    ev.events = EPOLLONESHOT;
+    // Once the connection is winding down only wait for it to drain, otherwise
+    // a peer half-close would keep EPOLLIN permanently ready.
+    if (!conn.closeAfterWrite) ev.events |= EPOLLIN | EPOLLRDHUP;
+    if (!conn.outBuf.empty() || conn.fileFd >= 0) ev.events |= EPOLLOUT;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+// A login waits for a password hashing worker, which must not hold up
+// this I/O worker. The check is queued and the connection takes no further
+// requests until the hashing worker's callback appends the answer to
+// outBuf and rearms the socket, as publish() does; the I/O worker that
+// picks up EPOLLOUT then writes it and goes on with any pipelined requests
+// still in inBuf.
+void SimpleWebServer::beginLogin(Connection& conn, const HttpRequest& request, bool keepAlive) {
+    cout << "Request: POST /api/login\n";
+    string u, p;
+    parseCredentials(string(request.body), u, p);
+    string accepted(request.header("Accept-Encoding"));
+    shared_ptr<Connection> client = conn.shared_from_this();
+    {
+        lock_guard<mutex> guard(loginMutex);
+        ++pendingLogins;
+    }
+    conn.awaitingResponse = true;
+    bool queued = controller->login(u, p, [this, client, accepted, keepAlive](const string& token, bool busy) {
+        string body;
+        loginResult(token, busy, body);
+        {
+            lock_guard<mutex> guard(client->lock);
+            if (client->fd != INVALID_SOCKET) {
+                apiResponse(accepted, keepAlive, "application/json", body, client->outBuf);
+                client->awaitingResponse = false;
+                rearm(*client);
+            }
+        }
+        finishLogin();
+    });
+    if (!queued) {
+        // Turned away at once, so the answer goes out with this batch
+        conn.awaitingResponse = false;
+        string body;
+        loginResult("", true, body);
+        apiResponse(accepted, keepAlive, "application/json", body, conn.outBuf);
+        finishLogin();
+    }
+}
+
+void SimpleWebServer::finishLogin() {
+    lock_guard<mutex> guard(loginMutex);
+    if (--pendingLogins == 0) loginsIdle.notify_all();
+}
+
+void SimpleWebServer::closeConnection(Connection& conn) {
+    {
+        lock_guard<mutex> guard(connectionsMutex);
+        connections.erase(conn.fd);
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, NULL);
+    closesocket(conn.fd);
+    conn.fd = INVALID_SOCKET;
+    if (conn.fileFd >= 0) {
+        close(conn.fileFd);
+        conn.fileFd = -1;
+    }
+}
+
+// Runs on whichever worker first notices a second has passed. Idle sockets
+// are only shut down here; the worker that owns the connection sees the
+// resulting hangup and closes it, so the sweeper never frees a connection
+// another worker is using.
+void SimpleWebServer::sweepIdleConnections() {
+    long long now = Connection::nowMillis();
+    long long previous = lastSweep;
+    if (now - previous < 1000 || !lastSweep.compare_exchange_strong(previous, now)) return;
+
+    long long cutoff = now - idleTimeoutSeconds * 1000LL;
+    lock_guard<mutex> guard(connectionsMutex);
+    for (auto& entry : connections) {
+        // Event streams are idle by design; the heartbeat finds dead ones
+        if (!entry.second->streaming && entry.second->lastActivity < cutoff) {
+            shutdown(entry.first, SHUT_RDWR);
+        }
+    }
+}
+
+// The stream starts with the full dashboard as of the last published
+// event; every later event is a delta against that same state, so nothing
+// is missed or applied twice.
+void SimpleWebServer::openEventStream(Connection& conn) {
+    cout << "Request: GET /api/events\n";
+    conn.streaming = true;
+    conn.outBuf += eventStreamHeaders;
+    lock_guard<mutex> guard(eventMutex);
+    conn.outBuf += dashboardEvent(dashboardFields, nullptr);
+    eventClients.push_back(conn.shared_from_this());
+}
+#else
 void SimpleWebServer::handleClient(SOCKET clientSocket) {
     try {
+        DWORD timeout = idleTimeoutSeconds * 1000;
+        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+        string request;
+        HttpRequestParser parser;
         char buffer[4096];
-        int bytesReceived = recv(clientSocket, buffer, 4096, 0);
-        if (bytesReceived > 0) {
-            string request(buffer, bytesReceived);
-            istringstream iss(request);
-            string method, path, protocol;
-            iss >> method >> path >> protocol;
-
-            cout << "Request: " << method << " " << path << "\n";
-            
-            string response;
-            string contentType = "text/html";
-            
-            // CORS Preflight
-            if (method == "OPTIONS") {
-                response = "";
-                contentType = "text/plain";
-            } else {
-                // Simple routing
-                if (path.find("/api/") == 0) {
-                    // Extract body if POST
-                    string body = "";
-                    size_t bodyPos = request.find("\r\n\r\n");
-                    if (bodyPos != string::npos) {
-                        body = request.substr(bodyPos + 4);
-                    }
-                    response = handleApiRequest(method, path, body);
-                    contentType = "application/json";
-                } else {
-                    if (path == "/") path = "/index.html";
-                    // Remove leading slash for file path
-                    string filePath = "www" + path; 
-                    response = readFile(filePath);
-                    contentType = getContentType(filePath);
-                    if (response.empty()) {
-                        response = "<h1>404 Not Found</h1>";
-                        contentType = "text/html";
-                    }
-                }
+        string response;
+        bool keepAlive = true;
+        while (keepAlive && isRunning) {
+            auto status = parser.parse(request.data(), request.size());
+            while (status == HttpRequestParser::Status::Incomplete) {
+                int bytesReceived = recv(clientSocket, buffer, sizeof(buffer), 0);
+                if (bytesReceived <= 0) break;
+                request.append(buffer, bytesReceived);
+                status = parser.parse(request.data(), request.size());
+            }
+            if (status == HttpRequestParser::Status::Error) {
+                response = errorResponse(parser.errorStatus());
+                send(clientSocket, response.c_str(), (int)response.size(), 0);
+                break;
+            }
+            if (status != HttpRequestParser::Status::Complete) break;
+            if (parser.request().method == "GET" && parser.request().path == "/api/events") {
+                streamEvents(clientSocket);
+                break;
             }
 
-            string header = "HTTP/1.1 200 OK\r\n"
-                                 "Content-Type: " + contentType + "\r\n"
-                                 "Content-Length: " + to_string(response.size()) + "\r\n"
-                                 "Cache-Control: no-cache, no-store, must-revalidate\r\n"
-                                 "Pragma: no-cache\r\n"
-                                 "Expires: 0\r\n"
-                                 "Access-Control-Allow-Origin: *\r\n"
-                                 "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-                                 "Access-Control-Allow-Headers: Content-Type\r\n"
-                                 "\r\n";
-            
-            send(clientSocket, header.c_str(), header.size(), 0);
-            send(clientSocket, response.c_str(), response.size(), 0);
+            response.clear();
+            buildResponse(parser.request(), keepAlive, response);
+            request.erase(0, parser.consumed());
+            parser.reset();
+            send(clientSocket, response.c_str(), (int)response.size(), 0);
         }
     } catch (const exception& e) {
         cerr << "Error in handleClient: " << e.what() << "\n";
@@ -147,112 +627,661 @@ void SimpleWebServer::handleClient(SOCKET clientSocket) {
     closesocket(clientSocket);
 }
 
-string SimpleWebServer::getContentType(const string& path) {
-    if (path.find(".html") != string::npos) return "text/html";
-    if (path.find(".css") != string::npos) return "text/css";
-    if (path.find(".js") != string::npos) return "application/javascript";
-    return "text/plain";
+// Runs on the connection's own thread until the client goes away or the
+// server stops. A send that cannot complete within the timeout drops the
+// client. A stream that fell more than one event behind is sent the full
+// dashboard rather than the deltas it missed.
+void SimpleWebServer::streamEvents(SOCKET clientSocket) {
+    cout << "Request: GET /api/events\n";
+    DWORD timeout = eventHeartbeatSeconds * 1000;
+    setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    unique_lock<mutex> lock(eventMutex);
+    string pending = eventStreamHeaders + dashboardEvent(dashboardFields, nullptr);
+    unsigned long long seen = eventSeq;
+    while (isRunning) {
+        lock.unlock();
+        bool sent = send(clientSocket, pending.c_str(), (int)pending.size(), 0) == (int)pending.size();
+        lock.lock();
+        if (!sent) break;
+
+        bool changed = eventPublished.wait_for(lock, chrono::seconds(eventHeartbeatSeconds),
+                                               [&] { return eventSeq != seen || !isRunning; });
+        if (!changed) {
+            pending = ": ping\n\n";
+        } else if (eventSeq == seen + 1) {
+            pending = lastEvent;
+        } else {
+            pending = dashboardEvent(dashboardFields, nullptr);
+        }
+        seen = eventSeq;
+    }
+}
+#endif
+
+// --- Server-sent events ---
+
+// Called by the controller after each change; only flags it, so mutating
+// threads never wait on serialisation or slow sockets
+void SimpleWebServer::markChanged() {
+    {
+        lock_guard<mutex> guard(eventMutex);
+        eventsDirty = true;
+    }
+    eventSignal.notify_one();
+}
+
+// Waits for a change, lets the rest of the burst land, then compares each
+// dashboard field with what was last published and sends only those that
+// differ. Idle streams cost a heartbeat every eventHeartbeatSeconds.
+void SimpleWebServer::eventLoop() {
+    unique_lock<mutex> lock(eventMutex);
+    while (isRunning) {
+        bool dirty = eventSignal.wait_for(lock, chrono::seconds(eventHeartbeatSeconds),
+                                          [&] { return eventsDirty || !isRunning; });
+        if (!isRunning) break;
+        lock.unlock();
+        if (!dirty) {
+            publish(": ping\n\n");
+            lock.lock();
+            continue;
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(eventCoalesceMillis));
+        lock.lock();
+        // Cleared before reading, so a change made meanwhile flags the next round
+        eventsDirty = false;
+        lock.unlock();
+        auto fields = dashboardFieldsOf(controller->getDashboard(5));
+        lock.lock();
+
+        array<bool, 4> changed;
+        bool anyChanged = false;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            changed[i] = fields[i] != dashboardFields[i];
+            anyChanged = anyChanged || changed[i];
+        }
+        if (!anyChanged) continue;
+        dashboardFields = move(fields);
+        lastEvent = dashboardEvent(dashboardFields, &changed);
+        ++eventSeq;
+        eventPublished.notify_all();
+
+        string event = lastEvent;
+        lock.unlock();
+        publish(event);
+        lock.lock();
+    }
+}
+
+void SimpleWebServer::stopEvents() {
+    controller->setChangeListener(nullptr);
+    {
+        lock_guard<mutex> guard(eventMutex);
+    }
+    eventSignal.notify_all();
+    eventPublished.notify_all();
+    if (eventThread.joinable()) eventThread.join();
+}
+
+// Appends the event to every subscriber's output and writes what the
+// socket takes now; the rest goes out when the worker sees EPOLLOUT. A
+// subscriber whose backlog would pass maxEventBacklog is shut down and its
+// owning worker closes it. (Windows streams pull events themselves.)
+void SimpleWebServer::publish(const string& event) {
+#ifndef _WIN32
+    vector<shared_ptr<Connection>> clients;
+    {
+        lock_guard<mutex> guard(eventMutex);
+        clients.reserve(eventClients.size());
+        size_t kept = 0;
+        for (auto& weak : eventClients) {
+            auto conn = weak.lock();
+            if (!conn || !conn->streaming) continue;
+            clients.push_back(conn);
+            eventClients[kept++] = weak;
+        }
+        eventClients.resize(kept);
+    }
+
+    for (auto& conn : clients) {
+        lock_guard<mutex> guard(conn->lock);
+        if (conn->fd == INVALID_SOCKET) continue;
+        if (conn->outBuf.size() - conn->outOffset + event.size() > maxEventBacklog) {
+            cerr << "Dropping event stream client that is not keeping up\n";
+            conn->streaming = false;
+            shutdown(conn->fd, SHUT_RDWR);
+            continue;
+        }
+        conn->outBuf += event;
+        if (!flush(*conn)) {
+            conn->streaming = false;
+            shutdown(conn->fd, SHUT_RDWR);
+            continue;
+        }
+        if (!conn->outBuf.empty()) rearm(*conn);
+    }
+#else
+    (void)event;
+#endif
+}
+
+string SimpleWebServer::errorResponse(int status) {
+    string reason = "Bad Request";
+    if (status == 413) reason = "Payload Too Large";
+    else if (status == 431) reason = "Request Header Fields Too Large";
+    else if (status == 501) reason = "Not Implemented";
+
+    string body = "{\"error\": \"" + reason + "\"}";
+    return "HTTP/1.1 " + to_string(status) + " " + reason + "\r\n"
+           "Content-Type: application/json\r\n"
+           "Content-Length: " + to_string(body.size()) + "\r\n"
+           "Access-Control-Allow-Origin: *\r\n"
+           "Connection: close\r\n"
+           "\r\n" + body;
+}
+
+// The session token of an "Authorization: Bearer <token>" header
+static string bearerToken(string_view authorization) {
+    static const string_view scheme = "Bearer ";
+    if (authorization.size() <= scheme.size() || authorization.compare(0, scheme.size(), scheme) != 0) return "";
+    return string(authorization.substr(scheme.size()));
+}
+
+// Whether an Accept-Encoding header allows coding: listed (or "*"
+// listed) without q=0
+static bool acceptsEncoding(string_view header, string_view coding) {
+    size_t start = 0;
+    while (start < header.size()) {
+        size_t end = header.find(',', start);
+        if (end == string_view::npos) end = header.size();
+        string_view item = header.substr(start, end - start);
+        start = end + 1;
+
+        size_t params = item.find(';');
+        string_view name = item.substr(0, params);
+        while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+        bool matches = name == "*" || (name.size() == coding.size() &&
+            equal(name.begin(), name.end(), coding.begin(),
+                  [](char a, char b) { return tolower((unsigned char)a) == b; }));
+        if (!matches) continue;
+        if (params == string_view::npos) return true;
+        // "q=0", "q=0.0" and so on refuse the coding
+        string_view q = item.substr(params + 1);
+        while (!q.empty() && q.front() == ' ') q.remove_prefix(1);
+        while (!q.empty() && q.back() == ' ') q.remove_suffix(1);
+        if (q.size() < 3 || (q[0] != 'q' && q[0] != 'Q') || q[1] != '=') return true;
+        return q.find_first_not_of("0.", 2) != string_view::npos;
+    }
+    return false;
+}
+
+// Whether an If-None-Match header lists etag, or one of its -gz/-br
+// variants, or is "*". Weak comparison, as RFC 9110 asks for here.
+static bool etagMatches(string_view header, const string& etag) {
+    if (header.empty()) return false;
+    if (header == "*") return true;
+    string_view base(etag);
+    base.remove_suffix(1);   // the closing quote
+    size_t start = 0;
+    while (start < header.size()) {
+        size_t end = header.find(',', start);
+        if (end == string_view::npos) end = header.size();
+        string_view tag = header.substr(start, end - start);
+        start = end + 1;
+        while (!tag.empty() && tag.front() == ' ') tag.remove_prefix(1);
+        while (!tag.empty() && tag.back() == ' ') tag.remove_suffix(1);
+        if (tag.compare(0, 2, "W/") == 0) tag.remove_prefix(2);
+        if (tag.size() < base.size() + 1 || tag.compare(0, base.size(), base) != 0) continue;
+        string_view rest = tag.substr(base.size());
+        if (rest == "\"" || rest == "-gz\"" || rest == "-br\"") return true;
+    }
+    return false;
+}
+
+// Appends the response to out. API bodies are built in a per-thread
+// scratch buffer that keeps its capacity, so a steady stream of requests
+// serialises without allocating; only the final copy into out remains,
+// because Content-Length has to precede the body.
+void SimpleWebServer::buildResponse(const HttpRequest& request, bool& keepAlive, string& out, FileBody* file) {
+    string method(request.method);
+    string path(request.path);
+    keepAlive = isRunning && request.keepAlive();
+
+    cout << "Request: " << method << " " << path << "\n";
+
+    // Simple routing
+    if (method != "OPTIONS" && path.find("/api/") != 0) {
+        return serveStatic(request, path, keepAlive, out, file);
+    }
+
+    thread_local string body;
+    // Let a one-off huge response give its memory back
+    if (body.capacity() > maxPooledBody) string().swap(body);
+    body.clear();
+    // CORS Preflight
+    const char* contentType = "text/plain";
+    if (method != "OPTIONS") {
+        handleApiRequest(method, path, string(request.query), string(request.body),
+                         bearerToken(request.header("Authorization")), body);
+        contentType = "application/json";
+    }
+    apiResponse(request.header("Accept-Encoding"), keepAlive, contentType, body, out);
+}
+
+// Headers and body of an API response. Bodies past the threshold go out
+// compressed if the client takes gzip or deflate.
+void SimpleWebServer::apiResponse(string_view accepted, bool keepAlive, const char* contentType, const string& body,
+                                  string& out) {
+    const char* encoding = nullptr;
+    ContentCoding coding = ContentCoding::Gzip;
+    if (compressionLevel > 0 && body.size() >= compressionThreshold) {
+        if (acceptsEncoding(accepted, "gzip")) {
+            encoding = "gzip";
+        } else if (acceptsEncoding(accepted, "deflate")) {
+            encoding = "deflate";
+            coding = ContentCoding::Deflate;
+        }
+    }
+
+    auto appendHeaders = [&](string& to, size_t length, const char* contentEncoding) {
+        to += "HTTP/1.1 200 OK\r\n"
+              "Content-Type: ";
+        to += contentType;
+        to += "\r\nContent-Length: ";
+        to += to_string(length);
+        if (contentEncoding) {
+            to += "\r\nContent-Encoding: ";
+            to += contentEncoding;
+        }
+        to += "\r\n"
+              "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+              "Pragma: no-cache\r\n"
+              "Expires: 0\r\n";
+        if (compressionLevel > 0) to += "Vary: Accept-Encoding\r\n";
+        endHeaders(keepAlive, to);
+    };
+
+    // Compressed straight into out, so the headers, which need its length,
+    // are put in front afterwards; that moves only the compressed bytes
+    size_t start = out.size();
+    if (encoding && compressBody(body, coding, compressionLevel, out)) {
+        thread_local string headers;
+        headers.clear();
+        appendHeaders(headers, out.size() - start, encoding);
+        out.insert(start, headers);
+        return;
+    }
+    appendHeaders(out, body.size(), nullptr);
+    out += body;
+}
+
+// Files under www/ come from staticFiles, in the best encoding the client
+// accepts. Browsers revalidate each use (no-cache) and get a bodiless 304
+// while the ETag still matches. Files too large to cache are sent from
+// disk: left open in file for sendfile, or read into out without one.
+void SimpleWebServer::serveStatic(const HttpRequest& request, string path, bool keepAlive, string& out,
+                                  FileBody* file) {
+    if (path == "/") path = "/index.html";
+    string largeFile;
+    auto asset = staticFiles.lookup(path, largeFile);
+
+    const string* body = nullptr;
+    const char* encoding = nullptr;
+    const char* etagSuffix = "";
+    string etag, diskBody;
+    const char* contentType = StaticFileCache::contentTypeOf(path);
+    size_t length = 0;
+    int fd = -1;
+    if (asset) {
+        etag = asset->etag;
+        contentType = asset->contentType.c_str();
+        string_view accepted = request.header("Accept-Encoding");
+        if (!asset->brotli.empty() && acceptsEncoding(accepted, "br")) {
+            body = &asset->brotli;
+            encoding = "br";
+            etagSuffix = "-br";
+        } else if (!asset->gzip.empty() && acceptsEncoding(accepted, "gzip")) {
+            body = &asset->gzip;
+            encoding = "gzip";
+            etagSuffix = "-gz";
+        } else {
+            body = &asset->identity;
+        }
+        length = body->size();
+    } else if (!largeFile.empty()) {
+        struct stat st;
+#ifndef _WIN32
+        if (file) {
+            fd = open(largeFile.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0 && fstat(fd, &st) != 0) {
+                close(fd);
+                fd = -1;
+            }
+            if (fd >= 0) {
+                etag = StaticFileCache::etagOf(st.st_size, st.st_mtime);
+                length = st.st_size;
+            }
+        } else
+#endif
+        if (stat(largeFile.c_str(), &st) == 0) {
+            diskBody = StaticFileCache::readFile(largeFile);
+            etag = StaticFileCache::etagOf(diskBody.size(), st.st_mtime);
+            body = &diskBody;
+            length = diskBody.size();
+        }
+    }
+
+    if (etag.empty()) {
+        static const string notFound = "<h1>404 Not Found</h1>";
+        out += "HTTP/1.1 200 OK\r\n"
+               "Content-Type: text/html\r\n"
+               "Content-Length: " + to_string(notFound.size()) + "\r\n"
+               "Cache-Control: no-cache, no-store, must-revalidate\r\n";
+        endHeaders(keepAlive, out);
+        out += notFound;
+        return;
+    }
+
+    bool notModified = etagMatches(request.header("If-None-Match"), etag);
+    etag.insert(etag.size() - 1, etagSuffix);
+    out += notModified ? "HTTP/1.1 304 Not Modified\r\n" : "HTTP/1.1 200 OK\r\n";
+    out += "Content-Type: ";
+    out += contentType;
+    if (!notModified) {
+        out += "\r\nContent-Length: ";
+        out += to_string(length);
+    }
+    if (encoding) {
+        out += "\r\nContent-Encoding: ";
+        out += encoding;
+    }
+    out += "\r\nETag: ";
+    out += etag;
+    out += "\r\n"
+           "Cache-Control: no-cache\r\n"
+           "Vary: Accept-Encoding\r\n";
+    endHeaders(keepAlive, out);
+
+    if (notModified) {
+#ifndef _WIN32
+        if (fd >= 0) close(fd);
+#endif
+        return;
+    }
+    if (body) {
+        out += *body;
+    } else if (length > 0) {
+        file->fd = fd;
+        file->length = length;
+    } else {
+#ifndef _WIN32
+        close(fd);
+#endif
+    }
 }
 
-string SimpleWebServer::readFile(const string& path) {
-    ifstream file(path, ios::binary);
-    if (!file) return "";
-    stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+void SimpleWebServer::endHeaders(bool keepAlive, string& out) {
+    out += "Access-Control-Allow-Origin: *\r\n"
+           "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+           "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
+    if (keepAlive) {
+        out += "Connection: keep-alive\r\n"
+               "Keep-Alive: timeout=" + to_string(idleTimeoutSeconds) + "\r\n";
+    } else {
+        out += "Connection: close\r\n";
+    }
+    out += "\r\n";
 }
 
 // --- API Implementation ---
 
-string SimpleWebServer::handleApiRequest(const string& method, const string& path, const string& body) {
-    if (path == "/api/drugs" && method == "GET") return jsonDrugs();
-    if (path == "/api/report" && method == "GET") return jsonReport();
-    if (path == "/api/dashboard" && method == "GET") return jsonDashboard();
-    if (path == "/api/login" && method == "POST") return jsonLogin(body);
-    return "{\"error\": \"Endpoint not found\"}";
-}
-
-string SimpleWebServer::jsonDashboard() {
-    float revenue = controller->getDailyRevenue();
-    
-    int lowStockCount = 0;
-    for (const auto& d : controller->getDrugs()) {
-        if (d.isLowStock()) lowStockCount++;
-    }
-
-    int pendingRx = controller->getPendingPrescriptions().size();
-
-    auto& transactions = controller->getTransactions();
-    string recentTx = "[";
-    int count = 0;
-    // Get last 5 transactions
-    for (auto it = transactions.rbegin(); it != transactions.rend() && count < 5; ++it, ++count) {
-        recentTx += "{";
-        recentTx += "\"id\": " + to_string(it->id) + ",";
-        recentTx += "\"amount\": " + to_string(it->amount) + ",";
-        recentTx += "\"date\": \"" + it->date + "\",";
-        recentTx += "\"method\": \"" + it->paymentMethod + "\"";
-        recentTx += "}";
-        if (count < 4 && count < transactions.size() - 1) recentTx += ",";
-    }
-    recentTx += "]";
-
-    string json = "{";
-    json += "\"revenue\": " + to_string(revenue) + ",";
-    json += "\"lowStock\": " + to_string(lowStockCount) + ",";
-    json += "\"pendingRx\": " + to_string(pendingRx) + ",";
-    json += "\"recentTransactions\": " + recentTx;
-    json += "}";
-    return json;
-}
-
-string SimpleWebServer::jsonDrugs() {
-    auto& drugs = controller->getDrugs();
-    string json = "[";
-    for (size_t i = 0; i < drugs.size(); ++i) {
-        json += "{";
-        json += "\"name\": \"" + drugs[i].name + "\",";
-        json += "\"quantity\": " + to_string(drugs[i].quantity) + ",";
-        json += "\"price\": " + to_string(drugs[i].price) + ",";
-        json += "\"expiry\": \"" + drugs[i].expiryDate + "\"";
-        json += "}";
-        if (i < drugs.size() - 1) json += ",";
-    }
-    json += "]";
-    return json;
-}
-
-string SimpleWebServer::jsonReport() {
-    string json = "{";
-    json += "\"revenue\": " + to_string(controller->getDailyRevenue()) + ",";
-    json += "\"total_users\": " + to_string(DataManager::loadUsers().size()); // Direct load for simplicity or add getter to controller
-    json += "}";
-    return json;
-}
-
-string SimpleWebServer::jsonLogin(const string& body) {
-    // Very simple parsing for "username=foo&password=bar" or JSON
-    // Assuming JSON for simplicity in this "AI" context, but let's do simple string find
-    // Actually, let's assume the frontend sends raw JSON: {"username": "u", "password": "p"}
-    
-    string u, p;
-    size_t uPos = body.find("\"username\":");
-    if (uPos != string::npos) {
-        size_t start = body.find("\"", uPos + 11) + 1;
-        size_t end = body.find("\"", start);
-        u = body.substr(start, end - start);
+// Value of name in a query string ("a=1&b=2"), or "" if absent. Values
+// are returned as sent; free-text ones go through percentDecode.
+static string queryParam(const string& query, const string& name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == string::npos) end = query.size();
+        if (query.compare(start, name.size(), name) == 0 && start + name.size() < end
+            && query[start + name.size()] == '=') {
+            return query.substr(start + name.size() + 1, end - start - name.size() - 1);
+        }
+        start = end + 1;
     }
-    
-    size_t pPos = body.find("\"password\":");
-    if (pPos != string::npos) {
-        size_t start = body.find("\"", pPos + 11) + 1;
-        size_t end = body.find("\"", start);
-        p = body.substr(start, end - start);
+    return "";
+}
+
+// Undoes %XX escapes and form-style '+' for spaces; a malformed escape is
+// kept as it is
+static string percentDecode(const string& value) {
+    string decoded;
+    decoded.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '+') {
+            decoded += ' ';
+        } else if (value[i] == '%' && i + 2 < value.size() && isxdigit((unsigned char)value[i + 1]) &&
+                   isxdigit((unsigned char)value[i + 2])) {
+            decoded += (char)stoi(value.substr(i + 1, 2), nullptr, 16);
+            i += 2;
+        } else {
+            decoded += value[i];
+        }
+    }
+    return decoded;
+}
+
+void SimpleWebServer::handleApiRequest(const string& method, const string& path, const string& query,
+                                       const string& body, const string& token, string& out) {
+    if (path == "/api/drugs" && method == "GET") return jsonDrugs(query, out);
+    if (path == "/api/report" && method == "GET") return jsonReport(token, out);
+    if (path == "/api/dashboard" && method == "GET") return jsonDashboard(out);
+    if (path == "/api/login" && method == "POST") return jsonLogin(body, out);
+    if (path == "/api/logout" && method == "POST") return jsonLogout(token, out);
+    if (path == "/api/session" && method == "GET") return jsonSession(token, out);
+    if (path == "/api/audit" && method == "GET") return jsonAudit(query, out);
+    if (path == "/api/epidemic" && method == "GET") return jsonEpidemic(out);
+    jsonError("Endpoint not found", out);
+}
+
+void SimpleWebServer::jsonError(const char* message, string& out) {
+    JsonWriter(out).beginObject().field("error", message).endObject();
+}
+
+void SimpleWebServer::jsonDashboard(string& out) {
+    auto fields = dashboardFieldsOf(controller->getDashboard(5));
+    JsonWriter json(out);
+    json.beginObject();
+    for (size_t i = 0; i < fields.size(); ++i) json.key(dashboardFieldNames[i]).raw(fields[i]);
+    json.endObject();
+}
+
+void SimpleWebServer::jsonEpidemic(string& out) {
+    auto report = controller->getEpidemicReport();
+    int alerts = count_if(report.trends.begin(), report.trends.end(),
+                          [](const EpidemicDetector::Trend& t) { return t.alert; });
+
+    JsonWriter json(out);
+    json.beginObject()
+        .field("windowDays", report.config.windowDays)
+        .field("alerts", alerts);
+    // Alerts first, then by cases in the window
+    json.key("trends").beginArray();
+    for (const auto& t : report.trends) {
+        json.beginObject()
+            .field("diagnosis", t.diagnosis)
+            .field("today", t.today)
+            .field("window", t.window)
+            .field("baseline", t.baseline)
+            .field("deviation", t.deviation)
+            .field("cusum", t.cusum)
+            .field("alert", t.alert)
+            .endObject();
+    }
+    json.endArray().endObject();
+}
+
+// Fields a drug page can be projected onto, in output order
+static const char* const drugFieldNames[] = {"name", "quantity", "price", "expiry"};
+static const unsigned allDrugFields = 0xF;
+static const size_t maxDrugPage = 1000;
+
+static void writeDrug(JsonWriter& json, const Drug& d, unsigned fields) {
+    json.beginObject();
+    if (fields & 1) json.field("name", d.name);
+    if (fields & 2) json.field("quantity", d.quantity);
+    if (fields & 4) json.field("price", d.price);
+    if (fields & 8) json.field("expiry", d.expiryDate);
+    json.endObject();
+}
+
+// Without a query string, the whole inventory as a bare array, as before.
+// With one, a page: {"drugs": [...], "nextCursor": "..." or null}, taking
+//   limit           page size, 1-1000 (50)
+//   cursor          nextCursor of the previous page
+//   prefix          name prefix, ignoring case
+//   lowStock        1 or true for drugs at or below their threshold
+//   expiringBefore  DD/MM/YYYY; the page is then in expiry order
+//   fields          comma-separated subset of name,quantity,price,expiry
+void SimpleWebServer::jsonDrugs(const string& query, string& out) {
+    if (query.empty()) {
+        auto drugs = controller->getDrugs();
+        // Roughly 80 bytes per drug; one reservation instead of repeated growth
+        out.reserve(out.size() + drugs.size() * 80 + 2);
+        JsonWriter json(out);
+        json.beginArray();
+        for (const auto& d : drugs) writeDrug(json, d, allDrugFields);
+        json.endArray();
+        return;
+    }
+
+    DrugQuery request;
+    string limit = queryParam(query, "limit");
+    if (!limit.empty()) {
+        int n;
+        if (!parseCsvInt(limit, n) || n < 1 || (size_t)n > maxDrugPage) return jsonError("limit must be 1-1000", out);
+        request.limit = n;
+    }
+    request.cursor = queryParam(query, "cursor");
+    request.namePrefix = percentDecode(queryParam(query, "prefix"));
+    string lowStock = queryParam(query, "lowStock");
+    request.lowStockOnly = lowStock == "1" || lowStock == "true";
+    string before = percentDecode(queryParam(query, "expiringBefore"));
+    if (!before.empty()) {
+        request.expiringBefore = Date::parse(before);
+        if (request.expiringBefore == Date::invalid) return jsonError("expiringBefore must be DD/MM/YYYY", out);
+    }
+    unsigned fields = allDrugFields;
+    string wanted = percentDecode(queryParam(query, "fields"));
+    if (!wanted.empty()) {
+        fields = 0;
+        size_t start = 0;
+        while (start <= wanted.size()) {
+            size_t comma = min(wanted.find(',', start), wanted.size());
+            string name = wanted.substr(start, comma - start);
+            auto it = find_if(begin(drugFieldNames), end(drugFieldNames),
+                              [&](const char* field) { return name == field; });
+            if (it == end(drugFieldNames)) return jsonError("Unknown field", out);
+            fields |= 1u << (it - begin(drugFieldNames));
+            start = comma + 1;
+        }
     }
 
-    if (controller->login(u, p)) {
-        User* user = controller->getCurrentUser();
-        return "{\"success\": true, \"role\": \"" + user->getRoleString() + "\"}";
+    DrugPage page;
+    if (!controller->getDrugPage(request, page)) return jsonError("Invalid cursor", out);
+    out.reserve(out.size() + page.drugs.size() * 80 + 40);
+    JsonWriter json(out);
+    json.beginObject().key("drugs").beginArray();
+    for (const auto& d : page.drugs) writeDrug(json, d, fields);
+    json.endArray().key("nextCursor");
+    if (page.nextCursor.empty()) {
+        json.null();
+    } else {
+        json.value(page.nextCursor);
+    }
+    json.endObject();
+}
+
+// Revenue is for admin and billing sessions only
+void SimpleWebServer::jsonReport(const string& token, string& out) {
+    auto user = controller->getSessionUser(token);
+    if (!user) return jsonError("Not signed in", out);
+    if (user->role != UserRole::ADMIN && user->role != UserRole::BILLING) return jsonError("Not permitted", out);
+    JsonWriter(out).beginObject()
+        .field("revenue", controller->getDailyRevenue())
+        .field("total_users", controller->getUserCount())
+        .endObject();
+}
+
+// Waits for the password check on this thread; the epoll backend answers
+// logins through beginLogin instead
+void SimpleWebServer::jsonLogin(const string& body, string& out) {
+    string u, p;
+    parseCredentials(body, u, p);
+    // Later requests send the token instead of the credentials
+    bool busy = false;
+    string token = controller->login(u, p, &busy);
+    loginResult(token, busy, out);
+}
+
+void SimpleWebServer::loginResult(const string& token, bool busy, string& out) {
+    auto user = controller->getSessionUser(token);
+    JsonWriter json(out);
+    json.beginObject();
+    if (user) {
+        json.field("success", true).field("role", user->getRoleString()).field("token", token);
+    } else if (busy) {
+        json.field("success", false).field("error", "Server busy, please try again");
+    } else {
+        json.field("success", false);
+    }
+    json.endObject();
+}
+
+void SimpleWebServer::jsonLogout(const string& token, string& out) {
+    controller->logout(token);
+    JsonWriter(out).beginObject().field("success", true).endObject();
+}
+
+void SimpleWebServer::jsonSession(const string& token, string& out) {
+    auto user = controller->getSessionUser(token);
+    if (!user) return jsonError("Not signed in", out);
+    JsonWriter(out).beginObject()
+        .field("username", user->username)
+        .field("role", user->getRoleString())
+        .endObject();
+}
+
+// Inclusion proof for one transaction. A client holding the public key can
+// check it alone: hash the leaf up the path to the root, then
+// head = H(previousHead || root || count), and the signature over the seal.
+void SimpleWebServer::jsonAudit(const string& query, string& out) {
+    int id;
+    TransactionLedger::Proof proof;
+    if (!parseCsvInt(queryParam(query, "id"), id)) return jsonError("id required", out);
+    if (!controller->getLedgerProof(id, proof)) return jsonError("Transaction not found", out);
+
+    JsonWriter json(out);
+    json.beginObject()
+        .field("id", id)
+        .field("batch", proof.batch)
+        .field("index", proof.index)
+        .field("count", proof.count)
+        .field("leaf", TransactionLedger::toHex(proof.leaf));
+    json.key("path").beginArray();
+    for (const auto& step : proof.path) {
+        json.beginObject()
+            .field("side", step.siblingOnLeft ? "left" : "right")
+            .field("hash", TransactionLedger::toHex(step.sibling))
+            .endObject();
     }
-    return "{\"success\": false}";
+    json.endArray()
+        .field("root", TransactionLedger::toHex(proof.root))
+        .field("previousHead", TransactionLedger::toHex(proof.previousHead))
+        .field("head", TransactionLedger::toHex(proof.head))
+        .field("sealed", proof.sealed)
+        .field("signature", proof.signature)
+        .field("verified", controller->verifyLedgerProof(proof))
+        .endObject();
 }
@@ -4,35 +4,179 @@
 #include <string>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <unordered_map>
+#include <chrono>
+
+#ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
-#include "HospitalController.h"
 
 #pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+inline int closesocket(SOCKET s) { return ::close(s); }
+#endif
+
+#include "HospitalController.h"
+#include "HttpRequestParser.h"
+#include "StaticFileCache.h"
+
+// A response body left in an open file, to follow the headers built in out
+struct FileBody {
+    int fd = -1;
+    size_t length = 0;
+};
+
+// Per-socket state for the event-driven backend. Only one worker owns a
+// connection at a time (EPOLLONESHOT + lock), so the buffers need no
+// further synchronisation. The event broadcaster also appends to outBuf
+// of streaming connections, under the same lock.
+struct Connection : std::enable_shared_from_this<Connection> {
+    SOCKET fd;
+    std::mutex lock;
+    std::string inBuf;
+    std::string outBuf;
+    size_t outOffset = 0;
+    bool closeAfterWrite = false;
+    bool continueSent = false;
+    HttpRequestParser parser;
+#ifndef _WIN32
+    // Body sent with sendfile once outBuf is out; later pipelined requests
+    // wait for it
+    int fileFd = -1;
+    off_t fileOffset = 0;
+    size_t fileRemaining = 0;
+#endif
+    // Read by the idle sweeper without taking the lock
+    std::atomic<long long> lastActivity;
+    // Subscribed to /api/events; further input is ignored
+    std::atomic<bool> streaming{false};
+    // A login is being checked; later requests wait until its answer is
+    // in outBuf
+    bool awaitingResponse = false;
+
+    explicit Connection(SOCKET s) : fd(s), lastActivity(nowMillis()) {}
+#ifndef _WIN32
+    ~Connection() {
+        if (fileFd >= 0) ::close(fileFd);
+    }
+#endif
+
+    static long long nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
 
 class SimpleWebServer {
 private:
     SOCKET serverSocket;
     HospitalController* controller;
-    bool isRunning;
+    std::atomic<bool> isRunning;
     int port;
+    unsigned int workerCount;
+    int idleTimeoutSeconds;
+    int compressionLevel;           // 0 sends API bodies uncompressed
+    size_t compressionThreshold;
+    StaticFileCache staticFiles;
+
+    // --- Server-sent events (/api/events) ---
+    // Controller changes only set eventsDirty; eventThread turns each burst
+    // into at most one event carrying the dashboard fields that changed.
+    std::thread eventThread;
+    std::mutex eventMutex;
+    std::condition_variable eventSignal;     // eventsDirty or shutdown
+    std::condition_variable eventPublished;  // eventSeq advanced (Windows streams)
+    bool eventsDirty;
+    unsigned long long eventSeq;
+    std::string lastEvent;                   // the delta published as eventSeq
+    // Each field's JSON as last published; new subscribers start from this
+    std::array<std::string, 4> dashboardFields;
 
+    void markChanged();
+    void eventLoop();
+    void stopEvents();
+    void publish(const std::string& event);
+
+#ifndef _WIN32
+    int epollFd;
+    std::vector<std::thread> workers;
+    std::mutex connectionsMutex;
+    std::unordered_map<SOCKET, std::shared_ptr<Connection>> connections;
+    std::atomic<long long> lastSweep;
+    std::vector<std::weak_ptr<Connection>> eventClients;   // under eventMutex
+    // Logins queued for a hashing worker; start() waits for them to finish
+    std::mutex loginMutex;
+    std::condition_variable loginsIdle;
+    size_t pendingLogins;
+
+    void workerLoop();
+    void acceptConnections();
+    void serviceConnection(SOCKET fd, uint32_t events);
+    bool readFrom(Connection& conn);
+    bool flush(Connection& conn);
+    void processRequests(Connection& conn);
+    void rearm(Connection& conn);
+    void closeConnection(Connection& conn);
+    void sweepIdleConnections();
+    void openEventStream(Connection& conn);
+    void beginLogin(Connection& conn, const HttpRequest& request, bool keepAlive);
+    void finishLogin();
+#else
     void handleClient(SOCKET clientSocket);
-    std::string getContentType(const std::string& path);
-    std::string readFile(const std::string& path);
-    
-    // API Handlers
-    std::string handleApiRequest(const std::string& method, const std::string& path, const std::string& body);
-    std::string jsonDrugs();
-    std::string jsonReport();
-    std::string jsonDashboard();
-    std::string jsonLogin(const std::string& body);
+    void streamEvents(SOCKET clientSocket);
+#endif
+
+    // With file set, a large static file is left open there rather than
+    // read into out
+    void buildResponse(const HttpRequest& request, bool& keepAlive, std::string& out, FileBody* file = nullptr);
+    void serveStatic(const HttpRequest& request, std::string path, bool keepAlive, std::string& out, FileBody* file);
+    // CORS and connection headers, and the blank line ending the header block
+    void endHeaders(bool keepAlive, std::string& out);
+    // Headers for an API body (compressed if the client accepts it), then
+    // the body
+    void apiResponse(std::string_view acceptEncoding, bool keepAlive, const char* contentType,
+                     const std::string& body, std::string& out);
+    std::string errorResponse(int status);
+
+    // API Handlers; each appends its JSON body to out. token is the
+    // request's bearer token, empty if it sent none.
+    void handleApiRequest(const std::string& method, const std::string& path, const std::string& query,
+                          const std::string& body, const std::string& token, std::string& out);
+    void jsonError(const char* message, std::string& out);
+    void jsonDrugs(const std::string& query, std::string& out);
+    void jsonReport(const std::string& token, std::string& out);
+    void jsonDashboard(std::string& out);
+    void jsonLogin(const std::string& body, std::string& out);
+    void loginResult(const std::string& token, bool busy, std::string& out);
+    void jsonLogout(const std::string& token, std::string& out);
+    void jsonSession(const std::string& token, std::string& out);
+    void jsonAudit(const std::string& query, std::string& out);
+    void jsonEpidemic(std::string& out);
 
 public:
-    SimpleWebServer(HospitalController* ctrl, int p = 8080);
+    // workers == 0 picks one I/O worker per hardware thread
+    SimpleWebServer(HospitalController* ctrl, int p = 8080, unsigned int workers = 0);
     ~SimpleWebServer();
     void start();
     void stop();
+    // Keep-alive connections with no traffic for this long are closed
+    void setIdleTimeout(int seconds);
+    // zlib level (1 fastest, 9 smallest; 0 turns it off) for API bodies of
+    // at least minBytes, sent gzip or deflate as the client accepts
+    void setCompression(int level, size_t minBytes = 1024);
 };
 
 #endif
@@ -0,0 +1,225 @@
+#include "SnapshotFile.h"
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char snapshotMagic[4] = { 'H', 'S', 'N', 'P' };
+static const uint32_t snapshotVersion = 1;
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordType;
+    uint32_t columnCount;
+    uint64_t rowCount;
+    uint64_t heapOffset;
+    uint64_t heapSize;
+};
+
+struct ColumnEntry {
+    uint32_t kind;
+    uint32_t reserved;
+    uint64_t offset;
+};
+
+static size_t columnWidth(ColumnKind kind) {
+    return kind == ColumnKind::String ? 8 : 4;
+}
+
+static size_t alignTo8(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+// --- SnapshotWriter ---
+
+SnapshotWriter::SnapshotWriter(char type, const vector<ColumnKind>& columnKinds, size_t expectedRows)
+    : recordType(type), kinds(columnKinds), columns(columnKinds.size()), rows(0), heapOverflow(false) {
+    for (size_t i = 0; i < kinds.size(); ++i) {
+        columns[i].reserve(expectedRows * columnWidth(kinds[i]));
+    }
+}
+
+void SnapshotWriter::addInt(size_t column, int32_t value) {
+    columns[column].append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void SnapshotWriter::addFloat(size_t column, float value) {
+    columns[column].append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void SnapshotWriter::addString(size_t column, string_view value) {
+    // The heap never passes UINT32_MAX, so the subtraction cannot wrap
+    if (heapOverflow || value.size() > UINT32_MAX - heap.size()) {
+        heapOverflow = true;
+        return;
+    }
+    uint32_t ref[2] = { (uint32_t)heap.size(), (uint32_t)value.size() };
+    columns[column].append(reinterpret_cast<const char*>(ref), sizeof(ref));
+    heap.append(value.data(), value.size());
+}
+
+string SnapshotWriter::encode() const {
+    if (heapOverflow) {
+        cerr << "Error: snapshot string data exceeds 4 GiB\n";
+        return "";
+    }
+    SnapshotHeader header = {};
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.recordType = (uint32_t)recordType;
+    header.columnCount = (uint32_t)kinds.size();
+    header.rowCount = rows;
+
+    vector<ColumnEntry> directory(kinds.size());
+    size_t offset = alignTo8(sizeof(header) + directory.size() * sizeof(ColumnEntry));
+    for (size_t i = 0; i < kinds.size(); ++i) {
+        directory[i] = { (uint32_t)kinds[i], 0, offset };
+        offset = alignTo8(offset + columns[i].size());
+    }
+    header.heapOffset = offset;
+    header.heapSize = heap.size();
+
+    string out;
+    out.reserve(offset + heap.size());
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(ColumnEntry));
+    for (size_t i = 0; i < kinds.size(); ++i) {
+        out.resize(directory[i].offset, '\0');
+        out += columns[i];
+    }
+    out.resize(header.heapOffset, '\0');
+    out += heap;
+    return out;
+}
+
+// --- MappedFile ---
+
+#ifdef _WIN32
+MappedFile::MappedFile() : base(nullptr), length(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL) {}
+#else
+MappedFile::MappedFile() : base(nullptr), length(0) {}
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string& path) {
+    close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mappingHandle) { close(); return false; }
+    base = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!base) { close(); return false; }
+    length = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+    void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+    base = static_cast<const char*>(mapped);
+    length = st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (base) UnmapViewOfFile(base);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    mappingHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (base) munmap(const_cast<char*>(base), length);
+#endif
+    base = nullptr;
+    length = 0;
+}
+
+// --- SnapshotReader ---
+
+SnapshotReader::SnapshotReader() : rows(0), heapOffset(0), heapSize(0) {}
+
+bool SnapshotReader::open(const string& path, char recordType, const vector<ColumnKind>& expected) {
+    if (!file.open(path)) return false;
+
+    SnapshotHeader header;
+    if (file.size() < sizeof(header)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0
+        || header.recordType != (uint32_t)recordType
+        || header.columnCount != expected.size()) {
+        cerr << "Error: " << path << " is not a valid snapshot\n";
+        return false;
+    }
+    if (header.version != snapshotVersion) {
+        cerr << "Error: " << path << " has unsupported snapshot version " << header.version << "\n";
+        return false;
+    }
+
+    size_t directoryEnd = sizeof(header) + expected.size() * sizeof(ColumnEntry);
+    if (file.size() < directoryEnd
+        || header.heapOffset > file.size() || header.heapSize > file.size() - header.heapOffset) {
+        cerr << "Error: " << path << " is truncated\n";
+        return false;
+    }
+
+    kinds = expected;
+    offsets.resize(expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ColumnEntry entry;
+        memcpy(&entry, file.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+        // rowCount comes from the file, so it is compared by division
+        // rather than trusted in a multiplication that could wrap
+        if (entry.kind != (uint32_t)expected[i] || entry.offset > file.size()
+            || header.rowCount > (file.size() - entry.offset) / columnWidth(expected[i])) {
+            cerr << "Error: " << path << " has a damaged column directory\n";
+            return false;
+        }
+        offsets[i] = entry.offset;
+    }
+
+    rows = header.rowCount;
+    heapOffset = header.heapOffset;
+    heapSize = header.heapSize;
+    return true;
+}
+
+int32_t SnapshotReader::intAt(size_t column, size_t row) const {
+    int32_t value;
+    memcpy(&value, file.data() + offsets[column] + row * sizeof(value), sizeof(value));
+    return value;
+}
+
+float SnapshotReader::floatAt(size_t column, size_t row) const {
+    float value;
+    memcpy(&value, file.data() + offsets[column] + row * sizeof(value), sizeof(value));
+    return value;
+}
+
+string_view SnapshotReader::stringAt(size_t column, size_t row) const {
+    uint32_t ref[2];
+    memcpy(ref, file.data() + offsets[column] + row * sizeof(ref), sizeof(ref));
+    if ((uint64_t)ref[0] + ref[1] > heapSize) return string_view();
+    return string_view(file.data() + heapOffset + ref[0], ref[1]);
+}
@@ -0,0 +1,91 @@
+#ifndef SNAPSHOTFILE_H
+#define SNAPSHOTFILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Versioned binary snapshot of one table, laid out column by column:
+//   header | column directory | column data ... | string heap
+// Numeric columns are fixed-width int32/float32 arrays. String columns hold
+// a (uint32 offset, uint32 length) pair per row pointing into the heap.
+// Files are little-endian and opened through a read-only memory map, so
+// opening one is O(1) and a row is only decoded when it is asked for.
+
+enum class ColumnKind : uint32_t {
+    Int32 = 1,
+    Float32 = 2,
+    String = 3
+};
+
+class SnapshotWriter {
+private:
+    char recordType;
+    std::vector<ColumnKind> kinds;
+    std::vector<std::string> columns;
+    std::string heap;
+    size_t rows;
+    bool heapOverflow;              // a string fell past the 32-bit references
+
+public:
+    SnapshotWriter(char recordType, const std::vector<ColumnKind>& kinds, size_t expectedRows = 0);
+
+    // Values are appended column by column; every column must end up with
+    // the same number of values before encode() is called.
+    void addInt(size_t column, int32_t value);
+    void addFloat(size_t column, float value);
+    void addString(size_t column, std::string_view value);
+    void endRow() { ++rows; }
+
+    // The file's bytes, or "" if the string heap outgrew its 32-bit
+    // offsets (an encoded snapshot is never empty)
+    std::string encode() const;
+};
+
+// Read-only memory map of a whole file
+class MappedFile {
+private:
+    const char* base;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+};
+
+class SnapshotReader {
+private:
+    MappedFile file;
+    std::vector<ColumnKind> kinds;
+    std::vector<uint64_t> offsets;
+    size_t rows;
+    uint64_t heapOffset;
+    uint64_t heapSize;
+
+public:
+    SnapshotReader();
+
+    // Maps the file and checks magic, version, record type and column layout
+    bool open(const std::string& path, char recordType, const std::vector<ColumnKind>& expected);
+
+    size_t rowCount() const { return rows; }
+    int32_t intAt(size_t column, size_t row) const;
+    float floatAt(size_t column, size_t row) const;
+    // View into the mapping; valid while the reader is open
+    std::string_view stringAt(size_t column, size_t row) const;
+};
+
+#endif
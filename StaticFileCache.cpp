@@ -0,0 +1,249 @@
+#include "StaticFileCache.h"
+#include "Utils.h"
+#include "Compression.h"
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+// Smaller files go out as they are; a gzip variant must also save a tenth
+static const size_t minCompressBytes = 256;
+
+static bool isCompressible(const string& contentType) {
+    return contentType.compare(0, 5, "text/") == 0 || contentType == "application/javascript" ||
+           contentType == "application/json" || contentType == "application/xml" ||
+           contentType == "image/svg+xml" || contentType == "application/wasm";
+}
+
+// FNV-1a, enough to tell versions of one file apart
+static unsigned long long contentHash(const string& data) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool statRegular(const string& path, struct stat& st) {
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+}
+
+// A precompressed sibling, if there is one no older than the file itself
+static string readSibling(const string& path, const struct stat& original) {
+    struct stat st;
+    if (!statRegular(path, st) || st.st_mtime < original.st_mtime) return "";
+    return StaticFileCache::readFile(path);
+}
+
+StaticFileCache::StaticFileCache(const string& r)
+    : root(r), totalBytes(0), generation(0), watching(false) {
+#ifdef __linux__
+    stopping = false;
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0) {
+        watchTree();
+        watcher = thread(&StaticFileCache::watchLoop, this);
+    }
+#endif
+}
+
+StaticFileCache::~StaticFileCache() {
+#ifdef __linux__
+    stopping = true;
+    if (watcher.joinable()) watcher.join();
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
+
+const char* StaticFileCache::contentTypeOf(string_view path) {
+    static const unordered_map<string, const char*> types = {
+        {"html", "text/html"},
+        {"htm", "text/html"},
+        {"css", "text/css"},
+        {"js", "application/javascript"},
+        {"mjs", "application/javascript"},
+        {"json", "application/json"},
+        {"map", "application/json"},
+        {"xml", "application/xml"},
+        {"txt", "text/plain"},
+        {"csv", "text/csv"},
+        {"svg", "image/svg+xml"},
+        {"png", "image/png"},
+        {"jpg", "image/jpeg"},
+        {"jpeg", "image/jpeg"},
+        {"gif", "image/gif"},
+        {"webp", "image/webp"},
+        {"ico", "image/x-icon"},
+        {"woff", "font/woff"},
+        {"woff2", "font/woff2"},
+        {"ttf", "font/ttf"},
+        {"wasm", "application/wasm"},
+        {"pdf", "application/pdf"},
+        {"gz", "application/gzip"},
+    };
+    size_t dot = path.find_last_of("./");
+    if (dot == string_view::npos || path[dot] != '.') return "text/plain";
+    auto it = types.find(Utils::toLowerCase(string(path.substr(dot + 1))));
+    return it == types.end() ? "text/plain" : it->second;
+}
+
+string StaticFileCache::etagOf(off_t size, time_t modified) {
+    char tag[48];
+    snprintf(tag, sizeof(tag), "\"%llx-%llx\"", (unsigned long long)size, (unsigned long long)modified);
+    return tag;
+}
+
+string StaticFileCache::readFile(const string& path) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) return "";
+    string data((size_t)file.tellg(), '\0');
+    file.seekg(0);
+    if (!file.read(&data[0], data.size())) return "";
+    return data;
+}
+
+void StaticFileCache::invalidate() {
+    unique_lock<shared_mutex> guard(lock);
+    assets.clear();
+    totalBytes = 0;
+    ++generation;
+}
+
+shared_ptr<const StaticFileCache::Asset> StaticFileCache::lookup(string_view path, string& largeFile) {
+    // Only paths inside the root; percent-escapes are not decoded, so an
+    // encoded ".." is just a name that does not exist
+    if (path.empty() || path[0] != '/' || path.find("..") != string_view::npos ||
+        path.find('\\') != string_view::npos || path.find('\0') != string_view::npos) {
+        return nullptr;
+    }
+    string key(path);
+    string file = root + key;
+
+    struct stat st;
+    bool checked = false;
+    {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = assets.find(key);
+        if (it != assets.end()) {
+            if (watching) return it->second;
+            shared_ptr<const Asset> asset = it->second;
+            guard.unlock();
+            checked = true;
+            if (!statRegular(file, st)) return nullptr;
+            if (st.st_size == asset->size && st.st_mtime == asset->modified) return asset;
+        }
+    }
+    if (!checked && !statRegular(file, st)) return nullptr;
+    if ((size_t)st.st_size > maxAssetBytes) {
+        largeFile = file;
+        return nullptr;
+    }
+
+    unsigned long long seen = generation;
+    shared_ptr<const Asset> asset = load(file);
+    if (!asset) return nullptr;
+    size_t cost = asset->identity.size() + asset->gzip.size() + asset->brotli.size();
+
+    unique_lock<shared_mutex> guard(lock);
+    if (generation != seen) return asset;
+    auto it = assets.find(key);
+    size_t replaced = 0;
+    if (it != assets.end()) {
+        replaced = it->second->identity.size() + it->second->gzip.size() + it->second->brotli.size();
+    }
+    if (totalBytes - replaced + cost > maxTotalBytes) {
+        largeFile = file;
+        return nullptr;
+    }
+    totalBytes = totalBytes - replaced + cost;
+    assets[key] = asset;
+    return asset;
+}
+
+shared_ptr<const StaticFileCache::Asset> StaticFileCache::load(const string& file) {
+    struct stat st;
+    if (!statRegular(file, st)) return nullptr;
+    auto asset = make_shared<Asset>();
+    asset->size = st.st_size;
+    asset->modified = st.st_mtime;
+    asset->identity = readFile(file);
+    if ((off_t)asset->identity.size() != st.st_size) return nullptr;   // changed while being read
+    asset->contentType = contentTypeOf(file);
+
+    char tag[48];
+    snprintf(tag, sizeof(tag), "\"%llx-%llx\"", (unsigned long long)asset->identity.size(),
+             contentHash(asset->identity));
+    asset->etag = tag;
+
+    if (isCompressible(asset->contentType) && asset->identity.size() >= minCompressBytes) {
+        asset->gzip = readSibling(file + ".gz", st);
+        if (asset->gzip.empty()) compressBody(asset->identity, ContentCoding::Gzip, 9, asset->gzip);
+        if (asset->gzip.size() > asset->identity.size() / 10 * 9) asset->gzip.clear();
+        asset->brotli = readSibling(file + ".br", st);
+    }
+    return asset;
+}
+
+#ifdef __linux__
+// Watches the root and every directory below it. Adding a watch that
+// already exists only returns it again, so this is also how directories
+// created later get watched.
+void StaticFileCache::watchTree() {
+    static const uint32_t events = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                   IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    vector<string> pending = {root};
+    bool rootWatched = false;
+    while (!pending.empty()) {
+        string dir = pending.back();
+        pending.pop_back();
+        if (inotify_add_watch(inotifyFd, dir.c_str(), events | IN_ONLYDIR) < 0) continue;
+        if (dir == root) rootWatched = true;
+        DIR* handle = opendir(dir.c_str());
+        if (!handle) continue;
+        while (dirent* entry = readdir(handle)) {
+            string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            struct stat st;
+            string child = dir + "/" + name;
+            if (stat(child.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR) pending.push_back(child);
+        }
+        closedir(handle);
+    }
+    // Without a watch on the root, lookups fall back to checking each file
+    watching = rootWatched;
+}
+
+void StaticFileCache::watchLoop() {
+    alignas(inotify_event) char buffer[4096];
+    while (!stopping) {
+        pollfd fd = {inotifyFd, POLLIN, 0};
+        if (poll(&fd, 1, 500) <= 0) continue;
+
+        bool changed = false, rescan = false;
+        ssize_t n;
+        while ((n = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + n;) {
+                const inotify_event* event = (const inotify_event*)p;
+                changed = true;
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) rescan = true;
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_Q_OVERFLOW)) rescan = true;
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (rescan) watchTree();
+        if (changed) invalidate();
+    }
+}
+#endif
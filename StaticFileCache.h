@@ -0,0 +1,82 @@
+#ifndef STATICFILECACHE_H
+#define STATICFILECACHE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <ctime>
+#include <sys/types.h>
+
+// In-memory copies of the files under a web root (www/), each with its
+// ETag and the compressed variants worth sending:
+//   gzip    a file.gz beside the file if it is at least as new, otherwise
+//           compressed here once, when that saves enough to be worth it
+//   brotli  only a file.br beside the file, precompressed at deploy time
+// On Linux the root is watched with inotify and any change empties the
+// cache, so lookups never touch the disk for a cached file. Elsewhere (or
+// if the watch fails) each lookup compares the file's size and mtime with
+// the cached copy.
+//
+// Files larger than maxAssetBytes, or that would take the cache past
+// maxTotalBytes, are not held; lookup names the file instead so that the
+// server can send it straight from disk.
+class StaticFileCache {
+public:
+    struct Asset {
+        std::string contentType;
+        std::string etag;           // quoted; variants append -gz / -br
+        std::string identity;
+        std::string gzip;           // empty when not worth sending
+        std::string brotli;
+        off_t size = 0;             // of the file when it was read
+        time_t modified = 0;
+    };
+
+    static const size_t maxAssetBytes = 1024 * 1024;
+    static const size_t maxTotalBytes = 64 * 1024 * 1024;
+
+private:
+    std::string root;
+    std::shared_mutex lock;
+    std::unordered_map<std::string, std::shared_ptr<const Asset>> assets;
+    size_t totalBytes;
+    // Bumped by every invalidation; a file read under an older generation
+    // is served but not cached, since it may predate the change
+    std::atomic<unsigned long long> generation;
+    std::atomic<bool> watching;
+#ifdef __linux__
+    int inotifyFd;
+    std::atomic<bool> stopping;
+    std::thread watcher;
+
+    void watchTree();
+    void watchLoop();
+#endif
+
+    void invalidate();
+    std::shared_ptr<const Asset> load(const std::string& file);
+
+public:
+    explicit StaticFileCache(const std::string& root = "www");
+    ~StaticFileCache();
+    StaticFileCache(const StaticFileCache&) = delete;
+    StaticFileCache& operator=(const StaticFileCache&) = delete;
+
+    // The asset for a request path ("/app.js"). Returns nullptr if there
+    // is no such regular file under the root, or if it is too large to
+    // cache, in which case largeFile is set to its path on disk.
+    std::shared_ptr<const Asset> lookup(std::string_view path, std::string& largeFile);
+
+    // Content type by file extension; text/plain for unknown ones
+    static const char* contentTypeOf(std::string_view path);
+    // An ETag from size and mtime, for files sent from disk unread
+    static std::string etagOf(off_t size, time_t modified);
+    static std::string readFile(const std::string& path);
+};
+
+#endif
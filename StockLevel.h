@@ -0,0 +1,39 @@
+#ifndef STOCKLEVEL_H
+#define STOCKLEVEL_H
+
+#include <atomic>
+
+// Lock-free stock counters for one drug. onHand is what is on the shelf;
+// available is onHand minus the units reserved for prescriptions that have
+// not been dispensed yet. Units are reserved with a CAS loop, so any number
+// of concurrent dispensers can never take available below zero.
+struct StockLevel {
+    std::atomic<int> onHand;
+    std::atomic<int> available;
+
+    explicit StockLevel(int quantity) : onHand(quantity), available(quantity) {}
+
+    bool reserve(int units) {
+        if (units < 0) return false;
+        int current = available.load(std::memory_order_relaxed);
+        do {
+            if (current < units) return false;
+        } while (!available.compare_exchange_weak(current, current - units,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed));
+        return true;
+    }
+
+    // Hands reserved units back, e.g. when the prescription was dispensed
+    // by someone else in the meantime
+    void release(int units) {
+        available.fetch_add(units, std::memory_order_acq_rel);
+    }
+
+    // Takes previously reserved units off the shelf; returns what is left
+    int commit(int units) {
+        return onHand.fetch_sub(units, std::memory_order_acq_rel) - units;
+    }
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define TRANSACTION_H
 
 #include <string>
+#include "Date.h"
 
 struct Transaction {
     int id;
@@ -10,6 +11,7 @@ struct Transaction {
     std::string date;
     std::string paymentMethod; // "Cash", "Insurance", "Mobile"
     std::string signature; // Digital signature for verification
+    int day = Date::invalid; // date parsed; set by the controller
 };
 
 #endif
@@ -0,0 +1,216 @@
+#include "TransactionLedger.h"
+#include "CsvTokenizer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const size_t none = static_cast<size_t>(-1);
+
+TransactionLedger::TransactionLedger(DigitalSignatureManager& m) : manager(m), firstBadBatch(none) {}
+
+// --- Hashing ---
+// Leaves, inner nodes and chain heads get distinct prefixes, so no value of
+// one kind can be passed off as another
+TransactionLedger::Digest TransactionLedger::hashOf(const string& data) const {
+    Digest result{};
+    vector<unsigned char> d = manager.digest(data);
+    if (d.size() == result.size()) memcpy(result.data(), d.data(), d.size());
+    return result;
+}
+
+TransactionLedger::Digest TransactionLedger::leafHash(const Transaction& t) const {
+    string data(1, '\0');
+    data += to_string(t.id) + ',' + to_string(t.prescriptionId) + ',';
+    appendCsvFloat(data, t.amount);
+    data += ',';
+    appendCsvField(data, t.date);
+    return hashOf(data);
+}
+
+TransactionLedger::Digest TransactionLedger::nodeHash(const Digest& left, const Digest& right) const {
+    string data(1, '\1');
+    data.append(left.begin(), left.end());
+    data.append(right.begin(), right.end());
+    return hashOf(data);
+}
+
+TransactionLedger::Digest TransactionLedger::chainHash(const Digest& previous, const Digest& root, size_t count) const {
+    string data(1, '\2');
+    data.append(previous.begin(), previous.end());
+    data.append(root.begin(), root.end());
+    data += to_string(count);
+    return hashOf(data);
+}
+
+// An odd node at the end of a level is carried up unchanged rather than
+// paired with a copy of itself, so no two different batches share a root.
+TransactionLedger::Digest TransactionLedger::merkleRoot(const vector<Digest>& hashes, size_t begin, size_t end,
+                                                        size_t target, vector<ProofStep>* path) const {
+    vector<Digest> level(hashes.begin() + begin, hashes.begin() + end);
+    while (level.size() > 1) {
+        vector<Digest> next;
+        next.reserve((level.size() + 1) / 2);
+        for (size_t i = 0; i < level.size(); i += 2) {
+            if (i + 1 == level.size()) {
+                next.push_back(level[i]);
+                continue;
+            }
+            if (path && (target == i || target == i + 1)) {
+                bool targetOnRight = target == i + 1;
+                path->push_back({targetOnRight, level[targetOnRight ? i : i + 1]});
+            }
+            next.push_back(nodeHash(level[i], level[i + 1]));
+        }
+        target /= 2;
+        level.swap(next);
+    }
+    return level.empty() ? Digest{} : level[0];
+}
+
+vector<TransactionLedger::Digest> TransactionLedger::leafHashes(const RowSource& rows, size_t begin, size_t end) const {
+    vector<Digest> hashes;
+    hashes.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) hashes.push_back(leafHash(rows(i)));
+    return hashes;
+}
+
+// --- Batches ---
+size_t TransactionLedger::closeBatch() {
+    Digest previous = heads.empty() ? Digest{} : heads.back();
+    Digest head = chainHash(previous, merkleRoot(leaves, 0, leaves.size()), leaves.size());
+    batchEnds.push_back(openBegin() + leaves.size());
+    heads.push_back(head);
+    seals.push_back({leaves.size(), toHex(head), ""});
+    leaves.clear();
+    return seals.size() - 1;
+}
+
+vector<size_t> TransactionLedger::rebuild(size_t rowCount, const RowSource& rows, const vector<LedgerSeal>& stored) {
+    leaves.clear();
+    batchEnds.clear();
+    heads.clear();
+    seals = stored;
+    firstBadBatch = none;
+
+    // Stored seals are kept as they are, even when they no longer match,
+    // so the evidence survives the next compaction
+    Digest head{};
+    size_t end = 0;
+    for (size_t b = 0; b < seals.size(); ++b) {
+        size_t count = seals[b].count;
+        if (count == 0 || end + count > rowCount) {
+            firstBadBatch = b;   // rows were removed
+            break;
+        }
+        vector<Digest> hashes = leafHashes(rows, end, end + count);
+        head = chainHash(head, merkleRoot(hashes, 0, count), count);
+        end += count;
+        batchEnds.push_back(end);
+        heads.push_back(head);
+        if (intact() && toHex(head) != seals[b].head) firstBadBatch = b;
+    }
+
+    vector<size_t> closed;
+    for (size_t i = end; i < rowCount; ++i) {
+        leaves.push_back(leafHash(rows(i)));
+        if (intact() && leaves.size() == batchSize) closed.push_back(closeBatch());
+    }
+    return closed;
+}
+
+size_t TransactionLedger::append(const Transaction& t) {
+    leaves.push_back(leafHash(t));
+    if (!intact() || leaves.size() < batchSize) return none;
+    return closeBatch();
+}
+
+size_t TransactionLedger::closeOpenBatch() {
+    if (!intact() || leaves.empty()) return none;
+    return closeBatch();
+}
+
+string TransactionLedger::sealData(size_t batch, const LedgerSeal& seal) {
+    return "ledger," + to_string(batch) + ',' + to_string(seal.count) + ',' + seal.head;
+}
+
+// --- Proofs and audit ---
+// A closed batch is rehashed from its rows, so a row changed since it was
+// sealed yields a proof that fails to verify
+bool TransactionLedger::proof(size_t position, const RowSource& rows, Proof& out) const {
+    if (position >= openBegin() + leaves.size()) return false;
+    size_t batch = upper_bound(batchEnds.begin(), batchEnds.end(), position) - batchEnds.begin();
+    size_t begin = batch ? batchEnds[batch - 1] : 0;
+    size_t end = batch < batchEnds.size() ? batchEnds[batch] : openBegin() + leaves.size();
+
+    out = Proof();
+    out.position = position;
+    out.batch = batch;
+    out.index = position - begin;
+    out.count = end - begin;
+    out.sealed = batch < batchEnds.size();
+    vector<Digest> hashes = out.sealed ? leafHashes(rows, begin, end) : leaves;
+    out.leaf = hashes[out.index];
+    out.root = merkleRoot(hashes, 0, hashes.size(), out.index, &out.path);
+    out.previousHead = batch ? heads[batch - 1] : Digest{};
+    if (out.sealed) {
+        out.head = heads[batch];
+        out.signature = seals[batch].signature;
+    } else {
+        // What the head will be if the batch is closed as it stands
+        out.head = chainHash(out.previousHead, out.root, out.count);
+    }
+    return true;
+}
+
+bool TransactionLedger::verify(const Proof& proof) const {
+    Digest node = proof.leaf;
+    for (const auto& step : proof.path) {
+        node = step.siblingOnLeft ? nodeHash(step.sibling, node) : nodeHash(node, step.sibling);
+    }
+    if (node != proof.root || chainHash(proof.previousHead, proof.root, proof.count) != proof.head) return false;
+    if (!proof.sealed || proof.signature.empty()) return false;
+    LedgerSeal seal{proof.count, toHex(proof.head), proof.signature};
+    return manager.verifySignature(sealData(proof.batch, seal), seal.signature);
+}
+
+TransactionLedger::AuditResult TransactionLedger::audit(size_t rowCount, const RowSource& rows) const {
+    AuditResult result;
+    Digest head{};
+    size_t end = 0;
+    size_t newestSigned = none;
+    for (size_t b = 0; b < seals.size(); ++b) {
+        size_t count = seals[b].count;
+        if (count == 0 || end + count > rowCount) {
+            result.firstBadBatch = b;
+            break;
+        }
+        vector<Digest> fresh = leafHashes(rows, end, end + count);
+        head = chainHash(head, merkleRoot(fresh, 0, count), count);
+        if (toHex(head) != seals[b].head) {
+            result.firstBadBatch = b;
+            break;
+        }
+        end += count;
+        ++result.batches;
+        result.sealedRows = end;
+        if (!seals[b].signature.empty()) newestSigned = b;
+    }
+    // The chain ties every earlier head to this one
+    if (newestSigned != none) {
+        const LedgerSeal& seal = seals[newestSigned];
+        result.signatureValid = manager.verifySignature(sealData(newestSigned, seal), seal.signature);
+    }
+    return result;
+}
+
+string TransactionLedger::toHex(const Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    string hex;
+    hex.reserve(digest.size() * 2);
+    for (unsigned char c : digest) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0xF];
+    }
+    return hex;
+}
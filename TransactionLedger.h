@@ -0,0 +1,113 @@
+#ifndef TRANSACTIONLEDGER_H
+#define TRANSACTIONLEDGER_H
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Transaction.h"
+#include "LedgerSeal.h"
+#include "DigitalSignatureManager.h"
+
+// Tamper-evident view of the transaction table. Rows are grouped, in table
+// order, into batches of up to batchSize. Each batch has a Merkle tree over
+// its rows, and the batches form a hash chain
+//     head[b] = H(head[b-1] || root[b] || count[b])
+// that is sealed by signing head[b]. A seal covers its batch and, through
+// the chain, everything before it: auditing the whole table costs one hash
+// pass and one signature check, and a single row is proven with about
+// log2(batchSize) sibling hashes plus its batch's seal. Changing, inserting
+// or deleting a row breaks every later head.
+//
+// Leaves hash the fields fixed at billing (id, prescription, amount, date);
+// the payment method and row signature are updated in place later.
+// Only the open batch's leaves are kept. Rows are read through a RowSource
+// when a closed batch is rehashed (rebuild, proof, audit), so memory grows
+// with the number of batches, not rows, and archived rows need not be
+// resident. Not thread-safe; the controller guards it with the
+// transactions lock.
+class TransactionLedger {
+public:
+    using Digest = std::array<unsigned char, 32>;
+    // The row at a table position; called in increasing position order
+    // within a batch
+    using RowSource = std::function<Transaction(size_t position)>;
+    static const size_t batchSize = 256;
+
+    struct ProofStep {
+        bool siblingOnLeft;
+        Digest sibling;
+    };
+
+    struct Proof {
+        size_t position = 0;        // row in the table
+        size_t batch = 0;
+        size_t index = 0;           // row within the batch
+        size_t count = 0;           // rows in the batch
+        bool sealed = false;        // false for the open batch
+        Digest leaf{};
+        std::vector<ProofStep> path; // leaf to root
+        Digest root{};
+        Digest previousHead{};      // all zero for the first batch
+        Digest head{};
+        std::string signature;      // empty while unsealed or unsigned
+    };
+
+    struct AuditResult {
+        size_t batches = 0;
+        size_t sealedRows = 0;
+        size_t firstBadBatch = static_cast<size_t>(-1);  // -1 when intact
+        bool signatureValid = false;  // newest signed seal; false if none
+    };
+
+private:
+    DigitalSignatureManager& manager;
+    std::vector<Digest> leaves;      // rows of the open batch
+    std::vector<size_t> batchEnds;   // one past the last row of each closed batch
+    std::vector<Digest> heads;       // per closed batch
+    std::vector<LedgerSeal> seals;   // per closed batch, as stored
+    size_t firstBadBatch;
+
+    Digest hashOf(const std::string& data) const;
+    Digest leafHash(const Transaction& t) const;
+    Digest chainHash(const Digest& previous, const Digest& root, size_t count) const;
+    Digest nodeHash(const Digest& left, const Digest& right) const;
+    // Merkle root over hashes [begin, end) of level; fills path for row target
+    Digest merkleRoot(const std::vector<Digest>& level, size_t begin, size_t end,
+                      size_t target = 0, std::vector<ProofStep>* path = nullptr) const;
+    std::vector<Digest> leafHashes(const RowSource& rows, size_t begin, size_t end) const;
+    size_t openBegin() const { return batchEnds.empty() ? 0 : batchEnds.back(); }
+    size_t closeBatch();
+
+public:
+    explicit TransactionLedger(DigitalSignatureManager& manager);
+
+    // Hashes the table and checks it against the stored seals. Rows past
+    // the last seal are closed into new batches, whose numbers are returned
+    // so they can be logged and signed; nothing new is sealed on top of a
+    // batch that no longer matches its seal.
+    std::vector<size_t> rebuild(size_t rowCount, const RowSource& rows, const std::vector<LedgerSeal>& stored);
+    // Adds the next row; returns the number of the batch this closed, or -1
+    size_t append(const Transaction& t);
+    // Closes a partly filled open batch (at shutdown); -1 if nothing to close
+    size_t closeOpenBatch();
+
+    bool intact() const { return firstBadBatch == static_cast<size_t>(-1); }
+    const std::vector<LedgerSeal>& getSeals() const { return seals; }
+    const LedgerSeal& seal(size_t batch) const { return seals[batch]; }
+    void setSignature(size_t batch, const std::string& signature) { seals[batch].signature = signature; }
+    // The text signed for a seal
+    static std::string sealData(size_t batch, const LedgerSeal& seal);
+
+    // Inclusion proof for the row at position; false if out of range
+    bool proof(size_t position, const RowSource& rows, Proof& out) const;
+    // Recomputes the proof's root and head and checks its seal signature
+    bool verify(const Proof& proof) const;
+    // Rehashes rows from scratch against the stored seals, checking the
+    // signature of the newest signed seal only
+    AuditResult audit(size_t rowCount, const RowSource& rows) const;
+
+    static std::string toHex(const Digest& digest);
+};
+
+#endif
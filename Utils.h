@@ -12,7 +12,14 @@
 namespace Utils {
     inline std::string getCurrentDate() {
         time_t now = time(0);
-        tm* ltm = localtime(&now);
+        // localtime() shares one static buffer; use the reentrant variants
+        tm local;
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        tm* ltm = &local;
         
         std::stringstream ss;
         ss << std::setfill('0') << std::setw(2) << ltm->tm_mday << "/"
@@ -0,0 +1,300 @@
+#include "WriteAheadLog.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct Crc32Table {
+    uint32_t entries[256];
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32(const char* data, size_t length) {
+    // Function-local static: built once, thread-safely, on first use
+    static const Crc32Table crcTable;
+    const uint32_t* table = crcTable.entries;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t recordChecksum(char type, const string& payload) {
+    string covered = string(1, type) + payload;
+    return crc32(covered.data(), covered.size());
+}
+
+// Records are one line each, so a line break in a payload (a quoted CSV
+// field can hold one) is stored as the two characters \n and a backslash
+// as \\. The checksum covers the stored form.
+static string escapePayload(const string& payload) {
+    if (payload.find_first_of("\\\n") == string::npos) return payload;
+    string escaped;
+    escaped.reserve(payload.size() + 8);
+    for (char c : payload) {
+        if (c == '\\') escaped += "\\\\";
+        else if (c == '\n') escaped += "\\n";
+        else escaped += c;
+    }
+    return escaped;
+}
+
+static string unescapePayload(const string& stored) {
+    if (stored.find('\\') == string::npos) return stored;
+    string payload;
+    payload.reserve(stored.size());
+    for (size_t i = 0; i < stored.size(); ++i) {
+        if (stored[i] == '\\' && i + 1 < stored.size() && (stored[i + 1] == 'n' || stored[i + 1] == '\\')) {
+            payload += stored[++i] == 'n' ? '\n' : '\\';
+        } else {
+            payload += stored[i];
+        }
+    }
+    return payload;
+}
+
+static int syncFile(FILE* f) {
+#ifdef _WIN32
+    return _commit(_fileno(f));
+#else
+    return fsync(fileno(f));
+#endif
+}
+
+WriteAheadLog::WriteAheadLog(const string& p)
+    : path(p), file(nullptr), bytesOnDisk(0), stopping(false), pendingRecords(0),
+      appendedSeq(0), durableSeq(0), broken(false), waiters(0),
+      maxDelay(1000), maxBatch(128) {
+    error_code ec;
+    auto existing = filesystem::file_size(path, ec);
+    if (!ec) bytesOnDisk = existing;
+    flusher = thread(&WriteAheadLog::flushLoop, this);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    sync();
+    {
+        lock_guard<mutex> guard(queueMutex);
+        stopping = true;
+    }
+    flushRequested.notify_all();
+    flusher.join();
+    if (file) fclose(file);
+}
+
+bool WriteAheadLog::openForAppend() {
+    if (file) return true;
+    file = fopen(path.c_str(), "ab");
+    if (!file) {
+        cerr << "Error: cannot open write-ahead log " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void WriteAheadLog::setGroupCommit(chrono::microseconds delay, size_t batchRecords) {
+    lock_guard<mutex> guard(queueMutex);
+    maxDelay = delay;
+    maxBatch = max<size_t>(1, batchRecords);
+}
+
+uint64_t WriteAheadLog::append(char type, const string& payload) {
+    lock_guard<mutex> guard(queueMutex);
+    return enqueue(type, payload);
+}
+
+uint64_t WriteAheadLog::append(char type, const function<string()>& makePayload) {
+    lock_guard<mutex> guard(queueMutex);
+    return enqueue(type, makePayload());
+}
+
+// Caller holds queueMutex
+uint64_t WriteAheadLog::enqueue(char type, const string& payload) {
+    string stored = escapePayload(payload);
+    char checksum[9];
+    snprintf(checksum, sizeof(checksum), "%08x", recordChecksum(type, stored));
+
+    pending += type;
+    pending += '|';
+    pending += checksum;
+    pending += '|';
+    pending += stored;
+    pending += '\n';
+    ++pendingRecords;
+    if (pendingRecords >= maxBatch) flushRequested.notify_one();
+    return ++appendedSeq;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t seq) {
+    unique_lock<mutex> lock(queueMutex);
+    if (seq > durableSeq) {
+        ++waiters;
+        flushRequested.notify_one();
+        batchDone.wait(lock, [&] { return durableSeq >= seq; });
+        --waiters;
+    }
+    return !inFailedBatch(seq);
+}
+
+// Caller holds queueMutex
+bool WriteAheadLog::inFailedBatch(uint64_t seq) const {
+    for (const auto& range : failedRanges) {
+        if (seq > range.first && seq <= range.second) return true;
+    }
+    return false;
+}
+
+bool WriteAheadLog::sync() {
+    uint64_t seq;
+    {
+        lock_guard<mutex> guard(queueMutex);
+        seq = appendedSeq;
+    }
+    return waitDurable(seq);
+}
+
+// Cuts the file back to the end of the last batch that was persisted, so
+// whatever a failed write left behind is not followed by later records.
+// Caller holds fileMutex.
+bool WriteAheadLog::truncateToGood() {
+    // Closing first: fclose may still flush part of the failed batch
+    if (file) { fclose(file); file = nullptr; }
+    error_code ec;
+    filesystem::resize_file(path, bytesOnDisk, ec);
+    if (ec) {
+        cerr << "Error: cannot cut the failed batch off write-ahead log " << path
+             << "; no further records will be accepted until compaction\n";
+        broken = true;
+        return false;
+    }
+    return true;
+}
+
+bool WriteAheadLog::writeBatch(const string& batch) {
+    lock_guard<mutex> guard(fileMutex);
+    if (broken || !openForAppend()) return false;
+
+    bool ok = fwrite(batch.data(), 1, batch.size(), file) == batch.size()
+              && fflush(file) == 0
+              && syncFile(file) == 0;
+    if (!ok) {
+        cerr << "Error: failed to persist write-ahead log records\n";
+        truncateToGood();
+        return false;
+    }
+    bytesOnDisk += batch.size();
+    return true;
+}
+
+// Sleeps until a caller needs durability, lets the batch fill for up to
+// maxDelay, then persists everything queued with a single fsync. Records
+// appended while a batch is being written simply join the next one.
+void WriteAheadLog::flushLoop() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        flushRequested.wait(lock, [&] {
+            return stopping || (pendingRecords > 0 && (waiters > 0 || pendingRecords >= maxBatch));
+        });
+        if (pendingRecords == 0) {
+            if (stopping) return;
+            continue;
+        }
+
+        if (!stopping && pendingRecords < maxBatch && maxDelay.count() > 0) {
+            flushRequested.wait_for(lock, maxDelay, [&] { return stopping || pendingRecords >= maxBatch; });
+        }
+
+        string batch;
+        batch.swap(pending);
+        uint64_t batchStart = durableSeq;
+        uint64_t batchEnd = appendedSeq;
+        pendingRecords = 0;
+
+        lock.unlock();
+        bool ok = writeBatch(batch);
+        lock.lock();
+
+        if (!ok) {
+            // Waiters are released with an error. The failed records are
+            // no longer in the file, so later batches carry on after it.
+            if (!failedRanges.empty() && failedRanges.back().second == batchStart) {
+                failedRanges.back().second = batchEnd;
+            } else {
+                failedRanges.emplace_back(batchStart, batchEnd);
+            }
+        }
+        durableSeq = batchEnd;
+        batchDone.notify_all();
+    }
+}
+
+size_t WriteAheadLog::size() {
+    lock_guard<mutex> guard(queueMutex);
+    return bytesOnDisk + pending.size();
+}
+
+size_t WriteAheadLog::replay(const function<void(char, const string&)>& apply) {
+    ifstream in(path, ios::binary);
+    if (!in) return 0;
+
+    size_t applied = 0;
+    size_t goodBytes = 0;
+    string line;
+    while (getline(in, line)) {
+        // A final line without '\n' was cut off mid-write
+        if (in.eof()) break;
+        if (line.size() < 11 || line[1] != '|' || line[10] != '|') break;
+
+        char type = line[0];
+        string payload = line.substr(11);
+        uint32_t stored = (uint32_t)strtoul(line.substr(2, 8).c_str(), NULL, 16);
+        if (stored != recordChecksum(type, payload)) break;
+
+        apply(type, unescapePayload(payload));
+        ++applied;
+        goodBytes += line.size() + 1;
+    }
+    in.close();
+
+    if (goodBytes < bytesOnDisk) {
+        cerr << "Warning: discarding " << (bytesOnDisk - goodBytes)
+             << " bytes of incomplete write-ahead log\n";
+        if (file) { fclose(file); file = nullptr; }
+        error_code ec;
+        filesystem::resize_file(path, goodBytes, ec);
+        bytesOnDisk = goodBytes;
+    }
+    return applied;
+}
+
+bool WriteAheadLog::reset() {
+    sync();
+    lock_guard<mutex> guard(fileMutex);
+    if (file) { fclose(file); file = nullptr; }
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: cannot truncate write-ahead log " << path << "\n";
+        return false;
+    }
+    syncFile(file);
+    bytesOnDisk = 0;
+    // The snapshots now hold everything, failed records included
+    broken = false;
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+// Append-only log of typed mutation records. Each record is one line:
+//   <type>|<crc32 hex>|<payload>
+// with line breaks and backslashes in the payload escaped. append() only
+// buffers a record and returns its sequence number. A background flusher
+// group-commits: once someone waits for durability it gathers records from
+// every thread for up to maxDelay (or until maxBatch records are queued),
+// writes them with one write+fsync and wakes all callers whose records
+// were in the batch. A torn tail is cut off on replay.
+// A batch that fails to write is cut off the file again, so later batches
+// never follow a torn record; if even that fails, the log stops accepting
+// batches until reset() starts a fresh file.
+class WriteAheadLog {
+private:
+    std::string path;
+    FILE* file;
+    std::atomic<size_t> bytesOnDisk;
+
+    std::mutex queueMutex;          // guards the queue and sequence numbers
+    std::mutex fileMutex;           // guards file, held while writing
+    std::condition_variable flushRequested;
+    std::condition_variable batchDone;
+    std::thread flusher;
+    bool stopping;
+
+    std::string pending;
+    size_t pendingRecords;
+    uint64_t appendedSeq;
+    uint64_t durableSeq;
+    // Sequence ranges (from, to] that could not be persisted, merged when
+    // adjacent; every waiter in one gets an error
+    std::vector<std::pair<uint64_t, uint64_t>> failedRanges;
+    bool broken;                    // a torn batch could not be cut off; under fileMutex
+    size_t waiters;
+
+    std::chrono::microseconds maxDelay;
+    size_t maxBatch;
+
+    bool openForAppend();
+    uint64_t enqueue(char type, const std::string& payload);
+    bool inFailedBatch(uint64_t seq) const;
+    bool truncateToGood();
+    bool writeBatch(const std::string& batch);
+    void flushLoop();
+
+public:
+    explicit WriteAheadLog(const std::string& path);
+    ~WriteAheadLog();
+
+    uint64_t append(char type, const std::string& payload);
+    // Builds the payload while holding the queue lock, so records describing
+    // state that racing threads update in place (e.g. a stock counter) are
+    // logged in the same order as the values they carry
+    uint64_t append(char type, const std::function<std::string()>& makePayload);
+    // Blocks until every record up to seq is on disk; false if its batch failed
+    bool waitDurable(uint64_t seq);
+    // Waits for everything appended so far
+    bool sync();
+    void setGroupCommit(std::chrono::microseconds delay, size_t batchRecords);
+
+    // Feeds every intact record to apply, in order, and returns the count.
+    // Only call while no other thread is appending.
+    size_t replay(const std::function<void(char, const std::string&)>& apply);
+    // Drops all records once they are captured by a snapshot. Records
+    // appended concurrently with reset() are lost, so callers must exclude
+    // writers while compacting.
+    bool reset();
+
+    size_t size();
+};
+
+#endif
@@ -6,7 +6,21 @@
 
 using namespace std;
 
-HospitalController systemController;
+// Created in main once the mode is known: its constructor replays the log,
+// compacts and archives, which the snapshot conversion must run before
+HospitalController* systemController = nullptr;
+// Token of the console's session; empty while signed out
+string consoleSession;
+
+// The signed-in console user, until the session is closed or expires
+optional<User> consoleUser() {
+    return systemController->getSessionUser(consoleSession);
+}
+
+void logout() {
+    systemController->logout(consoleSession);
+    consoleSession.clear();
+}
 
 void clearInput() {
     cin.clear();
@@ -33,15 +47,18 @@ void adminMenu() {
                 cout << "Username: "; cin >> u;
                 cout << "Password: "; cin >> p;
                 cout << "Role (0:Admin, 1:Doctor, 2:Pharmacist, 3:Billing): "; cin >> r;
-                systemController.addUser({u, p, static_cast<UserRole>(r)});
-                cout << "User added.\n";
+                if (systemController->addUser({u, p, static_cast<UserRole>(r)})) {
+                    cout << "User added.\n";
+                } else {
+                    cout << "User was not saved.\n";
+                }
                 break;
             }
-            case 2: systemController.generateReport(); break;
-            case 3: systemController.checkEpidemicTrends(); break;
-            case 4: systemController.logout(); break;
+            case 2: systemController->generateReport(); break;
+            case 3: systemController->checkEpidemicTrends(); break;
+            case 4: logout(); break;
         }
-    } while (systemController.getCurrentUser() != nullptr);
+    } while (consoleUser());
 }
 
 void doctorMenu() {
@@ -56,20 +73,22 @@ void doctorMenu() {
 
         switch (choice) {
             case 1: {
-                auto& drugs = systemController.getDrugs();
+                auto drugs = systemController->getDrugs();
                 for (const auto& d : drugs) {
                     cout << d.name << " - Stock: " << d.quantity << " - Price: " << d.price << "\n";
                 }
                 break;
             }
             case 2: {
+                auto doctor = consoleUser();
+                if (!doctor) break;   // session expired
                 Prescription p;
                 p.id = rand() % 10000; // Simple ID generation
-                p.doctorName = systemController.getCurrentUser()->username;
+                p.doctorName = doctor->username;
                 cout << "Patient Name: "; cin >> ws; getline(cin, p.patientName);
                 cout << "Drug Name: "; cin >> ws; getline(cin, p.drugName);
                 
-                Drug* d = systemController.findDrug(p.drugName);
+                auto d = systemController->findDrug(p.drugName);
                 if (!d) {
                     cout << "Drug not found!\n";
                     break;
@@ -84,12 +103,12 @@ void doctorMenu() {
                 p.date = Utils::getCurrentDate();
                 p.status = "pending";
                 
-                systemController.createPrescription(p);
+                systemController->createPrescription(p);
                 break;
             }
-            case 3: systemController.logout(); break;
+            case 3: logout(); break;
         }
-    } while (systemController.getCurrentUser() != nullptr);
+    } while (consoleUser());
 }
 
 void pharmacistMenu() {
@@ -107,7 +126,7 @@ void pharmacistMenu() {
 
         switch (choice) {
             case 1: {
-                auto pending = systemController.getPendingPrescriptions();
+                auto pending = systemController->getPendingPrescriptions();
                 if (pending.empty()) cout << "No pending prescriptions.\n";
                 for (const auto& p : pending) {
                     cout << "ID: " << p.id << " | Patient: " << p.patientName << " | Drug: " << p.drugName << " (" << p.quantity << ")\n";
@@ -117,11 +136,11 @@ void pharmacistMenu() {
             case 2: {
                 int id;
                 cout << "Enter Prescription ID: "; cin >> id;
-                systemController.dispensePrescription(id);
+                systemController->dispensePrescription(id);
                 break;
             }
-            case 3: systemController.checkLowStock(); break;
-            case 4: systemController.checkExpiry(); break;
+            case 3: systemController->checkLowStock(); break;
+            case 4: systemController->checkExpiry(); break;
             case 5: {
                 Drug d;
                 cout << "Name: "; cin >> ws; getline(cin, d.name);
@@ -129,13 +148,16 @@ void pharmacistMenu() {
                 cout << "Quantity: "; cin >> d.quantity;
                 cout << "Expiry (DD/MM/YYYY): "; cin >> d.expiryDate;
                 cout << "Min Threshold: "; cin >> d.minThreshold;
-                systemController.addDrug(d);
-                cout << "Drug added.\n";
+                if (systemController->addDrug(d)) {
+                    cout << "Drug added.\n";
+                } else {
+                    cout << "Drug was not saved.\n";
+                }
                 break;
             }
-            case 6: systemController.logout(); break;
+            case 6: logout(); break;
         }
-    } while (systemController.getCurrentUser() != nullptr);
+    } while (consoleUser());
 }
 
 void billingMenu() {
@@ -154,13 +176,13 @@ void billingMenu() {
                 string method;
                 cout << "Enter Transaction ID (from Bill): "; cin >> id;
                 cout << "Payment Method (Cash/Insurance/Mobile): "; cin >> method;
-                systemController.processPayment(id, method);
+                systemController->processPayment(id, method);
                 break;
             }
-            case 2: cout << "Daily Revenue: KES " << systemController.getDailyRevenue() << "\n"; break;
-            case 3: systemController.logout(); break;
+            case 2: cout << "Daily Revenue: KES " << systemController->getDailyRevenue() << "\n"; break;
+            case 3: logout(); break;
         }
-    } while (systemController.getCurrentUser() != nullptr);
+    } while (consoleUser());
 }
 
 int main() {
@@ -170,17 +192,27 @@ int main() {
     cout << "Select Mode:\n";
     cout << "1. Console Application\n";
     cout << "2. Web Server (Port 8080)\n";
+    cout << "3. Convert Text Data Files to Binary Snapshots\n";
     cout << "Choice: ";
     cin >> mode;
 
+    if (mode == 3) {
+        DataManager::convertToSnapshots();
+        return 0;
+    }
+
+    HospitalController controller;
+    systemController = &controller;
+
     if (mode == 2) {
-        SimpleWebServer server(&systemController, 8080);
+        SimpleWebServer server(systemController, 8080);
         server.start();
         return 0;
     }
 
     while (true) {
-        if (systemController.getCurrentUser() == nullptr) {
+        auto user = consoleUser();
+        if (!user) {
             string u, p;
             cout << "\n=== LOGIN ===\n";
             cout << "Enter Username (or 'exit' to quit): "; cin >> u;
@@ -188,13 +220,17 @@ int main() {
             
             cout << "Password: "; cin >> p;
             
-            if (systemController.login(u, p)) {
-                cout << "Login Successful! Role: " << systemController.getCurrentUser()->getRoleString() << "\n";
+            bool busy = false;
+            consoleSession = systemController->login(u, p, &busy);
+            if (auto signedIn = consoleUser()) {
+                cout << "Login Successful! Role: " << signedIn->getRoleString() << "\n";
+            } else if (busy) {
+                cout << "System busy, please try again.\n";
             } else {
                 cout << "Invalid credentials.\n";
             }
         } else {
-            switch (systemController.getCurrentUser()->role) {
+            switch (user->role) {
                 case UserRole::ADMIN: adminMenu(); break;
                 case UserRole::DOCTOR: doctorMenu(); break;
                 case UserRole::PHARMACIST: pharmacistMenu(); break;
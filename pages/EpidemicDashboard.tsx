@@ -1,7 +1,7 @@
 import React, { useState, useEffect } from 'react';
 import { analyzeEpidemicRisks } from '../services/geminiService';
 import { RECENT_SYMPTOMS } from '../services/mockData';
-import { EpidemicReport } from '../types';
+import { EpidemicReport, EpidemicState } from '../types';
 import { 
   Activity, 
   AlertOctagon, 
@@ -26,6 +26,17 @@ import {
 export const EpidemicDashboard: React.FC = () => {
   const [loading, setLoading] = useState(false);
   const [report, setReport] = useState<EpidemicReport | null>(null);
+  const [detector, setDetector] = useState<EpidemicState | null>(null);
+
+  // Live per-diagnosis trends kept by the C++ backend
+  const fetchDetector = async () => {
+    try {
+      const response = await fetch('http://localhost:8080/api/epidemic');
+      if (response.ok) setDetector(await response.json());
+    } catch (e) {
+      console.error(e);
+    }
+  };
 
   const generateReport = async () => {
     setLoading(true);
@@ -42,9 +53,12 @@ export const EpidemicDashboard: React.FC = () => {
   useEffect(() => {
     // Initial Load
     generateReport();
+    fetchDetector();
+    const interval = setInterval(fetchDetector, 30000);
+    return () => clearInterval(interval);
   }, []);
 
-  // Stats for Charts (derived from mock data)
+  // Stats for Charts (from the backend detector, else the mock data)
   const symptomsCount = RECENT_SYMPTOMS.reduce((acc, curr) => {
     curr.symptoms.forEach(s => {
       acc[s] = (acc[s] || 0) + 1;
@@ -52,10 +66,16 @@ export const EpidemicDashboard: React.FC = () => {
     return acc;
   }, {} as Record<string, number>);
 
-  const chartData = Object.keys(symptomsCount).map(key => ({
-    name: key,
-    count: symptomsCount[key]
-  })).sort((a,b) => b.count - a.count).slice(0, 5);
+  const chartData = detector && detector.trends.length > 0
+    ? detector.trends
+        .map(t => ({ name: t.diagnosis, count: t.window }))
+        .sort((a, b) => b.count - a.count)
+        .slice(0, 5)
+    : Object.keys(symptomsCount).map(key => ({
+        name: key,
+        count: symptomsCount[key]
+      })).sort((a,b) => b.count - a.count).slice(0, 5);
+  const detectedAlerts = detector?.trends.filter(t => t.alert) ?? [];
 
   const COLORS = ['#0088FE', '#00C49F', '#FFBB28', '#FF8042', '#8884d8'];
 
@@ -88,8 +108,10 @@ export const EpidemicDashboard: React.FC = () => {
             </div>
             <h3 className="font-semibold text-slate-700">Total Cases Analyzed</h3>
           </div>
-          <p className="text-3xl font-bold text-slate-900">{RECENT_SYMPTOMS.length}</p>
-          <p className="text-xs text-slate-400 mt-1">Last 7 Days</p>
+          <p className="text-3xl font-bold text-slate-900">
+            {detector ? detector.trends.reduce((sum, t) => sum + t.window, 0) : RECENT_SYMPTOMS.length}
+          </p>
+          <p className="text-xs text-slate-400 mt-1">Last {detector?.windowDays ?? 7} Days</p>
         </div>
 
         <div className={`p-6 rounded-xl shadow-sm border ${
@@ -196,6 +218,11 @@ export const EpidemicDashboard: React.FC = () => {
                  <div>
                    <h4 className="text-sm font-bold text-slate-500 uppercase tracking-wide mb-2">Detected Anomalies</h4>
                    <div className="flex gap-2 flex-wrap">
+                     {detectedAlerts.map(t => (
+                       <span key={t.diagnosis} className="px-3 py-1 bg-red-100 text-red-700 rounded-full text-sm font-medium border border-red-200">
+                         {t.diagnosis}: {t.today} today (baseline {t.baseline.toFixed(1)}/day)
+                       </span>
+                     ))}
                      {report.detectedOutbreaks.map((outbreak, idx) => (
                        <span key={idx} className="px-3 py-1 bg-red-100 text-red-700 rounded-full text-sm font-medium border border-red-200">
                          {outbreak}
@@ -25,9 +25,21 @@ export function RealTimeDashboard() {
     };
 
     useEffect(() => {
-        fetchData();
-        const interval = setInterval(fetchData, 3000); // Poll every 3 seconds
-        return () => clearInterval(interval);
+        // The server pushes the full dashboard on connect, then only the
+        // fields that changed; EventSource reconnects by itself.
+        const events = new EventSource('http://localhost:8080/api/events');
+        events.addEventListener('dashboard', (e) => {
+            const changes: Partial<DashboardData> = JSON.parse((e as MessageEvent).data);
+            setData(prev => ({ ...(prev ?? {}), ...changes } as DashboardData));
+            setLastUpdated(new Date());
+            setError(null);
+            setLoading(false);
+        });
+        events.onerror = () => {
+            setError('Connection to Hospital System failed. Is the C++ backend running?');
+            setLoading(false);
+        };
+        return () => events.close();
     }, []);
 
     if (loading && !data) return <div className="p-8 text-center">Connecting to Hospital System...</div>;
@@ -0,0 +1,55 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <cstdlib>
+
+// Shared by the standalone test drivers in this directory. Each driver is
+// its own executable built from the sources it tests; it prints every
+// failed check and exits with 1 if there were any, 0 if all passed.
+//
+// Randomised drivers take an optional seed and iteration count:
+//   <driver> [seed] [iterations]
+// and print the seed they used, so a failing run can be repeated.
+
+static std::atomic<int> checkFailures(0);
+
+#define CHECK(cond) checkAt((cond), #cond, __FILE__, __LINE__, "")
+#define CHECK_MSG(cond, context) checkAt((cond), #cond, __FILE__, __LINE__, (context))
+
+inline bool checkAt(bool ok, const char* expr, const char* file, int line, const std::string& context) {
+    if (!ok) {
+        ++checkFailures;
+        std::cerr << file << ":" << line << ": check failed: " << expr;
+        if (!context.empty()) std::cerr << " (" << context << ")";
+        std::cerr << "\n";
+    }
+    return ok;
+}
+
+struct FuzzOptions {
+    unsigned seed;
+    long iterations;
+};
+
+inline FuzzOptions fuzzOptions(int argc, char** argv, long defaultIterations) {
+    FuzzOptions o;
+    o.seed = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : std::random_device()();
+    o.iterations = argc > 2 ? strtol(argv[2], NULL, 10) : defaultIterations;
+    std::cout << "seed " << o.seed << ", " << o.iterations << " iterations\n";
+    return o;
+}
+
+inline int checkSummary(const char* name) {
+    if (checkFailures == 0) {
+        std::cout << name << ": all checks passed\n";
+    } else {
+        std::cout << name << ": " << checkFailures << " checks failed\n";
+    }
+    return checkFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "../Compression.h"
+#include "../JsonWriter.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+using namespace std;
+
+// compressBody checked by inflating its output with zlib: gzip and deflate
+// bodies of every size class, at every level, must come back unchanged,
+// and whatever was already in the output buffer must be left in place.
+//
+//   CompressionTest [seed] [iterations]
+//   CompressionTest --bench               /api/drugs at 10k, 100k and 1M drugs
+
+static bool inflateBody(string_view compressed, ContentCoding coding, string& out) {
+    z_stream zs = {};
+    if (inflateInit2(&zs, coding == ContentCoding::Gzip ? 16 + MAX_WBITS : MAX_WBITS) != Z_OK) return false;
+    zs.next_in = (Bytef*)compressed.data();
+    zs.avail_in = (uInt)compressed.size();
+    int status = Z_OK;
+    char buffer[16384];
+    while (status == Z_OK) {
+        zs.next_out = (Bytef*)buffer;
+        zs.avail_out = sizeof(buffer);
+        status = inflate(&zs, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - zs.avail_out);
+    }
+    bool complete = status == Z_STREAM_END && zs.avail_in == 0;
+    inflateEnd(&zs);
+    return complete;
+}
+
+// Compressible text with some random bytes mixed in
+static string randomBody(mt19937& rng) {
+    static const size_t sizes[] = { 0, 1, 100, 65535, 65536, 65537, 300000 };
+    string body(rng() % 3 ? rng() % 5000 : sizes[rng() % size(sizes)], ' ');
+    for (char& c : body) c = rng() % 8 ? "{\"name\":\"Amoxicillin\"},"[rng() % 23] : (char)rng();
+    return body;
+}
+
+static void fuzz(const FuzzOptions& options) {
+    mt19937 rng(options.seed);
+    for (long i = 0; i < options.iterations; ++i) {
+        string body = randomBody(rng);
+        ContentCoding coding = rng() % 2 ? ContentCoding::Gzip : ContentCoding::Deflate;
+        int level = rng() % 11;   // 0 and 10 are clamped to 1 and 9
+        string out = "HTTP/1.1 200 OK\r\n";
+        if (rng() % 2) out.reserve(rng() % 200000);
+        string prefix = out;
+
+        string context = "iteration " + to_string(i) + ", " + to_string(body.size()) + " bytes, level " + to_string(level);
+        if (!CHECK_MSG(compressBody(body, coding, level, out), context)) return;
+        CHECK_MSG(out.compare(0, prefix.size(), prefix) == 0, context);
+        string back;
+        if (!CHECK_MSG(inflateBody(string_view(out).substr(prefix.size()), coding, back) && back == body, context)) return;
+    }
+}
+
+static void testFraming() {
+    string gzip, deflate;
+    CHECK(compressBody("hello", ContentCoding::Gzip, 6, gzip));
+    CHECK(compressBody("hello", ContentCoding::Deflate, 6, deflate));
+    // gzip magic, and a zlib header whose check bits hold
+    CHECK(gzip.size() > 2 && (unsigned char)gzip[0] == 0x1F && (unsigned char)gzip[1] == 0x8B);
+    CHECK(deflate.size() > 2 && (deflate[0] & 0x0F) == 8
+          && (((unsigned char)deflate[0] << 8) | (unsigned char)deflate[1]) % 31 == 0);
+}
+
+// --- Benchmark ---
+
+static string drugsJson(size_t count) {
+    mt19937 rng(1);
+    string out;
+    JsonWriter json(out);
+    json.beginArray();
+    for (size_t i = 0; i < count; ++i) {
+        json.beginObject()
+            .field("name", "Amoxicillin " + to_string(250 + i % 4 * 250) + "mg batch " + to_string(i))
+            .field("quantity", (int)(rng() % 5000))
+            .field("price", (float)(rng() % 100000) / 100)
+            .field("expiry", to_string(1 + rng() % 28) + "/" + to_string(1 + rng() % 12) + "/2027")
+            .endObject();
+    }
+    json.endArray();
+    return out;
+}
+
+static void bench() {
+    for (size_t count : { 10000, 100000, 1000000 }) {
+        string body = drugsJson(count);
+        cout << count << " drugs, " << body.size() / 1024 << " kB:\n";
+        for (int level : { 1, 6, 9 }) {
+            string out;
+            auto start = chrono::steady_clock::now();
+            bool ok = compressBody(body, ContentCoding::Gzip, level, out);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << "  level " << level << ": " << out.size() / 1024 << " kB (" << (long)(100.0 * out.size() / body.size())
+                 << "%), " << ms << " ms, " << (long)(body.size() / ms / 1e3) << " MB/s" << (ok ? "" : " (failed)") << "\n";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+    FuzzOptions options = fuzzOptions(argc, argv, 500);
+
+    testFraming();
+    fuzz(options);
+    return checkSummary("CompressionTest");
+}
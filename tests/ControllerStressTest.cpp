@@ -0,0 +1,182 @@
+#include "Check.h"
+#include "../HospitalController.h"
+#include "../Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// HospitalController used the way the web server's workers use it: threads
+// creating and dispensing prescriptions of one drug, taking payments and
+// adding drugs, against threads reading inventory, pages, the dashboard,
+// transactions and the ledger. The added drugs carry long names, so the
+// log outgrows its limit and persist() compacts while the others run.
+// Meant to be built with -fsanitize=thread as well; without it, it checks
+// that nothing is lost or oversold. Runs in a fresh directory under the
+// system temp directory.
+//
+//   ControllerStressTest [seed] [iterations]
+
+static const int hotStock = 1000000;
+// Enough 3 kB names between them to pass the log's 4 MB compaction limit
+static const long drugsPerStocker = 800;
+
+struct Totals {
+    atomic<int> prescriptions{0};
+    atomic<int> drugsAdded{0};
+    atomic<int> payments{0};
+    atomic<int> reads{0};
+};
+
+static void dispenser(HospitalController& controller, atomic<int>& nextId, long iterations, Totals& totals) {
+    string today = Utils::getCurrentDate();
+    for (long i = 0; i < iterations; ++i) {
+        int id = nextId++;
+        controller.createPrescription({ id, "Dr Stress", "Patient " + to_string(id % 50), "Hot drug", 1, today,
+                                        "pending", "Influenza", "" });
+        controller.dispensePrescription(id);
+        ++totals.prescriptions;
+    }
+}
+
+static void payer(HospitalController& controller, const atomic<bool>& done, Totals& totals) {
+    while (!done) {
+        for (const Transaction& t : controller.getRecentTransactions(5)) {
+            if (t.paymentMethod == "Pending") {
+                controller.processPayment(t.id, "M-Pesa");
+                ++totals.payments;
+            }
+        }
+        this_thread::yield();
+    }
+}
+
+static void stocker(HospitalController& controller, unsigned seed, long iterations, Totals& totals) {
+    mt19937 rng(seed);
+    for (long i = 0; i < iterations; ++i) {
+        string name = "Stress drug " + to_string(seed) + "-" + to_string(i) + " " + string(3000, 'x');
+        controller.addDrug({ name, 2.5f, (int)(rng() % 40), "01/01/2031", 10 });
+        ++totals.drugsAdded;
+    }
+}
+
+// Checks only what must hold at any instant: the inventory never shrinks,
+// the hot drug's stock never rises, and every page is sorted by name
+static void reader(const HospitalController& controller, const atomic<bool>& done, Totals& totals) {
+    size_t lastCount = 0;
+    int lastHot = INT_MAX;
+    while (!done) {
+        vector<Drug> drugs = controller.getDrugs();
+        CHECK(drugs.size() >= lastCount);
+        lastCount = drugs.size();
+        if (optional<Drug> hot = controller.findDrug("Hot drug")) {
+            CHECK(hot->quantity <= lastHot && hot->quantity >= 0);
+            lastHot = hot->quantity;
+        }
+
+        DrugQuery q;
+        q.limit = 20;
+        DrugPage page;
+        if (CHECK(controller.getDrugPage(q, page))) {
+            CHECK(is_sorted(page.drugs.begin(), page.drugs.end(), [](const Drug& a, const Drug& b) {
+                return Utils::toLowerCase(a.name) < Utils::toLowerCase(b.name);
+            }));
+        }
+        controller.getDashboard(10);
+        controller.getRecentTransactions(20);
+        controller.getTransactionsBetween(INT_MIN, INT_MAX);
+        controller.getPrescriptionsForPatient("patient 7", INT_MIN, INT_MAX);
+        controller.getEpidemicReport();
+        ++totals.reads;
+    }
+}
+
+int main(int argc, char** argv) {
+    FuzzOptions options = fuzzOptions(argc, argv, 300);
+
+    filesystem::path dir = filesystem::temp_directory_path() / ("ControllerStressTest-" + to_string(options.seed));
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    filesystem::current_path(dir);
+    {
+        ofstream out("drugs.txt");
+        out << "Hot drug,1.00," << hotStock << ",01/01/2031,10\n";
+        for (int i = 0; i < 200; ++i) out << "Drug " << i << ",3.00," << i % 60 << ",01/06/2030,20\n";
+    }
+
+    // The controller reports every sale and payment on the console, from
+    // every thread; stdout goes to /dev/null at the descriptor instead of
+    // swapping cout's buffer, which the threads would race on
+    fflush(stdout);
+    int console = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+
+    const long iterations = options.iterations;
+    Totals totals;
+    size_t transactions = 0;
+    int hotLeft = -1;
+    TransactionLedger::AuditResult audit;
+    bool compacted = false;
+    auto start = chrono::steady_clock::now();
+    {
+        HospitalController controller;
+        atomic<int> nextId(100000);
+        atomic<bool> done(false);
+        vector<thread> readers, writers;
+        for (int i = 0; i < 2; ++i) readers.emplace_back(reader, cref(controller), cref(done), ref(totals));
+        readers.emplace_back(payer, ref(controller), cref(done), ref(totals));
+        for (int i = 0; i < 3; ++i) writers.emplace_back(dispenser, ref(controller), ref(nextId), iterations, ref(totals));
+        for (int i = 0; i < 2; ++i) writers.emplace_back(stocker, ref(controller), options.seed + i, drugsPerStocker, ref(totals));
+        for (auto& t : writers) t.join();
+        done = true;
+        for (auto& t : readers) t.join();
+        // Nothing else writes snapshots before the controller shuts down
+        compacted = filesystem::exists("drugs.snap");
+
+        transactions = controller.getTransactionsBetween(INT_MIN, INT_MAX).size();
+        hotLeft = controller.findDrug("Hot drug")->quantity;
+        CHECK(controller.getDrugs().size() == 201 + (size_t)totals.drugsAdded);
+        CHECK(controller.getPendingPrescriptions().empty());
+        CHECK(controller.getDashboard(0).pendingPrescriptions == 0);
+        audit = controller.auditLedger();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    fflush(stdout);
+    dup2(console, 1);
+    close(console);
+
+    // Every prescription was dispensed exactly once and billed once
+    CHECK(hotLeft == hotStock - totals.prescriptions);
+    CHECK(transactions == (size_t)totals.prescriptions);
+    CHECK(audit.firstBadBatch == static_cast<size_t>(-1));
+    CHECK_MSG(compacted, "the log never reached its compaction limit");
+
+    // Everything must survive a restart too
+    {
+        streambuf* saved = cout.rdbuf(nullptr);
+        HospitalController controller;
+        cout.rdbuf(saved);
+        CHECK(controller.findDrug("Hot drug")->quantity == hotLeft);
+        CHECK(controller.getTransactionsBetween(INT_MIN, INT_MAX).size() == transactions);
+        CHECK(controller.getDrugs().size() == 201 + (size_t)totals.drugsAdded);
+    }
+
+    cout << totals.prescriptions << " prescriptions dispensed, " << totals.drugsAdded << " drugs added, "
+         << totals.payments << " payments, " << totals.reads << " read rounds in " << seconds << " s\n";
+
+    filesystem::current_path(filesystem::temp_directory_path());
+    filesystem::remove_all(dir);
+    return checkSummary("ControllerStressTest");
+}
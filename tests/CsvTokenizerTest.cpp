@@ -0,0 +1,130 @@
+#include "Check.h"
+#include "../CsvTokenizer.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// Rows written with appendCsvField come back field for field from
+// CsvTokenizer, whatever commas, quotes and line breaks they hold; any
+// input at all tokenizes without reading outside it; numbers survive
+// appendCsvFloat/parseCsvFloat exactly.
+//
+//   CsvTokenizerTest [seed] [iterations]
+
+typedef vector<vector<string>> Rows;
+
+static string randomField(mt19937& rng) {
+    static const char alphabet[] = "abcXYZ 019.,\"\n\r\t;";
+    // Long fields take the 16-byte scanning path as well as the tail
+    string field(rng() % (rng() % 4 ? 8 : 70), ' ');
+    for (char& c : field) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    return field;
+}
+
+static Rows randomRows(mt19937& rng) {
+    Rows rows(rng() % 20);
+    for (auto& row : rows) {
+        row.resize(1 + rng() % 8);
+        for (auto& field : row) field = randomField(rng);
+        // A lone empty field is a blank line, which carries no row
+        if (row.size() == 1 && row[0].empty()) row[0] = "x";
+    }
+    return rows;
+}
+
+static string format(const Rows& rows, bool crlf) {
+    string out;
+    for (const auto& row : rows) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (i > 0) out += ',';
+            appendCsvField(out, row[i]);
+        }
+        out += crlf ? "\r\n" : "\n";
+    }
+    return out;
+}
+
+static Rows tokenize(string_view text) {
+    Rows rows;
+    CsvTokenizer tokenizer(text);
+    vector<string_view> fields;
+    while (tokenizer.nextRow(fields)) {
+        rows.emplace_back(fields.begin(), fields.end());
+    }
+    return rows;
+}
+
+static void testFixedRows() {
+    CHECK(tokenize("a,b,c\n\n\r\n1,,3\r\n") == Rows({ { "a", "b", "c" }, { "1", "", "3" } }));
+    CHECK(tokenize("\"Paracetamol, 500mg\",2.5") == Rows({ { "Paracetamol, 500mg", "2.5" } }));
+    CHECK(tokenize("\"say \"\"hi\"\"\",\"two\nlines\"\n") == Rows({ { "say \"hi\"", "two\nlines" } }));
+    CHECK(tokenize("a,\n") == Rows({ { "a", "" } }));
+    CHECK(tokenize("").empty());
+
+    string out;
+    appendCsvField(out, "plain");
+    out += ',';
+    appendCsvField(out, "with,comma");
+    CHECK(out == "plain,\"with,comma\"");
+}
+
+static void testNumbers(mt19937& rng) {
+    int i = 0;
+    size_t s = 0;
+    float f = 0;
+    CHECK(parseCsvInt("-42", i) && i == -42);
+    CHECK(!parseCsvInt("", i) && !parseCsvInt("12x", i) && !parseCsvInt(" 1", i));
+    CHECK(!parseCsvInt("99999999999", i));
+    CHECK(parseCsvSize("18446744073709551615", s) && s == SIZE_MAX);
+    CHECK(!parseCsvSize("-1", s));
+    CHECK(parseCsvFloat("12.345", f) && f == 12.345f);
+    CHECK(!parseCsvFloat("1.5.2", f) && !parseCsvFloat("nanx", f));
+
+    for (int n = 0; n < 10000; ++n) {
+        uint32_t bits = (uint32_t)rng();
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        if (!isfinite(value)) continue;
+        string text;
+        appendCsvFloat(text, value);
+        float back = 0;
+        if (!CHECK_MSG(parseCsvFloat(text, back) && back == value, text)) return;
+    }
+}
+
+static void fuzz(const FuzzOptions& options) {
+    mt19937 rng(options.seed);
+    for (long i = 0; i < options.iterations; ++i) {
+        Rows rows = randomRows(rng);
+        string text = format(rows, rng() % 2);
+        if (!CHECK_MSG(tokenize(text) == rows, "iteration " + to_string(i) + ": " + text)) return;
+
+        // Garbled text has no expected rows, but must end and stay in bounds
+        for (int e = 0; e < 4 && !text.empty(); ++e) text[rng() % text.size()] = "\",\n\rq"[rng() % 5];
+        text.resize(rng() % (text.size() + 1));
+        CsvTokenizer tokenizer(text);
+        vector<string_view> fields;
+        size_t last = 0;
+        while (tokenizer.nextRow(fields)) {
+            CHECK(tokenizer.offset() > last && tokenizer.offset() <= text.size());
+            last = tokenizer.offset();
+            for (string_view field : fields) {
+                size_t touched = 0;
+                for (char c : field) touched += c == '"';
+                (void)touched;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    FuzzOptions options = fuzzOptions(argc, argv, 20000);
+    mt19937 rng(options.seed);
+
+    testFixedRows();
+    testNumbers(rng);
+    fuzz(options);
+    return checkSummary("CsvTokenizerTest");
+}
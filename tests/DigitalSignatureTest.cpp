@@ -0,0 +1,127 @@
+#include "Check.h"
+#include "../DigitalSignatureManager.h"
+#include "../OpenSslSignatureBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// DigitalSignatureManager on the OpenSSL backend, with a key made for the
+// run: signatures verify, any change to the data or the signature is
+// refused (also once the genuine pair is cached), and verifyBatch agrees
+// with one verifySignature call per item.
+//
+//   DigitalSignatureTest [seed] [iterations]
+//   DigitalSignatureTest --bench               signs/s and verifies/s
+
+static string keyPath() {
+    return (filesystem::temp_directory_path() / "DigitalSignatureTest.pem").string();
+}
+
+static string record(mt19937& rng) {
+    return "Patient " + to_string(rng() % 100000) + "Amoxicillin 500mg" + to_string(1 + rng() % 60) + "12/03/2026";
+}
+
+static void testRoundTrip(DigitalSignatureManager& manager, mt19937& rng, long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+        string data = record(rng);
+        string signature = manager.signData(data);
+        if (!CHECK(!signature.empty())) return;
+        CHECK(manager.verifySignature(data, signature));
+        // Twice, so the second check is answered from the cache
+        CHECK(manager.verifySignature(data, signature));
+
+        string changedData = data;
+        changedData[rng() % changedData.size()] ^= 1 + rng() % 127;
+        CHECK_MSG(!manager.verifySignature(changedData, signature), data);
+
+        // Change a character of the signature, away from the padding and
+        // the unused bits before it
+        string changedSignature = signature;
+        size_t at = rng() % (signature.size() - 4);
+        changedSignature[at] = changedSignature[at] == 'A' ? 'B' : 'A';
+        CHECK_MSG(!manager.verifySignature(data, changedSignature), signature);
+
+        // Another record's genuine signature
+        CHECK(!manager.verifySignature(data, manager.signData(data + " ")));
+    }
+    CHECK(!manager.verifySignature("x", ""));
+    CHECK(!manager.verifySignature("x", "not base64!"));
+}
+
+static void testBatch(DigitalSignatureManager& manager, mt19937& rng) {
+    // More than one task's worth, with every fourth item damaged
+    vector<pair<string, string>> items;
+    for (int i = 0; i < 300; ++i) {
+        string data = record(rng);
+        string signature = manager.signData(data);
+        if (i % 4 == 3) data += "!";
+        items.emplace_back(data, signature);
+    }
+    vector<bool> results = manager.verifyBatch(items);
+    if (!CHECK(results.size() == items.size())) return;
+    for (size_t i = 0; i < items.size(); ++i) {
+        CHECK_MSG(results[i] == (i % 4 != 3), "item " + to_string(i));
+        CHECK(results[i] == manager.verifySignature(items[i].first, items[i].second));
+    }
+    CHECK(manager.verifyBatch({}).empty());
+}
+
+// --- Benchmark ---
+
+template <typename F>
+static double perSecond(long count, F f) {
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < count; ++i) f(i);
+    return count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void bench(DigitalSignatureManager& manager) {
+    const long count = 20000;
+    mt19937 rng(1);
+    vector<string> data(count), signatures(count);
+    for (auto& d : data) d = record(rng);
+
+    double signs = perSecond(count, [&](long i) { signatures[i] = manager.signData(data[i]); });
+    manager.setCacheCapacity(0);
+    double uncached = perSecond(count, [&](long i) { manager.verifySignature(data[i], signatures[i]); });
+    manager.setCacheCapacity(count);
+    for (long i = 0; i < count; ++i) manager.verifySignature(data[i], signatures[i]);
+    double cached = perSecond(count, [&](long i) { manager.verifySignature(data[i], signatures[i]); });
+
+    manager.setCacheCapacity(0);
+    vector<pair<string, string>> items;
+    for (long i = 0; i < count; ++i) items.emplace_back(data[i], signatures[i]);
+    auto start = chrono::steady_clock::now();
+    vector<bool> results = manager.verifyBatch(items);
+    double batch = count / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bool allValid = find(results.begin(), results.end(), false) == results.end();
+
+    cout << thread::hardware_concurrency() << " hardware threads, " << count << " records\n"
+         << "sign:            " << (long)signs << "/s\n"
+         << "verify:          " << (long)uncached << "/s\n"
+         << "verify (cached): " << (long)cached << "/s\n"
+         << "verifyBatch:     " << (long)batch << "/s" << (allValid ? "" : " (some refused)") << "\n";
+}
+
+int main(int argc, char** argv) {
+    bool benchmark = argc > 1 && strcmp(argv[1], "--bench") == 0;
+    FuzzOptions options = benchmark ? FuzzOptions{ 0, 0 } : fuzzOptions(argc, argv, 500);
+    mt19937 rng(options.seed);
+
+    filesystem::remove(keyPath());
+    DigitalSignatureManager manager(make_unique<OpenSslSignatureBackend>(keyPath()));
+    if (!CHECK(manager.init())) return checkSummary("DigitalSignatureTest");
+    if (benchmark) {
+        bench(manager);
+    } else {
+        testRoundTrip(manager, rng, options.iterations);
+        testBatch(manager, rng);
+    }
+    filesystem::remove(keyPath());
+    return benchmark ? 0 : checkSummary("DigitalSignatureTest");
+}
@@ -0,0 +1,153 @@
+#include "Check.h"
+#include "../HospitalController.h"
+#include "../Utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+// HospitalController::getDrugPage checked against filtering and sorting a
+// copy of the whole inventory: walking every page of a query must give
+// exactly those drugs, in that order, before and after stock changes.
+// Runs in a fresh directory under the system temp directory, since the
+// controller keeps its files in the working directory.
+//
+//   DrugPageTest [seed] [iterations]
+
+static vector<Drug> expected(const vector<Drug>& all, const DrugQuery& q) {
+    string prefix = Utils::toLowerCase(q.namePrefix);
+    vector<size_t> rows;
+    for (size_t i = 0; i < all.size(); ++i) {
+        const Drug& d = all[i];
+        if (Utils::toLowerCase(d.name).compare(0, prefix.size(), prefix) != 0) continue;
+        if (q.lowStockOnly && !d.isLowStock()) continue;
+        if (q.expiringBefore != Date::invalid) {
+            int day = Date::parse(d.expiryDate);
+            if (day == Date::invalid || day >= q.expiringBefore) continue;
+        }
+        rows.push_back(i);
+    }
+    stable_sort(rows.begin(), rows.end(), [&](size_t a, size_t b) {
+        if (q.expiringBefore != Date::invalid) {
+            return Date::parse(all[a].expiryDate) < Date::parse(all[b].expiryDate);
+        }
+        return Utils::toLowerCase(all[a].name) < Utils::toLowerCase(all[b].name);
+    });
+    vector<Drug> out;
+    for (size_t i : rows) out.push_back(all[i]);
+    return out;
+}
+
+static bool sameDrugs(const vector<Drug>& a, const vector<Drug>& b) {
+    return equal(a.begin(), a.end(), b.begin(), b.end(), [](const Drug& x, const Drug& y) {
+        return x.name == y.name && x.quantity == y.quantity && x.expiryDate == y.expiryDate;
+    });
+}
+
+static string describe(const DrugQuery& q) {
+    return "prefix '" + q.namePrefix + "', low " + to_string(q.lowStockOnly) + ", before "
+         + to_string(q.expiringBefore) + ", limit " + to_string(q.limit);
+}
+
+static void checkQuery(const HospitalController& controller, const vector<Drug>& all, DrugQuery q) {
+    vector<Drug> want = expected(all, q);
+    vector<Drug> got;
+    DrugPage page;
+    size_t pages = 0;
+    do {
+        if (!CHECK_MSG(controller.getDrugPage(q, page), "cursor refused: " + describe(q))) return;
+        CHECK(page.drugs.size() <= q.limit);
+        // Only the last page may be short
+        CHECK(page.nextCursor.empty() || page.drugs.size() == q.limit);
+        got.insert(got.end(), page.drugs.begin(), page.drugs.end());
+        q.cursor = page.nextCursor;
+    } while (!q.cursor.empty() && ++pages <= all.size());
+    CHECK_MSG(sameDrugs(got, want), describe(q));
+}
+
+static void writeInventory(mt19937& rng, size_t count) {
+    static const char* names[] = { "Amoxicillin", "paracetamol", "Ibuprofen", "Metformin", "OMEPRAZOLE", "Salbutamol" };
+    ofstream out("drugs.txt");
+    char line[160];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(line, sizeof(line), "%s %umg batch %zu,%.2f,%u,%02u/%02u/20%02u,%u\n", names[rng() % 6],
+                 (unsigned)(rng() % 8 + 1) * 50, i, 1.5 + rng() % 400 * 0.25, (unsigned)(rng() % 60),
+                 (unsigned)(rng() % 28 + 1), (unsigned)(rng() % 12 + 1), (unsigned)(24 + rng() % 8),
+                 (unsigned)(rng() % 20));
+        out << line;
+    }
+    // Drugs without a usable expiry date never match expiringBefore
+    out << "Undated syrup,1.00,3,unknown,10\n";
+    out << "Undated drops,1.00,30,,10\n";
+}
+
+static DrugQuery randomQuery(mt19937& rng) {
+    static const char* prefixes[] = { "", "", "a", "PARA", "ibuprofen 1", "metformin 400mg", "zzz", "o" };
+    DrugQuery q;
+    q.namePrefix = prefixes[rng() % 8];
+    q.lowStockOnly = rng() % 2;
+    if (rng() % 2) {
+        char date[16];
+        snprintf(date, sizeof(date), "01/%02u/20%02u", (unsigned)(1 + rng() % 12), (unsigned)(24 + rng() % 9));
+        q.expiringBefore = Date::parse(date);
+    }
+    q.limit = 1 + rng() % (rng() % 2 ? 5 : 200);
+    return q;
+}
+
+int main(int argc, char** argv) {
+    FuzzOptions options = fuzzOptions(argc, argv, 200);
+    mt19937 rng(options.seed);
+
+    filesystem::path dir = filesystem::temp_directory_path() / ("DrugPageTest-" + to_string(options.seed));
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    filesystem::current_path(dir);
+    writeInventory(rng, 3000);
+
+    {
+        // The controller reports loading and every sale on the console
+        streambuf* console = cout.rdbuf(nullptr);
+        HospitalController controller;
+        cout.rdbuf(console);
+        vector<Drug> all = controller.getDrugs();
+        CHECK(all.size() == 3002);
+        for (long i = 0; i < options.iterations; ++i) checkQuery(controller, all, randomQuery(rng));
+
+        // Cursors that were not handed out, or belong to another ordering
+        DrugQuery q;
+        DrugPage page;
+        for (const char* cursor : { "x1", "n", "n-1", "n99999999", "e0x" }) {
+            q.cursor = cursor;
+            CHECK_MSG(!controller.getDrugPage(q, page), cursor);
+        }
+        q.cursor = "n1";
+        q.expiringBefore = Date::parse("01/01/2030");
+        CHECK(!controller.getDrugPage(q, page));
+
+        // Dispensing moves drugs into the low-stock index
+        auto lowStock = [](const vector<Drug>& drugs) {
+            return count_if(drugs.begin(), drugs.end(), [](const Drug& d) { return d.isLowStock(); });
+        };
+        long lowBefore = lowStock(all);
+        int id = 900000;
+        console = cout.rdbuf(nullptr);
+        for (size_t i = 0; i < all.size() && id < 900100; i += 7) {
+            const Drug& d = all[i];
+            if (d.isLowStock()) continue;
+            controller.createPrescription({ id, "Dr Test", "Patient", d.name, d.quantity - d.minThreshold,
+                                            "01/01/2026", "pending", "", "" });
+            controller.dispensePrescription(id++);
+        }
+        cout.rdbuf(console);
+        all = controller.getDrugs();
+        CHECK(lowStock(all) == lowBefore + 100);
+        for (long i = 0; i < options.iterations / 4; ++i) checkQuery(controller, all, randomQuery(rng));
+    }
+
+    filesystem::current_path(filesystem::temp_directory_path());
+    filesystem::remove_all(dir);
+    return checkSummary("DrugPageTest");
+}
@@ -0,0 +1,329 @@
+#include "Check.h"
+#include "../HttpRequestParser.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// HttpRequestParser driven the way SimpleWebServer::processRequests drives
+// it: bytes arrive in reads of any size, each complete request is consumed
+// from the front of the buffer and the parser is reset for the next one.
+//
+//   HttpRequestParserTest [seed] [iterations]   fixed cases, then fuzzing
+//   HttpRequestParserTest --bench               parse throughput
+
+// What the server would see for one request, copied out of the views
+struct Outcome {
+    int error = 0;      // errorStatus() when parsing failed
+    string method, target, path, query, version, body;
+    vector<pair<string, string>> headers;
+    bool keepAlive = false;
+    bool expectContinue = false;
+
+    bool operator==(const Outcome& o) const {
+        return error == o.error && method == o.method && target == o.target && path == o.path
+            && query == o.query && version == o.version && body == o.body && headers == o.headers
+            && keepAlive == o.keepAlive && expectContinue == o.expectContinue;
+    }
+};
+
+struct Run {
+    vector<Outcome> requests;   // complete requests, then the error if any
+    bool incomplete = false;    // bytes left over waiting for more input
+    bool operator==(const Run& o) const { return requests == o.requests && incomplete == o.incomplete; }
+};
+
+static const size_t testHeaderBytes = 512;
+static const size_t testBodyBytes = 4096;
+static const size_t testHeaderCount = 8;
+
+// Feeds input in reads ending at the given offsets (plus one final read)
+static Run feed(const string& input, const vector<size_t>& cuts) {
+    HttpRequestParser parser(testHeaderBytes, testBodyBytes, testHeaderCount);
+    Run run;
+    string buffer;
+    size_t consumed = 0;
+    size_t next = 0;
+    vector<size_t> ends = cuts;
+    ends.push_back(input.size());
+
+    for (size_t end : ends) {
+        if (end < next) continue;
+        buffer.append(input, next, end - next);
+        next = end;
+        while (true) {
+            auto status = parser.parse(buffer.data() + consumed, buffer.size() - consumed);
+            if (status == HttpRequestParser::Status::Incomplete) break;
+
+            Outcome o;
+            o.expectContinue = parser.expectsContinue();
+            if (status == HttpRequestParser::Status::Error) {
+                o.error = parser.errorStatus();
+                CHECK(o.error == 400 || o.error == 413 || o.error == 431 || o.error == 501);
+                run.requests.push_back(o);
+                return run;
+            }
+
+            const HttpRequest& r = parser.request();
+            CHECK(parser.consumed() > 0 && parser.consumed() <= buffer.size() - consumed);
+            o.method = string(r.method);
+            o.target = string(r.target);
+            o.path = string(r.path);
+            o.query = string(r.query);
+            o.version = string(r.version);
+            o.body = string(r.body);
+            for (const auto& h : r.headers) o.headers.emplace_back(string(h.name), string(h.value));
+            o.keepAlive = r.keepAlive();
+            CHECK(o.body.size() <= testBodyBytes);
+            CHECK(o.headers.size() <= testHeaderCount);
+            run.requests.push_back(o);
+
+            consumed += parser.consumed();
+            parser.reset();
+        }
+    }
+    // Only blank lines may be left once the last request is complete
+    run.incomplete = buffer.find_first_not_of("\r\n", consumed) != string::npos;
+    return run;
+}
+
+static Run feedWhole(const string& input) {
+    return feed(input, {});
+}
+
+static Run feedBytewise(const string& input) {
+    vector<size_t> cuts;
+    for (size_t i = 1; i < input.size(); ++i) cuts.push_back(i);
+    return feed(input, cuts);
+}
+
+static Run feedRandomly(const string& input, mt19937& rng) {
+    vector<size_t> cuts;
+    size_t at = 0;
+    while (at < input.size()) {
+        at += 1 + rng() % (rng() % 2 ? 8 : 200);
+        cuts.push_back(at);
+    }
+    return feed(input, cuts);
+}
+
+// --- Fixed cases ---
+
+static void testSimpleGet() {
+    Run run = feedWhole("GET /api/drugs?limit=5 HTTP/1.1\r\nHost: x\r\n\r\n");
+    CHECK(!run.incomplete && run.requests.size() == 1);
+    if (run.requests.size() != 1) return;
+    const Outcome& o = run.requests[0];
+    CHECK(o.error == 0);
+    CHECK(o.method == "GET" && o.path == "/api/drugs" && o.query == "limit=5");
+    CHECK(o.headers.size() == 1 && o.headers[0].first == "Host" && o.headers[0].second == "x");
+    CHECK(o.keepAlive && o.body.empty());
+}
+
+static void testKeepAlive() {
+    CHECK(feedWhole("GET / HTTP/1.0\r\n\r\n").requests[0].keepAlive == false);
+    CHECK(feedWhole("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n").requests[0].keepAlive);
+    CHECK(feedWhole("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n").requests[0].keepAlive == false);
+}
+
+static void testContentLength() {
+    Run run = feedWhole("POST /api/login HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world");
+    CHECK(run.requests.size() == 1 && run.requests[0].body == "hello world");
+
+    // The body is not complete until every byte has arrived
+    run = feedWhole("POST / HTTP/1.1\r\nContent-Length: 12\r\n\r\nhello world");
+    CHECK(run.requests.empty() && run.incomplete);
+
+    CHECK(feedWhole("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n").requests[0].error == 400);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 3\r\n\r\nabc").requests[0].error == 400);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nContent-Length: 4097\r\n\r\n").requests[0].error == 413);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n").requests[0].error == 413);
+}
+
+static void testChunked() {
+    Run run = feedWhole("POST /x HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                        "5;ext=1\r\nhello\r\n1\r\n \r\nA\r\n0123456789\r\n0\r\nTrailer: yes\r\n\r\n");
+    CHECK(run.requests.size() == 1 && run.requests[0].body == "hello 0123456789");
+
+    // Bare LF line endings are tolerated throughout
+    run = feedWhole("POST /x HTTP/1.1\nTransfer-Encoding: chunked\n\n3\nabc\n0\n\n");
+    CHECK(run.requests.size() == 1 && run.requests[0].body == "abc");
+
+    CHECK(feedWhole("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n").requests[0].error == 501);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\n").requests[0].error == 400);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n").requests[0].error == 400);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1001\r\n").requests[0].error == 413);
+    CHECK(feedWhole("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nFFFFFFFFFFFFFFFFFFFF\r\n").requests[0].error == 413);
+
+    // A size line is limited however it arrives
+    string longExtension = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1;" + string(1100, 'e') + "\r\na\r\n0\r\n\r\n";
+    CHECK(feedWhole(longExtension).requests[0].error == 400);
+    CHECK(feedBytewise(longExtension).requests[0].error == 400);
+}
+
+static void testBothFramingsRefused() {
+    Run run = feedWhole("POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n"
+                        "0\r\n\r\nGET /smuggled HTTP/1.1\r\n\r\n");
+    CHECK(run.requests.size() == 1 && run.requests[0].error == 400);
+}
+
+static void testLimits() {
+    string manyHeaders = "GET / HTTP/1.1\r\n";
+    for (size_t i = 0; i <= testHeaderCount; ++i) manyHeaders += "H" + to_string(i) + ": v\r\n";
+    CHECK(feedWhole(manyHeaders + "\r\n").requests[0].error == 431);
+
+    string longHeader = "GET / HTTP/1.1\r\nX: " + string(testHeaderBytes, 'v') + "\r\n\r\n";
+    CHECK(feedWhole(longHeader).requests[0].error == 431);
+    CHECK(feedBytewise(longHeader).requests[0].error == 431);
+
+    // Endless header bytes without a line break are refused before they end
+    string unterminated = "GET / HTTP/1.1\r\nX: " + string(testHeaderBytes * 4, 'v');
+    CHECK(feedWhole(unterminated).requests.size() == 1 && feedWhole(unterminated).requests[0].error == 431);
+}
+
+static void testMalformedRequestLines() {
+    for (const char* bad : { "GET\r\n\r\n", " / HTTP/1.1\r\n\r\n", "GET  HTTP/1.1\r\n\r\n",
+                             "GET / HTTP/2.0\r\n\r\n", "G(T / HTTP/1.1\r\n\r\n",
+                             "GET / HTTP/1.1\r\nNoColon\r\n\r\n", "GET / HTTP/1.1\r\n: v\r\n\r\n",
+                             "GET / HTTP/1.1\r\nBad Name: v\r\n\r\n" }) {
+        Run run = feedWhole(bad);
+        CHECK_MSG(run.requests.size() == 1 && run.requests[0].error == 400, bad);
+    }
+}
+
+static void testPipelining() {
+    string input = "\r\nGET /a HTTP/1.1\r\n\r\n"
+                   "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz"
+                   "POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nok\r\n0\r\n\r\n\r\n"
+                   "GET /d HTTP/1.1\r\n";
+    Run run = feedWhole(input);
+    CHECK(run.requests.size() == 3 && run.incomplete);
+    if (run.requests.size() != 3) return;
+    CHECK(run.requests[0].path == "/a");
+    CHECK(run.requests[1].path == "/b" && run.requests[1].body == "xyz");
+    CHECK(run.requests[2].path == "/c" && run.requests[2].body == "ok");
+}
+
+static void testExpectContinue() {
+    HttpRequestParser parser;
+    string head = "POST / HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 2\r\n\r\n";
+    CHECK(parser.parse(head.data(), head.size()) == HttpRequestParser::Status::Incomplete);
+    CHECK(parser.expectsContinue());
+    string all = head + "ok";
+    CHECK(parser.parse(all.data(), all.size()) == HttpRequestParser::Status::Complete);
+    CHECK(parser.request().body == "ok");
+}
+
+// --- Split-point invariance and fuzzing ---
+
+static const vector<string>& seedRequests() {
+    static const vector<string> seeds = {
+        "GET /api/drugs?limit=5&cursor=abc HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n\r\n",
+        "POST /api/login HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: 37\r\n\r\n"
+        "{\"username\":\"admin\",\"password\":\"x\"}\r\n",
+        "POST /api/prescriptions HTTP/1.1\r\nTransfer-Encoding: chunked\r\nExpect: 100-continue\r\n\r\n"
+        "4\r\nabcd\r\n3;x=y\r\nefg\r\n0\r\nT: 1\r\n\r\n",
+        "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\nGET /index.html HTTP/1.1\r\nConnection: close\r\n\r\n",
+        "\r\n\r\nGET /a HTTP/1.1\n\nPOST /b HTTP/1.1\nContent-Length: 1\n\nzGET /c HTTP/1.1\r\n\r\n",
+    };
+    return seeds;
+}
+
+static void testEverySplitPoint() {
+    for (const string& input : seedRequests()) {
+        Run whole = feedWhole(input);
+        CHECK_MSG(!whole.requests.empty() && whole.requests.back().error == 0, input);
+        CHECK_MSG(feedBytewise(input) == whole, input);
+        for (size_t a = 1; a < input.size(); ++a) {
+            CHECK_MSG(feed(input, { a }) == whole, "cut at " + to_string(a) + " in " + input);
+        }
+    }
+}
+
+static string mutate(string s, mt19937& rng) {
+    static const char interesting[] = "\r\n:; \t0123456789abcdefABCDEF-Content-Length: Transfer-Encoding: chunked\r\n";
+    int edits = 1 + rng() % 6;
+    for (int e = 0; e < edits; ++e) {
+        size_t at = s.empty() ? 0 : rng() % s.size();
+        switch (rng() % 6) {
+            case 0: if (!s.empty()) s[at] = (char)(rng() % 256); break;
+            case 1: if (!s.empty()) s.erase(at, 1 + rng() % 8); break;
+            case 2: s.insert(at, 1, interesting[rng() % (sizeof(interesting) - 1)]); break;
+            case 3: s.insert(at, string(1 + rng() % 600, "x\r\n0"[rng() % 4])); break;
+            case 4: {
+                const string& other = seedRequests()[rng() % seedRequests().size()];
+                size_t from = rng() % other.size();
+                s.insert(at, other, from, rng() % (other.size() - from + 1));
+                break;
+            }
+            case 5: s.resize(at); break;
+        }
+    }
+    return s;
+}
+
+// However a (possibly garbled) stream is cut into reads, the parser must
+// reach the same requests and the same error
+static void fuzz(const FuzzOptions& options) {
+    mt19937 rng(options.seed);
+    const vector<string>& seeds = seedRequests();
+    for (long i = 0; i < options.iterations; ++i) {
+        string input = seeds[rng() % seeds.size()];
+        if (rng() % 4) input += seeds[rng() % seeds.size()];
+        input = mutate(input, rng);
+
+        Run whole = feedWhole(input);
+        Run pieces = feedRandomly(input, rng);
+        if (!CHECK_MSG(pieces == whole, "iteration " + to_string(i))) {
+            cerr << "input: " << input.size() << " bytes\n" << input << "\n";
+            return;
+        }
+    }
+}
+
+// --- Benchmark ---
+
+static void bench() {
+    const string get = "GET /api/drugs?limit=50 HTTP/1.1\r\nHost: localhost:8080\r\nUser-Agent: bench\r\n"
+                       "Accept: */*\r\nAccept-Encoding: gzip, deflate\r\nConnection: keep-alive\r\n\r\n";
+    const string post = "POST /api/prescriptions HTTP/1.1\r\nHost: localhost:8080\r\nContent-Type: application/json\r\n"
+                        "Content-Length: 256\r\n\r\n" + string(256, 'p');
+    for (const auto& c : { make_pair("GET", get), make_pair("POST 256 B", post) }) {
+        string stream;
+        while (stream.size() < (32u << 20)) stream += c.second;
+
+        HttpRequestParser parser;
+        size_t requests = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t at = 0; at < stream.size(); ++requests) {
+            parser.parse(stream.data() + at, stream.size() - at);
+            at += parser.consumed();
+            parser.reset();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << c.first << ": " << (size_t)(requests / seconds) << " requests/s, "
+             << (size_t)(stream.size() / seconds / 1e6) << " MB/s\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+    FuzzOptions options = fuzzOptions(argc, argv, 20000);
+
+    testSimpleGet();
+    testKeepAlive();
+    testContentLength();
+    testChunked();
+    testBothFramingsRefused();
+    testLimits();
+    testMalformedRequestLines();
+    testPipelining();
+    testExpectContinue();
+    testEverySplitPoint();
+    fuzz(options);
+    return checkSummary("HttpRequestParserTest");
+}
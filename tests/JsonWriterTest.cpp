@@ -0,0 +1,282 @@
+#include "Check.h"
+#include "../JsonWriter.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+// JsonWriter output read back by a small strict parser: random documents
+// must come back value for value, every string byte must survive escaping,
+// and floats must round-trip through their shortest form.
+//
+//   JsonWriterTest [seed] [iterations]
+//   JsonWriterTest --bench               100,000 drugs, against concatenation
+
+// A parsed value, printed back in one canonical form for comparison
+struct Parser {
+    string_view in;
+    size_t pos = 0;
+    bool ok = true;
+
+    bool fail() { ok = false; return false; }
+    bool eat(char c) { return pos < in.size() && in[pos] == c ? (++pos, true) : false; }
+
+    bool string(std::string& out) {
+        if (!eat('"')) return fail();
+        while (pos < in.size() && in[pos] != '"') {
+            unsigned char c = in[pos++];
+            if (c < 0x20) return fail();
+            if (c != '\\') { out += (char)c; continue; }
+            if (pos >= in.size()) return fail();
+            char e = in[pos++];
+            const char* simple = strchr("\"\\/bfnrt", e);
+            if (simple && e) {
+                out += "\"\\/\b\f\n\r\t"[simple - "\"\\/bfnrt"];
+            } else if (e == 'u' && pos + 4 <= in.size()) {
+                unsigned code = stoul(std::string(in.substr(pos, 4)), nullptr, 16);
+                if (code > 0xFF) return fail();   // the writer only escapes control bytes
+                out += (char)code;
+                pos += 4;
+            } else {
+                return fail();
+            }
+        }
+        return eat('"') || fail();
+    }
+
+    // Values come back as tagged text: s"...", n<number>, b1/b0, z for null
+    bool value(std::string& out) {
+        if (pos >= in.size()) return fail();
+        char c = in[pos];
+        if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            ++pos;
+            out += c;
+            if (eat(close)) { out += close; return true; }
+            do {
+                if (c == '{') {
+                    std::string key;
+                    if (!string(key) || !eat(':')) return fail();
+                    out += "k" + key + "=";
+                }
+                if (!value(out)) return false;
+                out += ';';
+            } while (eat(','));
+            if (!eat(close)) return fail();
+            out += close;
+            return true;
+        }
+        if (c == '"') {
+            std::string s;
+            if (!string(s)) return false;
+            out += "s" + s + "|";
+            return true;
+        }
+        for (const char* word : { "true", "false", "null" }) {
+            if (in.substr(pos, strlen(word)) == word) {
+                pos += strlen(word);
+                out += word[0] == 't' ? "b1" : word[0] == 'f' ? "b0" : "z";
+                return true;
+            }
+        }
+        size_t start = pos;
+        while (pos < in.size() && strchr("-+.eE0123456789", in[pos])) ++pos;
+        if (pos == start) return fail();
+        out += "n" + std::string(in.substr(start, pos - start));
+        return true;
+    }
+};
+
+static bool parse(string_view json, string& canonical) {
+    Parser p{ json };
+    return p.value(canonical) && p.pos == json.size();
+}
+
+static string randomText(mt19937& rng) {
+    string s(rng() % 12, ' ');
+    for (char& c : s) c = rng() % 3 ? "ab\"\\ /\n\t"[rng() % 9] : (char)rng();
+    return s;
+}
+
+// Writes a random value to json and its canonical form to expected
+static void randomValue(mt19937& rng, JsonWriter& json, string& expected, int depth) {
+    int kind = rng() % (depth < 4 ? 7 : 5);
+    switch (kind) {
+        case 0: {
+            string s = randomText(rng);
+            json.value(s);
+            expected += "s" + s + "|";
+            break;
+        }
+        case 1: {
+            long long v = (long long)((uint64_t)rng() << 32 | rng());
+            json.value(v);
+            expected += "n" + to_string(v);
+            break;
+        }
+        case 2: {
+            bool b = rng() % 2;
+            json.value(b);
+            expected += b ? "b1" : "b0";
+            break;
+        }
+        case 3:
+            json.null();
+            expected += "z";
+            break;
+        case 4: {
+            // Checked for round-tripping separately; here just the shape
+            int v = rng() % 1000;
+            json.value(v);
+            expected += "n" + to_string(v);
+            break;
+        }
+        case 5: {
+            json.beginArray();
+            expected += '[';
+            for (int n = rng() % 4; n > 0; --n) {
+                randomValue(rng, json, expected, depth + 1);
+                expected += ';';
+            }
+            json.endArray();
+            expected += ']';
+            break;
+        }
+        case 6: {
+            json.beginObject();
+            expected += '{';
+            for (int n = rng() % 4; n > 0; --n) {
+                string key = randomText(rng);
+                json.key(key);
+                expected += "k" + key + "=";
+                randomValue(rng, json, expected, depth + 1);
+                expected += ';';
+            }
+            json.endObject();
+            expected += '}';
+            break;
+        }
+    }
+}
+
+static void testEveryByte() {
+    string all;
+    for (int c = 1; c < 256; ++c) all += (char)c;
+    all += '\0';
+    string out, canonical;
+    JsonWriter(out).value(all);
+    CHECK(parse(out, canonical) && canonical == "s" + all + "|");
+    for (unsigned char c : out) CHECK(c >= 0x20);
+}
+
+static void testNumbers(mt19937& rng) {
+    string out;
+    JsonWriter(out).beginArray().value(12.3f).value(0.1).value(-0.0f).value(numeric_limits<int>::min())
+                   .value(numeric_limits<unsigned long long>::max()).endArray();
+    CHECK_MSG(out == "[12.3,0.1,-0,-2147483648,18446744073709551615]", out);
+
+    out.clear();
+    JsonWriter(out).beginArray().value(NAN).value(INFINITY).value(-numeric_limits<double>::infinity()).endArray();
+    CHECK_MSG(out == "[null,null,null]", out);
+
+    for (int i = 0; i < 10000; ++i) {
+        uint32_t fbits = rng();
+        float f;
+        memcpy(&f, &fbits, sizeof(f));
+        uint64_t dbits = (uint64_t)rng() << 32 | rng();
+        double d;
+        memcpy(&d, &dbits, sizeof(d));
+        if (!isfinite(f) || !isfinite(d)) continue;
+        out.clear();
+        JsonWriter(out).value(f);
+        CHECK_MSG(strtof(out.c_str(), nullptr) == f, out);
+        out.clear();
+        JsonWriter(out).value(d);
+        CHECK_MSG(strtod(out.c_str(), nullptr) == d, out);
+    }
+}
+
+static void fuzz(const FuzzOptions& options) {
+    mt19937 rng(options.seed);
+    for (long i = 0; i < options.iterations; ++i) {
+        // Appends after what is already in the buffer, as the server does
+        string out = "HTTP/1.1 200 OK\r\n\r\n", expected, canonical;
+        size_t prefix = out.size();
+        JsonWriter json(out);
+        randomValue(rng, json, expected, 0);
+        if (!CHECK_MSG(parse(string_view(out).substr(prefix), canonical) && canonical == expected,
+                       "iteration " + to_string(i) + ": " + out.substr(prefix))) return;
+    }
+}
+
+// --- Benchmark ---
+
+struct BenchDrug {
+    string name;
+    int quantity;
+    float price;
+    string expiry;
+};
+
+// How the handlers built /api/drugs before JsonWriter
+static string concatenated(const vector<BenchDrug>& drugs) {
+    string json = "[";
+    for (size_t i = 0; i < drugs.size(); ++i) {
+        const BenchDrug& d = drugs[i];
+        json += "{\"name\":\"" + d.name + "\",\"quantity\":" + to_string(d.quantity) + ",\"price\":"
+              + to_string(d.price) + ",\"expiry\":\"" + d.expiry + "\"}";
+        if (i + 1 < drugs.size()) json += ",";
+    }
+    return json + "]";
+}
+
+static void written(const vector<BenchDrug>& drugs, string& out) {
+    out.clear();
+    JsonWriter json(out);
+    json.beginArray();
+    for (const auto& d : drugs) {
+        json.beginObject().field("name", d.name).field("quantity", d.quantity).field("price", d.price)
+            .field("expiry", d.expiry).endObject();
+    }
+    json.endArray();
+}
+
+static void bench() {
+    mt19937 rng(1);
+    vector<BenchDrug> drugs(100000);
+    for (size_t i = 0; i < drugs.size(); ++i) {
+        drugs[i] = { "Amoxicillin " + to_string(250 + i % 4 * 250) + "mg batch " + to_string(i), (int)(rng() % 5000),
+                     (float)(rng() % 100000) / 100, "01/06/2027" };
+    }
+    const int rounds = 20;
+    string out, old;
+    auto timed = [&](auto f) {
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) f();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / rounds;
+    };
+    double oldMs = timed([&] { old = concatenated(drugs); });
+    written(drugs, out);   // the buffer is reused from here on, as per connection
+    double newMs = timed([&] { written(drugs, out); });
+    string canonical;
+    cout << drugs.size() << " drugs, " << out.size() / 1024 << " kB: JsonWriter " << newMs << " ms ("
+         << (long)(out.size() / newMs / 1e3) << " MB/s), concatenation " << oldMs << " ms ("
+         << (long)(old.size() / oldMs / 1e3) << " MB/s)" << (parse(out, canonical) ? "" : " (output invalid)") << "\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+    FuzzOptions options = fuzzOptions(argc, argv, 20000);
+    mt19937 rng(options.seed);
+
+    testEveryByte();
+    testNumbers(rng);
+    fuzz(options);
+    return checkSummary("JsonWriterTest");
+}
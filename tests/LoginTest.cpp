@@ -0,0 +1,298 @@
+#include "Check.h"
+#include "../HospitalController.h"
+#include "../SimpleWebServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// POST /api/login through a running server with a single I/O worker: the
+// password check runs on a hashing worker and its answer comes back on the
+// right connection, in order with pipelined requests, also when the hashing
+// service is busy or the client has gone. Runs in a fresh directory under
+// the system temp directory, with the default admin account.
+//
+//   LoginTest
+//   LoginTest --bench   logins/s and p99, and dashboard p99 under login load
+
+static int port;
+
+static const string adminLogin = "{\"username\": \"admin\", \"password\": \"admin123\"}";
+
+// A blocking client that reads one response at a time off its connection
+struct Client {
+    int fd = -1;
+    string pending;
+
+    bool open() {
+        // The server may still be starting up
+        for (int attempt = 0; attempt < 500; ++attempt) {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return true;
+            ::close(fd);
+            fd = -1;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    bool send(const string& data) {
+        return ::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size();
+    }
+
+    // The body of the next response; false if the connection ends first
+    bool response(string& body) {
+        size_t end;
+        while ((end = pending.find("\r\n\r\n")) == string::npos) {
+            if (!fill()) return false;
+        }
+        size_t length = 0;
+        size_t at = pending.find("Content-Length: ");
+        if (at != string::npos && at < end) length = strtoul(pending.c_str() + at + 16, nullptr, 10);
+        while (pending.size() < end + 4 + length) {
+            if (!fill()) return false;
+        }
+        body = pending.substr(end + 4, length);
+        pending.erase(0, end + 4 + length);
+        return true;
+    }
+
+    // Whether the server closes the connection without sending more
+    bool closedByServer() {
+        return pending.empty() && !fill();
+    }
+
+    bool fill() {
+        char buffer[4096];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        pending.append(buffer, n);
+        return true;
+    }
+};
+
+static string loginRequest(const string& body, const char* extraHeaders = "") {
+    return "POST /api/login HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\n" + string(extraHeaders)
+         + "Content-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static string dashboardRequest(const string& token) {
+    return "GET /api/dashboard HTTP/1.1\r\nHost: localhost\r\nAuthorization: Bearer " + token + "\r\n\r\n";
+}
+
+static string tokenOf(const string& body) {
+    size_t at = body.find("\"token\":\"");
+    if (at == string::npos) return "";
+    at += 9;
+    return body.substr(at, body.find('"', at) - at);
+}
+
+static bool succeeded(const string& body) {
+    return body.find("\"success\":true") != string::npos && !tokenOf(body).empty();
+}
+
+static void testCredentials() {
+    Client client;
+    if (!CHECK(client.open())) return;
+    string body;
+    CHECK(client.send(loginRequest(adminLogin)) && client.response(body));
+    CHECK_MSG(succeeded(body), body);
+    CHECK(client.send(loginRequest("{\"username\": \"admin\", \"password\": \"wrong\"}")) && client.response(body));
+    CHECK_MSG(body == "{\"success\":false}", body);
+    CHECK(client.send(loginRequest("{\"username\": \"nobody\", \"password\": \"admin123\"}")) && client.response(body));
+    CHECK_MSG(body == "{\"success\":false}", body);
+    client.close();
+}
+
+// Requests sent behind a login wait for its answer and come back in order
+static void testPipelined() {
+    Client client;
+    if (!CHECK(client.open())) return;
+    string first;
+    CHECK(client.send(loginRequest(adminLogin)) && client.response(first));
+    string token = tokenOf(first);
+
+    CHECK(client.send(loginRequest(adminLogin) + dashboardRequest(token)
+                      + loginRequest("{\"username\": \"admin\", \"password\": \"wrong\"}") + dashboardRequest(token)
+                      + loginRequest(adminLogin, "Connection: close\r\n")));
+    string body;
+    CHECK(client.response(body) && succeeded(body));
+    CHECK_MSG(client.response(body) && body.find("\"revenue\"") != string::npos, body);
+    CHECK(client.response(body) && body == "{\"success\":false}");
+    CHECK_MSG(client.response(body) && body.find("\"revenue\"") != string::npos, body);
+    CHECK(client.response(body) && succeeded(body));
+    CHECK(client.closedByServer());
+    client.close();
+}
+
+static void testBusy(HospitalController& controller) {
+    PasswordHasher::Config config;
+    config.maxQueued = 0;
+    controller.setPasswordHashing(config);
+    Client client;
+    if (CHECK(client.open())) {
+        string body;
+        CHECK(client.send(loginRequest(adminLogin)) && client.response(body));
+        CHECK_MSG(body.find("Server busy") != string::npos, body);
+        client.close();
+    }
+    controller.setPasswordHashing(PasswordHasher::Config());
+}
+
+// Clients that leave before their answer is ready must not take the server
+// down or get in the way of the next one
+static void testAbandoned() {
+    for (int i = 0; i < 20; ++i) {
+        Client client;
+        if (!CHECK(client.open())) return;
+        client.send(loginRequest(adminLogin));
+        if (i % 2) shutdown(client.fd, SHUT_WR);
+        client.close();
+    }
+    Client client;
+    string body;
+    CHECK(client.open() && client.send(loginRequest(adminLogin)) && client.response(body) && succeeded(body));
+    client.close();
+}
+
+// --- Benchmark ---
+
+static double percentile(vector<double> ms, double p) {
+    if (ms.empty()) return 0;
+    sort(ms.begin(), ms.end());
+    return ms[min(ms.size() - 1, (size_t)(p * ms.size()))];
+}
+
+// Dashboard round trips on one connection until done is set
+static vector<double> dashboardLatencies(const string& token, const atomic<bool>& done) {
+    vector<double> ms;
+    Client client;
+    if (!client.open()) return ms;
+    string body;
+    while (!done) {
+        auto start = chrono::steady_clock::now();
+        if (!client.send(dashboardRequest(token)) || !client.response(body)) break;
+        ms.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    client.close();
+    return ms;
+}
+
+// The report is printed once the server, which logs every request, is gone
+static string bench() {
+    Client first;
+    string body;
+    if (!first.open() || !first.send(loginRequest(adminLogin)) || !first.response(body)) return "server not reached\n";
+    string token = tokenOf(body);
+    first.close();
+
+    atomic<bool> done(false);
+    vector<double> idle;
+    thread idleProbe([&] { idle = dashboardLatencies(token, done); });
+    this_thread::sleep_for(chrono::milliseconds(500));
+    done = true;
+    idleProbe.join();
+
+    // Each client waits for its answer before the next login, so the
+    // hashing queue holds at most one login per client
+    const int clients = 8, perClient = 40;
+    vector<vector<double>> logins(clients);
+    atomic<int> failed(0);
+    done = false;
+    vector<double> loaded;
+    thread loadedProbe([&] { loaded = dashboardLatencies(token, done); });
+    auto start = chrono::steady_clock::now();
+    vector<thread> running;
+    for (int c = 0; c < clients; ++c) {
+        running.emplace_back([&, c] {
+            Client client;
+            if (!client.open()) return;
+            string answer;
+            for (int i = 0; i < perClient; ++i) {
+                auto sent = chrono::steady_clock::now();
+                if (!client.send(loginRequest(adminLogin)) || !client.response(answer)) break;
+                logins[c].push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - sent).count());
+                if (!succeeded(answer)) ++failed;
+            }
+            client.close();
+        });
+    }
+    for (auto& t : running) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    done = true;
+    loadedProbe.join();
+
+    vector<double> all;
+    for (auto& l : logins) all.insert(all.end(), l.begin(), l.end());
+    ostringstream report;
+    report << thread::hardware_concurrency() << " hardware threads, 1 I/O worker, " << clients << " clients\n"
+         << "logins:    " << (long)(all.size() / seconds) << "/s, p50 " << percentile(all, 0.5) << " ms, p99 "
+         << percentile(all, 0.99) << " ms" << (failed ? " (" + to_string(failed) + " refused)" : "") << "\n"
+         << "dashboard: p99 " << percentile(idle, 0.99) << " ms idle, " << percentile(loaded, 0.99)
+         << " ms during the logins (" << loaded.size() << " requests)\n";
+    return report.str();
+}
+
+int main(int argc, char** argv) {
+    bool benchmark = argc > 1 && strcmp(argv[1], "--bench") == 0;
+    port = 20000 + getpid() % 20000;
+
+    filesystem::path dir = filesystem::temp_directory_path() / ("LoginTest-" + to_string(getpid()));
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    filesystem::current_path(dir);
+
+    // The server logs every request on the console; stdout goes to
+    // /dev/null at the descriptor while it runs
+    fflush(stdout);
+    int console = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    string report;
+    {
+        HospitalController controller;
+        SimpleWebServer server(&controller, port, 1);
+        thread serving([&] { server.start(); });
+        if (benchmark) {
+            report = bench();
+        } else {
+            testCredentials();
+            testPipelined();
+            testBusy(controller);
+            testAbandoned();
+        }
+        server.stop();
+        serving.join();
+    }
+
+    cout.flush();
+    fflush(stdout);
+    dup2(console, 1);
+    close(console);
+    cout << report;
+
+    filesystem::current_path(filesystem::temp_directory_path());
+    filesystem::remove_all(dir);
+    return benchmark ? 0 : checkSummary("LoginTest");
+}
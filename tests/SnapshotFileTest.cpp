@@ -0,0 +1,264 @@
+#include "Check.h"
+#include "../SnapshotFile.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+// SnapshotWriter/SnapshotReader round trips, and SnapshotReader fed damaged
+// files: open() must refuse them or hand out only values inside the file.
+//
+//   SnapshotFileTest [seed] [iterations]   fixed cases, then fuzzing
+//   SnapshotFileTest --bench               open, scan and load times
+
+static const vector<ColumnKind> layout = { ColumnKind::Int32, ColumnKind::String, ColumnKind::Float32, ColumnKind::String };
+
+struct Row {
+    int32_t id;
+    string name;
+    float price;
+    string note;
+};
+
+static string testPath() {
+    return (filesystem::temp_directory_path() / "SnapshotFileTest.snap").string();
+}
+
+static void writeFile(const string& path, const string& bytes) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+// The reader explains each file it refuses on cerr; only failed checks
+// should reach the output here
+static bool openQuietly(SnapshotReader& reader, char type, const vector<ColumnKind>& kinds) {
+    streambuf* saved = cerr.rdbuf(nullptr);
+    bool ok = reader.open(testPath(), type, kinds);
+    cerr.rdbuf(saved);
+    return ok;
+}
+
+static string encodeRows(const vector<Row>& rows) {
+    SnapshotWriter writer('D', layout, rows.size());
+    for (const Row& r : rows) {
+        writer.addInt(0, r.id);
+        writer.addString(1, r.name);
+        writer.addFloat(2, r.price);
+        writer.addString(3, r.note);
+        writer.endRow();
+    }
+    return writer.encode();
+}
+
+static vector<Row> randomRows(mt19937& rng) {
+    vector<Row> rows(rng() % 50);
+    for (Row& r : rows) {
+        r.id = (int32_t)rng();
+        r.name.resize(rng() % 40);
+        for (char& c : r.name) c = (char)(rng() % 256);
+        r.price = (float)(rng() % 100000) / 100;
+        r.note = rng() % 3 ? "" : string(rng() % 300, 'n');
+    }
+    return rows;
+}
+
+static void testRoundTrip(mt19937& rng) {
+    for (int round = 0; round < 20; ++round) {
+        vector<Row> rows = randomRows(rng);
+        writeFile(testPath(), encodeRows(rows));
+
+        SnapshotReader reader;
+        if (!CHECK(reader.open(testPath(), 'D', layout))) return;
+        CHECK(reader.rowCount() == rows.size());
+        for (size_t i = 0; i < rows.size() && i < reader.rowCount(); ++i) {
+            CHECK(reader.intAt(0, i) == rows[i].id);
+            CHECK(reader.stringAt(1, i) == rows[i].name);
+            CHECK(reader.floatAt(2, i) == rows[i].price);
+            CHECK(reader.stringAt(3, i) == rows[i].note);
+        }
+    }
+}
+
+static void testWrongLayoutRefused() {
+    writeFile(testPath(), encodeRows({ { 1, "a", 1.5f, "" } }));
+    SnapshotReader reader;
+    CHECK(!openQuietly(reader, 'P', layout));
+    CHECK(!openQuietly(reader, 'D', { ColumnKind::Int32 }));
+    CHECK(!openQuietly(reader, 'D', { ColumnKind::Int32, ColumnKind::String, ColumnKind::Float32, ColumnKind::Int32 }));
+
+    string bytes = encodeRows({ { 1, "a", 1.5f, "" } });
+    bytes[4] = 2;   // format version
+    writeFile(testPath(), bytes);
+    CHECK(!openQuietly(reader, 'D', layout));
+
+    writeFile(testPath(), "");
+    CHECK(!openQuietly(reader, 'D', layout));
+    filesystem::remove(testPath());
+    CHECK(!openQuietly(reader, 'D', layout));
+}
+
+static void testHeapOverflowRefused() {
+    // Never read: addString refuses the string before copying it
+    static const char unused[8] = {};
+    SnapshotWriter writer('D', { ColumnKind::String });
+    writer.addString(0, "ok");
+    writer.endRow();
+    writer.addString(0, string_view(unused, (size_t)5 << 30));
+    writer.endRow();
+    streambuf* saved = cerr.rdbuf(nullptr);
+    CHECK(writer.encode().empty());
+    cerr.rdbuf(saved);
+}
+
+static void testWrappingRowCountRefused() {
+    SnapshotWriter writer('D', { ColumnKind::String });
+    writer.addString(0, "x");
+    writer.endRow();
+    string bytes = writer.encode();
+    uint64_t rows = (1ULL << 61) + 1;   // times the 8-byte column width wraps to 8
+    memcpy(&bytes[16], &rows, sizeof(rows));
+    writeFile(testPath(), bytes);
+    SnapshotReader reader;
+    CHECK(!openQuietly(reader, 'D', { ColumnKind::String }));
+}
+
+// Reads the layout straight from the bytes of a file the reader accepted:
+// every column and the string heap must lie inside the file
+static bool layoutFits(const string& bytes) {
+    uint64_t rows, heapOffset, heapSize;
+    memcpy(&rows, &bytes[16], 8);
+    memcpy(&heapOffset, &bytes[24], 8);
+    memcpy(&heapSize, &bytes[32], 8);
+    if (heapOffset > bytes.size() || heapSize > bytes.size() - heapOffset) return false;
+    for (size_t i = 0; i < layout.size(); ++i) {
+        uint64_t offset;
+        memcpy(&offset, &bytes[40 + i * 16 + 8], 8);
+        uint64_t width = layout[i] == ColumnKind::String ? 8 : 4;
+        if (offset > bytes.size() || rows > (bytes.size() - offset) / width) return false;
+    }
+    return true;
+}
+
+// Every value an accepted file hands out must come from inside it
+static void readEverything(const SnapshotReader& reader, size_t fileBytes) {
+    size_t touched = 0;
+    for (size_t i = 0; i < reader.rowCount(); ++i) {
+        touched += (size_t)reader.intAt(0, i) & 1;
+        touched += reader.floatAt(2, i) > 0;
+        for (size_t column : { 1, 3 }) {
+            string_view s = reader.stringAt(column, i);
+            CHECK(s.size() <= fileBytes);
+            for (char c : s) touched += (unsigned char)c & 1;
+        }
+    }
+    (void)touched;
+}
+
+static void fuzz(const FuzzOptions& options) {
+    mt19937 rng(options.seed);
+    // Includes row counts whose product with a column width wraps
+    const uint64_t edges[] = { 0, 1, 7, 8, 0xFFFFFFFFull, 0x100000000ull, (1ULL << 61) + 1,
+                               (1ULL << 62) + 1, 0x7FFFFFFFFFFFFFFFull, 0xFFFFFFFFFFFFFFFFull };
+    for (long i = 0; i < options.iterations; ++i) {
+        string bytes = encodeRows(randomRows(rng));
+        int edits = 1 + rng() % 4;
+        for (int e = 0; e < edits; ++e) {
+            switch (rng() % 4) {
+                case 0:
+                    bytes[rng() % bytes.size()] = (char)rng();
+                    break;
+                case 1: {
+                    // Header and column directory fields get extreme values
+                    size_t field = (rng() % ((40 + 4 * 16) / 8)) * 8;
+                    uint64_t value = rng() % 2 ? edges[rng() % size(edges)] : bytes.size() - rng() % 16;
+                    if (field + 8 <= bytes.size()) memcpy(&bytes[field], &value, 8);
+                    break;
+                }
+                case 2:
+                    bytes.resize(rng() % bytes.size());
+                    break;
+                case 3:
+                    bytes.append(rng() % 64, (char)rng());
+                    break;
+            }
+            if (bytes.empty()) bytes = "H";
+        }
+        writeFile(testPath(), bytes);
+
+        SnapshotReader reader;
+        if (openQuietly(reader, 'D', layout)) {
+            if (!CHECK_MSG(layoutFits(bytes), "iteration " + to_string(i))) return;
+            readEverything(reader, bytes.size());
+        }
+    }
+}
+
+// --- Benchmark ---
+
+template <typename F>
+static double millis(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Rows shaped like hot prescriptions: a name and a base64 signature. Times
+// opening the file, one pass over the columns an index build reads, and
+// copying every row out, which is what DataManager does at startup.
+static void bench() {
+    for (size_t count : { 100000, 1000000 }) {
+        vector<Row> rows(count);
+        for (size_t i = 0; i < count; ++i) {
+            rows[i] = { (int32_t)i, "Patient name " + to_string(i), 12.5f, string(88, 'S') };
+        }
+        writeFile(testPath(), encodeRows(rows));
+        rows.clear();
+        rows.shrink_to_fit();
+
+        double open = millis([&] {
+            SnapshotReader reader;
+            reader.open(testPath(), 'D', layout);
+        });
+        size_t touched = 0;
+        double scan = millis([&] {
+            SnapshotReader reader;
+            reader.open(testPath(), 'D', layout);
+            for (size_t i = 0; i < reader.rowCount(); ++i) {
+                touched += (size_t)reader.intAt(0, i) + reader.stringAt(1, i).size();
+            }
+        });
+        double load = millis([&] {
+            SnapshotReader reader;
+            reader.open(testPath(), 'D', layout);
+            rows.reserve(reader.rowCount());
+            for (size_t i = 0; i < reader.rowCount(); ++i) {
+                rows.push_back({ reader.intAt(0, i), string(reader.stringAt(1, i)), reader.floatAt(2, i),
+                                 string(reader.stringAt(3, i)) });
+            }
+        });
+        cout << count << " rows: open " << open << " ms, scan " << scan << " ms, load " << load << " ms"
+             << (touched && rows.size() == count ? "" : " (wrong row count)") << "\n";
+    }
+    filesystem::remove(testPath());
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+    FuzzOptions options = fuzzOptions(argc, argv, 5000);
+    mt19937 rng(options.seed);
+
+    testRoundTrip(rng);
+    testWrongLayoutRefused();
+    testHeapOverflowRefused();
+    testWrappingRowCountRefused();
+    fuzz(options);
+
+    filesystem::remove(testPath());
+    return checkSummary("SnapshotFileTest");
+}
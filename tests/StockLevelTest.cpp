@@ -0,0 +1,132 @@
+#include "Check.h"
+#include "../StockLevel.h"
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// StockLevel with many threads taking one drug at once: however the CAS
+// loops interleave, exactly the stock on the shelf is handed out, available
+// never goes below zero, and released units can be taken again.
+//
+//   StockLevelTest [seed] [iterations]   races over random order sizes
+//   StockLevelTest --bench               dispenses/s against a mutex
+
+static const int threadCount = 8;
+
+// Threads reserve random amounts until the drug runs out; some hand their
+// reservation back instead of dispensing it
+static void race(mt19937& rng, long round) {
+    int initial = 1 + rng() % 5000;
+    StockLevel level(initial);
+    vector<int> dispensed(threadCount);
+    vector<unsigned> seeds(threadCount);
+    for (unsigned& s : seeds) s = rng();
+
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            mt19937 local(seeds[t]);
+            int refusals = 0;
+            while (refusals < 20) {
+                int units = 1 + local() % 7;
+                if (!level.reserve(units)) {
+                    ++refusals;
+                    continue;
+                }
+                CHECK(level.available.load() >= 0);
+                if (local() % 4 == 0) {
+                    level.release(units);
+                } else {
+                    level.commit(units);
+                    dispensed[t] += units;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    int total = 0;
+    for (int d : dispensed) total += d;
+    string context = "round " + to_string(round);
+    CHECK_MSG(level.onHand.load() == initial - total, context);
+    CHECK_MSG(level.available.load() == level.onHand.load(), context);
+    // Whatever is left can still be taken, a unit at a time
+    while (level.reserve(1)) level.commit(1);
+    CHECK_MSG(level.onHand.load() == 0 && level.available.load() == 0, context);
+}
+
+static void testEdges() {
+    StockLevel level(10);
+    CHECK(!level.reserve(-1));
+    CHECK(!level.reserve(11));
+    CHECK(level.reserve(10));
+    CHECK(!level.reserve(1));
+    CHECK(level.commit(4) == 6);
+    level.release(6);
+    CHECK(level.available.load() == 6 && level.onHand.load() == 6);
+    CHECK(level.reserve(0));
+}
+
+// --- Benchmark ---
+
+// The old way, for comparison: one lock around check-and-subtract
+struct LockedStock {
+    mutex m;
+    int quantity;
+    bool take(int units) {
+        lock_guard<mutex> guard(m);
+        if (quantity < units) return false;
+        quantity -= units;
+        return true;
+    }
+};
+
+template <typename F>
+static double dispensesPerSecond(int threads, long perThread, F take) {
+    vector<thread> running;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        running.emplace_back([&] {
+            for (long i = 0; i < perThread; ++i) take();
+        });
+    }
+    for (auto& t : running) t.join();
+    return threads * perThread / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void bench() {
+    const long perThread = 2000000;
+    cout << thread::hardware_concurrency() << " hardware threads, " << perThread
+         << " one-unit dispenses per thread, one hot drug\n";
+    for (int threads : { 1, 2, 4, 8 }) {
+        StockLevel level(INT_MAX);
+        double atomic = dispensesPerSecond(threads, perThread, [&] {
+            if (level.reserve(1)) level.commit(1);
+        });
+        LockedStock locked;
+        locked.quantity = INT_MAX;
+        double mutexed = dispensesPerSecond(threads, perThread, [&] { locked.take(1); });
+        bool exact = level.onHand.load() == INT_MAX - threads * perThread
+                  && locked.quantity == INT_MAX - threads * perThread;
+        cout << threads << " threads: atomic " << (long)(atomic / 1e3) << "k/s, mutex " << (long)(mutexed / 1e3)
+             << "k/s" << (exact ? "" : " (final stock wrong)") << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+    FuzzOptions options = fuzzOptions(argc, argv, 200);
+    mt19937 rng(options.seed);
+
+    testEdges();
+    for (long i = 0; i < options.iterations; ++i) race(rng, i);
+    return checkSummary("StockLevelTest");
+}
@@ -0,0 +1,196 @@
+#include "Check.h"
+#include "../WriteAheadLog.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// WriteAheadLog round trips, group commit from several threads, replay of
+// torn and damaged logs, and (on Linux) batches that fail to reach disk.
+//
+//   WriteAheadLogTest [seed] [iterations]
+
+typedef vector<pair<char, string>> Records;
+
+static string testPath() {
+    return (filesystem::temp_directory_path() / "WriteAheadLogTest.wal").string();
+}
+
+static string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    ostringstream bytes;
+    bytes << in.rdbuf();
+    return bytes.str();
+}
+
+static void writeFile(const string& path, const string& bytes) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+// Replay prints a warning when it cuts a log; the checks say what matters
+static Records replayQuietly(WriteAheadLog& wal) {
+    Records records;
+    streambuf* saved = cerr.rdbuf(nullptr);
+    wal.replay([&](char type, const string& payload) { records.emplace_back(type, payload); });
+    cerr.rdbuf(saved);
+    return records;
+}
+
+static Records replayFile() {
+    WriteAheadLog wal(testPath());
+    return replayQuietly(wal);
+}
+
+static string randomPayload(mt19937& rng) {
+    static const char alphabet[] = "abcXYZ019,|\"\\\n\r ";
+    string payload(rng() % 60, ' ');
+    for (char& c : payload) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    return payload;
+}
+
+static Records writeRecords(mt19937& rng, size_t count) {
+    Records records;
+    filesystem::remove(testPath());
+    WriteAheadLog wal(testPath());
+    wal.setGroupCommit(chrono::microseconds(0), 16);
+    for (size_t i = 0; i < count; ++i) {
+        records.emplace_back("UDPTL"[rng() % 5], randomPayload(rng));
+        wal.append(records.back().first, records.back().second);
+    }
+    CHECK(wal.sync());
+    return records;
+}
+
+static void testRoundTrip(mt19937& rng) {
+    Records written = writeRecords(rng, 500);
+    CHECK(replayFile() == written);
+
+    // Records appended after a replay follow the earlier ones
+    {
+        WriteAheadLog wal(testPath());
+        CHECK(replayQuietly(wal) == written);
+        written.emplace_back('D', "after\nreplay");
+        CHECK(wal.waitDurable(wal.append('D', "after\nreplay")));
+    }
+    CHECK(replayFile() == written);
+
+    WriteAheadLog wal(testPath());
+    CHECK(wal.reset());
+    CHECK(wal.size() == 0);
+    CHECK(replayQuietly(wal).empty());
+}
+
+static void testConcurrentAppends() {
+    const int threads = 4, perThread = 300;
+    filesystem::remove(testPath());
+    {
+        WriteAheadLog wal(testPath());
+        wal.setGroupCommit(chrono::microseconds(200), 32);
+        vector<thread> writers;
+        for (int t = 0; t < threads; ++t) {
+            writers.emplace_back([&wal, t] {
+                for (int i = 0; i < perThread; ++i) {
+                    uint64_t seq = wal.append('T', to_string(t) + "," + to_string(i));
+                    if (i % 10 == 0) CHECK(wal.waitDurable(seq));
+                }
+            });
+        }
+        for (auto& w : writers) w.join();
+    }
+
+    // Every record is there once, and each thread's records are in order
+    vector<int> next(threads, 0);
+    Records records = replayFile();
+    CHECK(records.size() == (size_t)threads * perThread);
+    for (const auto& r : records) {
+        size_t comma = r.second.find(',');
+        int t = stoi(r.second.substr(0, comma));
+        int i = stoi(r.second.substr(comma + 1));
+        CHECK(t >= 0 && t < threads && i == next[t]);
+        if (t >= 0 && t < threads) next[t] = i + 1;
+    }
+}
+
+// A log cut or damaged anywhere replays a prefix of what was written, is
+// cut back to that prefix, and takes new records after it
+static void fuzzDamagedLogs(const FuzzOptions& options) {
+    mt19937 rng(options.seed);
+    for (long i = 0; i < options.iterations; ++i) {
+        Records written = writeRecords(rng, 1 + rng() % 40);
+        string bytes = readFile(testPath());
+        switch (rng() % 3) {
+            case 0: bytes.resize(rng() % bytes.size()); break;
+            case 1: bytes[rng() % bytes.size()] ^= (char)(1 + rng() % 255); break;
+            case 2: bytes.insert(rng() % bytes.size(), 1, "\n|\\x"[rng() % 4]); break;
+        }
+        writeFile(testPath(), bytes);
+
+        Records replayed;
+        {
+            WriteAheadLog wal(testPath());
+            replayed = replayQuietly(wal);
+            bool prefix = replayed.size() <= written.size()
+                          && equal(replayed.begin(), replayed.end(), written.begin());
+            if (!CHECK_MSG(prefix, "iteration " + to_string(i))) return;
+            CHECK(wal.waitDurable(wal.append('X', "new")));
+        }
+        replayed.emplace_back('X', "new");
+        if (!CHECK_MSG(replayFile() == replayed, "iteration " + to_string(i))) return;
+    }
+}
+
+#ifndef _WIN32
+static void limitFileSize(rlim_t bytes) {
+    rlimit limit = { bytes, RLIM_INFINITY };
+    setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+// A batch that cannot be written fails its waiters, is cut off the file,
+// and does not stop later batches
+static void testFailedBatch() {
+    signal(SIGXFSZ, SIG_IGN);
+    filesystem::remove(testPath());
+    {
+        WriteAheadLog wal(testPath());
+        CHECK(wal.waitDurable(wal.append('A', "first")));
+
+        streambuf* saved = cerr.rdbuf(nullptr);
+        limitFileSize(40);   // the next batch is cut off mid-record
+        uint64_t second = wal.append('B', string(100, 'x'));
+        CHECK(!wal.waitDurable(second));
+        uint64_t third = wal.append('C', string(100, 'y'));
+        CHECK(!wal.waitDurable(third));
+        limitFileSize(RLIM_INFINITY);
+        cerr.rdbuf(saved);
+
+        CHECK(wal.waitDurable(wal.append('D', "after")));
+        // Earlier failures are still reported
+        CHECK(!wal.waitDurable(second) && !wal.waitDurable(third));
+    }
+    CHECK(replayFile() == Records({ { 'A', "first" }, { 'D', "after" } }));
+}
+#endif
+
+int main(int argc, char** argv) {
+    FuzzOptions options = fuzzOptions(argc, argv, 300);
+    mt19937 rng(options.seed);
+
+    testRoundTrip(rng);
+    testConcurrentAppends();
+    fuzzDamagedLogs(options);
+#ifndef _WIN32
+    testFailedBatch();
+#endif
+
+    filesystem::remove(testPath());
+    return checkSummary("WriteAheadLogTest");
+}
@@ -58,6 +58,22 @@ export interface EpidemicReport {
   timestamp: string;
 }
 
+export interface EpidemicTrend {
+  diagnosis: string;
+  today: number;
+  window: number;
+  baseline: number;
+  deviation: number;
+  cusum: number;
+  alert: boolean;
+}
+
+export interface EpidemicState {
+  windowDays: number;
+  alerts: number;
+  trends: EpidemicTrend[];
+}
+
 export interface DashboardData {
   revenue: number;
   lowStock: number;
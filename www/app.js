@@ -4,6 +4,13 @@ const API_URL = window.location.protocol === 'file:'
 
 console.log("Using API URL:", API_URL);
 
+// Session token from /api/login, sent instead of the credentials
+let sessionToken = null;
+
+function authHeaders() {
+    return sessionToken ? { 'Authorization': `Bearer ${sessionToken}` } : {};
+}
+
 async function login() {
     alert("Debug: Login function started. Trying to connect to: " + API_URL);
     const u = document.getElementById('username').value;
@@ -19,6 +26,7 @@ async function login() {
         const data = await res.json();
 
         if (data.success) {
+            sessionToken = data.token;
             document.getElementById('login-screen').style.display = 'none';
             document.getElementById('dashboard').style.display = 'block';
 
@@ -50,7 +58,7 @@ async function login() {
                 showTab('reports');
             }
         } else {
-            alert("Login Failed: Invalid Credentials");
+            alert("Login Failed: " + (data.error || "Invalid Credentials"));
         }
     } catch (e) {
         console.error("Login Error:", e);
@@ -58,7 +66,10 @@ async function login() {
     }
 }
 
-function logout() {
+async function logout() {
+    if (sessionToken) {
+        await fetch(`${API_URL}/logout`, { method: 'POST', headers: authHeaders() }).catch(() => {});
+    }
     location.reload();
 }
 
@@ -75,14 +86,25 @@ function showTab(tabId) {
     if (tabId === 'reports') loadReport();
 }
 
-async function loadDrugs() {
-    const res = await fetch(`${API_URL}/drugs`);
-    const drugs = await res.json();
+// One page at a time; "Load More" asks for the next with the cursor the
+// server handed back
+let drugCursor = null;
+
+async function loadDrugs(more = false) {
+    const params = new URLSearchParams({ limit: 100 });
+    const search = document.getElementById('drug-search').value.trim();
+    if (search) params.set('prefix', search);
+    if (document.getElementById('drug-low-stock').checked) params.set('lowStock', '1');
+    if (more && drugCursor) params.set('cursor', drugCursor);
+
+    const res = await fetch(`${API_URL}/drugs?${params}`);
+    const page = await res.json();
+    if (page.error) return alert(page.error);
 
     const tbody = document.querySelector('#drug-table tbody');
-    tbody.innerHTML = '';
+    if (!more) tbody.innerHTML = '';
 
-    drugs.forEach(d => {
+    page.drugs.forEach(d => {
         tbody.innerHTML += `
             <tr>
                 <td>${d.name}</td>
@@ -92,10 +114,13 @@ async function loadDrugs() {
             </tr>
         `;
     });
+
+    drugCursor = page.nextCursor;
+    document.getElementById('drug-more').style.display = drugCursor ? 'inline-block' : 'none';
 }
 
 async function loadReport() {
-    const res = await fetch(`${API_URL}/report`);
+    const res = await fetch(`${API_URL}/report`, { headers: authHeaders() });
     const data = await res.json();
 
     document.getElementById('revenue-display').innerText = `KES ${data.revenue}`;